@@ -0,0 +1,174 @@
+// Measures the tensor arena the compiled in model needs and writes it as header
+// for the firmware build (see TENSOR_ARENA_SIZE in ../CMakeLists.txt).
+//
+// Usage: arena_size [--model model.tflite] [model_arena_size.h]
+// Without --model the compiled in model is measured, with --model a model file
+// like the one with offline memory plan written by memory_plan.
+// The model is allocated once through the RecordingMicroInterpreter to print
+// the arena usage by allocation type, and once through the MicroInterpreter
+// used by the firmware, whose usage is the arena size. The size is checked by
+// allocating the model again in an arena of exactly that size. Built as 32 bit
+// program (HOST_32BIT) the size matches the RP2040, otherwise the larger 64 bit
+// pointers make it an upper bound. With CASCADE_GATE the gate model is
+// allocated after the model in the same arena, like in the firmware, and the
+// size covers both.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "host_platform.h"
+#include "gate_model_data.h"
+#include "micro_speech_model_data.h"
+#include "parallel_kernels.h"
+#include "streaming_depthwise_conv.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/recording_micro_interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr int kMeasureArenaSize = 256 * 1024;
+// The firmware arena is 16 byte aligned, the slack covers the alignment of an
+// arena placed elsewhere
+constexpr int kArenaAlignment = 16;
+alignas(kArenaAlignment) uint8_t tensor_arena[kMeasureArenaSize];
+
+struct AllocationType {
+	tflite::RecordedAllocationType type;
+	const char* name;
+};
+
+const AllocationType kAllocationTypes[] = {
+    {tflite::RecordedAllocationType::kTfLiteEvalTensorData, "Eval tensors"},
+    {tflite::RecordedAllocationType::kPersistentTfLiteTensorData, "Persistent tensors"},
+    {tflite::RecordedAllocationType::kPersistentTfLiteTensorQuantizationData, "Tensor quantization"},
+    {tflite::RecordedAllocationType::kPersistentBufferData, "Persistent buffers"},
+    {tflite::RecordedAllocationType::kTfLiteTensorVariableBufferData, "Variable buffers"},
+    {tflite::RecordedAllocationType::kNodeAndRegistrationArray, "Nodes and registrations"},
+    {tflite::RecordedAllocationType::kOpData, "Operator data"},
+};
+
+// Allocates the models like the firmware in the first size bytes of the arena
+// and returns the used bytes, or 0 if they do not fit
+size_t AllocateFirmwareModels(const tflite::Model* model, const tflite::MicroOpResolver& op_resolver, size_t size,
+                              tflite::ErrorReporter* error_reporter) {
+	tflite::MicroAllocator* allocator = tflite::MicroAllocator::Create(tensor_arena, size, error_reporter);
+	if (allocator == nullptr) {
+		return 0;
+	}
+	tflite::MicroInterpreter interpreter(model, op_resolver, allocator, error_reporter);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		return 0;
+	}
+#if CASCADE_GATE
+	tflite::MicroInterpreter gate_interpreter(tflite::GetModel(g_gate_model_data), op_resolver, allocator,
+	                                          error_reporter);
+	if (gate_interpreter.AllocateTensors() != kTfLiteOk) {
+		return 0;
+	}
+#endif
+	return allocator->used_bytes();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* model_path = nullptr;
+	const char* header_path = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--model") == 0) && (i + 1 < argc)) {
+			model_path = argv[++i];
+		} else if (header_path == nullptr) {
+			header_path = argv[i];
+		} else {
+			fprintf(stderr, "Usage: %s [--model model.tflite] [model_arena_size.h]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<uint8_t> model_file;
+	const uint8_t* model_data = g_micro_speech_model_data;
+	if (model_path != nullptr) {
+		FILE* file = fopen(model_path, "rb");
+		if (file == nullptr) {
+			fprintf(stderr, "Could not open %s\n", model_path);
+			return 1;
+		}
+		uint8_t buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			model_file.insert(model_file.end(), buffer, buffer + read);
+		}
+		fclose(file);
+		model_data = model_file.data();
+	}
+
+	// Same operators as the firmware
+	const tflite::Model* model = tflite::GetModel(model_data);
+#if PARALLEL_KERNELS
+	static ParallelOpResolver<4> micro_op_resolver(error_reporter, STREAMING_INFERENCE);
+#elif STREAMING_INFERENCE
+	static StreamingOpResolver<4> micro_op_resolver(error_reporter);
+#else
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+#endif
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+
+	{
+		tflite::RecordingMicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kMeasureArenaSize,
+		                                              error_reporter);
+		if (interpreter.AllocateTensors() != kTfLiteOk) {
+			fprintf(stderr, "AllocateTensors() failed\n");
+			return 1;
+		}
+		const tflite::RecordingMicroAllocator& allocator = interpreter.GetMicroAllocator();
+		printf("Arena usage by type (%d bit pointers):\n", (int)(8 * sizeof(void*)));
+		for (const AllocationType& type : kAllocationTypes) {
+			const tflite::RecordedAllocation allocation = allocator.GetRecordedAllocation(type.type);
+			printf("  %-24s %6d bytes (%d allocations)\n", type.name, (int)allocation.used_bytes,
+			       (int)allocation.count);
+		}
+	}
+
+	const size_t arena_size = AllocateFirmwareModels(model, micro_op_resolver, kMeasureArenaSize, error_reporter);
+	if (arena_size == 0) {
+		fprintf(stderr, "AllocateTensors() failed\n");
+		return 1;
+	}
+	memset(tensor_arena, 0, sizeof(tensor_arena));
+	if (AllocateFirmwareModels(model, micro_op_resolver, arena_size, error_reporter) != arena_size) {
+		fprintf(stderr, "Model does not fit into the measured arena size of %d bytes\n", (int)arena_size);
+		return 1;
+	}
+	printf("Arena size: %d bytes\n", (int)arena_size);
+
+	if (header_path == nullptr) {
+		return 0;
+	}
+	FILE* file = fopen(header_path, "w");
+	if (file == nullptr) {
+		fprintf(stderr, "Could not write %s\n", header_path);
+		return 1;
+	}
+	fprintf(file,
+	        "// Generated by host/arena_size.cpp, do not edit\n"
+	        "#ifndef MODEL_ARENA_SIZE_H_\n"
+	        "#define MODEL_ARENA_SIZE_H_\n"
+	        "\n"
+	        "// Tensor arena bytes used by the model (%d bit pointers), plus alignment slack\n"
+	        "constexpr int kModelArenaSize = %d + %d;\n"
+	        "\n"
+	        "#endif\n",
+	        (int)(8 * sizeof(void*)), (int)arena_size, kArenaAlignment);
+	return fclose(file) == 0 ? 0 : 1;
+}
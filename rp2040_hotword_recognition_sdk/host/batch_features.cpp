@@ -0,0 +1,198 @@
+// Converts a directory tree of 16 kHz WAV clips into .npy model input features,
+// generated by the firmware feature provider and GenerateMicroFeatures(), so
+// they are bit-identical to the features the device computes for the clips.
+// Each .npy file holds a kFeatureSliceCount x kFeatureSliceSize int8 array and
+// mirrors the path of its clip below the output directory.
+//
+// Usage: batch_features wav_dir out_dir [--jobs N]
+// The frontend keeps its state in globals, so the clips are split across N
+// worker processes (default: number of cores) instead of threads.
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clip_features.h"
+#include "host_platform.h"
+#include "micro_features/micro_model_settings.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "wav_file.h"
+
+namespace {
+
+struct BatchCounts {
+	int converted;
+	int failed;
+};
+
+bool HasWavExtension(const std::string& name) {
+	return (name.size() > 4) && (strcasecmp(name.c_str() + name.size() - 4, ".wav") == 0);
+}
+
+// Collects the paths of all WAV files below root, relative to root
+void ListWavFiles(const std::string& root, const std::string& relative, std::vector<std::string>* files) {
+	DIR* dir = opendir((root + "/" + relative).c_str());
+	if (dir == nullptr) {
+		return;
+	}
+	while (struct dirent* entry = readdir(dir)) {
+		if (entry->d_name[0] == '.') {
+			continue;
+		}
+		const std::string path = relative.empty() ? entry->d_name : relative + "/" + entry->d_name;
+		struct stat info;
+		if (stat((root + "/" + path).c_str(), &info) != 0) {
+			continue;
+		}
+		if (S_ISDIR(info.st_mode)) {
+			ListWavFiles(root, path, files);
+		} else if (HasWavExtension(path)) {
+			files->push_back(path);
+		}
+	}
+	closedir(dir);
+}
+
+// Creates all missing directories of the parent path of file
+void MakeParentDirectories(const std::string& file) {
+	for (size_t pos = file.find('/', 1); pos != std::string::npos; pos = file.find('/', pos + 1)) {
+		mkdir(file.substr(0, pos).c_str(), 0755);
+	}
+}
+
+// Writes features as version 1.0 .npy file with a 64 byte aligned header
+bool WriteNpyFile(const std::string& path, const int8_t* features) {
+	char header[128];
+	int length = snprintf(header, sizeof(header), "{'descr': '|i1', 'fortran_order': False, 'shape': (%d, %d), }",
+	                      kFeatureSliceCount, kFeatureSliceSize);
+	const int total = ((10 + length + 1 + 63) / 64) * 64;
+	while (10 + length + 1 < total) {
+		header[length++] = ' ';
+	}
+	header[length++] = '\n';
+	const uint8_t preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, static_cast<uint8_t>(length & 0xff),
+	                              static_cast<uint8_t>(length >> 8)};
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	const bool written = (fwrite(preamble, 1, sizeof(preamble), file) == sizeof(preamble)) &&
+	                     (fwrite(header, 1, length, file) == static_cast<size_t>(length)) &&
+	                     (fwrite(features, 1, kFeatureElementCount, file) == kFeatureElementCount);
+	return (fclose(file) == 0) && written;
+}
+
+// Converts every jobs-th clip starting at job
+BatchCounts ConvertClips(const std::string& wav_dir, const std::string& out_dir, const std::vector<std::string>& files,
+                         int job, int jobs) {
+	static tflite::MicroErrorReporter micro_error_reporter;
+	BatchCounts counts = {0, 0};
+	std::vector<int16_t> samples;
+	int8_t features[kFeatureElementCount];
+	for (size_t i = job; i < files.size(); i += jobs) {
+		int sample_rate = 0;
+		if (!ReadWavFile((wav_dir + "/" + files[i]).c_str(), &samples, &sample_rate) ||
+		    (sample_rate != kAudioSampleFrequency)) {
+			fprintf(stderr, "Skipping %s: not a 16 kHz 16 bit PCM WAV file\n", files[i].c_str());
+			counts.failed++;
+			continue;
+		}
+		const std::string out_path = out_dir + "/" + files[i].substr(0, files[i].size() - 4) + ".npy";
+		MakeParentDirectories(out_path);
+		if ((GenerateClipFeatures(&micro_error_reporter, samples.data(), samples.size(), features) != kTfLiteOk) ||
+		    !WriteNpyFile(out_path, features)) {
+			fprintf(stderr, "Failed to convert %s\n", files[i].c_str());
+			counts.failed++;
+			continue;
+		}
+		counts.converted++;
+	}
+	return counts;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* wav_dir = nullptr;
+	const char* out_dir = nullptr;
+	int jobs = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc)) {
+			jobs = std::max(1, atoi(argv[++i]));
+		} else if (wav_dir == nullptr) {
+			wav_dir = argv[i];
+		} else if (out_dir == nullptr) {
+			out_dir = argv[i];
+		} else {
+			wav_dir = nullptr;
+			break;
+		}
+	}
+	if ((wav_dir == nullptr) || (out_dir == nullptr)) {
+		fprintf(stderr, "Usage: %s wav_dir out_dir [--jobs N]\n", argv[0]);
+		return 1;
+	}
+
+	InitializeHostPlatform();
+	std::vector<std::string> files;
+	ListWavFiles(wav_dir, "", &files);
+	std::sort(files.begin(), files.end());
+	mkdir(out_dir, 0755);
+	jobs = std::min(jobs, std::max(1, static_cast<int>(files.size())));
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	BatchCounts total = {0, 0};
+	if (jobs == 1) {
+		total = ConvertClips(wav_dir, out_dir, files, 0, 1);
+	} else {
+		// Every worker reports its counts through a pipe when done
+		std::vector<pid_t> workers;
+		std::vector<int> pipes;
+		for (int job = 0; job < jobs; job++) {
+			int fds[2];
+			if (pipe(fds) != 0) {
+				perror("pipe");
+				return 1;
+			}
+			const pid_t pid = fork();
+			if (pid < 0) {
+				perror("fork");
+				return 1;
+			}
+			if (pid == 0) {
+				close(fds[0]);
+				const BatchCounts counts = ConvertClips(wav_dir, out_dir, files, job, jobs);
+				const bool reported = write(fds[1], &counts, sizeof(counts)) == sizeof(counts);
+				_exit(reported ? 0 : 1);
+			}
+			close(fds[1]);
+			workers.push_back(pid);
+			pipes.push_back(fds[0]);
+		}
+		for (int job = 0; job < jobs; job++) {
+			BatchCounts counts = {0, 0};
+			if (read(pipes[job], &counts, sizeof(counts)) != sizeof(counts)) {
+				fprintf(stderr, "Worker %d failed\n", job);
+			}
+			close(pipes[job]);
+			waitpid(workers[job], nullptr, 0);
+			total.converted += counts.converted;
+			total.failed += counts.failed;
+		}
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("Converted %d clips (%d failed) in %.2f s with %d jobs, %.0f clips/s\n", total.converted, total.failed,
+	       seconds, jobs, seconds > 0.0 ? total.converted / seconds : 0.0);
+	return total.failed > 0 ? 1 : 0;
+}
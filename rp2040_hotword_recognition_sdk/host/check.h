@@ -0,0 +1,45 @@
+#ifndef HOST_CHECK_H_
+#define HOST_CHECK_H_
+
+#include <cstdarg>
+#include <cstdio>
+
+// Counting checks of the host check programs: each failed check is printed, and
+// ReportChecks() prints the summary and returns the exit code of the program.
+
+namespace check_internal {
+struct CheckCounts {
+	int check_count;
+	int failure_count;
+};
+
+inline CheckCounts& Counts() {
+	static CheckCounts counts = {0, 0};
+	return counts;
+}
+}  // namespace check_internal
+
+// Counts a check and prints its description, a printf format, if it failed. The
+// description is only formatted for a failed check.
+inline void Check(bool condition, const char* description, ...) {
+	check_internal::CheckCounts& counts = check_internal::Counts();
+	counts.check_count++;
+	if (!condition) {
+		counts.failure_count++;
+		va_list args;
+		va_start(args, description);
+		printf("FAILED: ");
+		vprintf(description, args);
+		printf("\n");
+		va_end(args);
+	}
+}
+
+// Prints how many checks passed and returns 1 if any failed, 0 otherwise
+inline int ReportChecks(const char* name) {
+	const check_internal::CheckCounts& counts = check_internal::Counts();
+	printf("%s: %d of %d checks passed\n", name, counts.check_count - counts.failure_count, counts.check_count);
+	return (counts.failure_count == 0) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#include "clip_features.h"
+
+#include "feature_provider.h"
+#include "host_audio_provider.h"
+#include "micro_features/micro_model_settings.h"
+
+TfLiteStatus GenerateClipFeatures(tflite::ErrorReporter* error_reporter, const int16_t* samples, int sample_count,
+                                  int8_t* features) {
+	SetHostAudioData(samples, sample_count);
+	// A new provider starts with a fresh frontend state and computes all slices
+	FeatureProvider feature_provider(kFeatureElementCount, features);
+	const int32_t last_slice_time = (kFeatureSliceCount - 1) * kFeatureSliceStrideMs;
+	int how_many_new_slices = 0;
+	return feature_provider.PopulateFeatureData(error_reporter, 0, last_slice_time, &how_many_new_slices);
+}
@@ -0,0 +1,17 @@
+#ifndef CLIP_FEATURES_H_
+#define CLIP_FEATURES_H_
+
+#include <stdint.h>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+// Generates the kFeatureElementCount model input features of a one second clip
+// exactly like the firmware does, through FeatureProvider and
+// GenerateMicroFeatures(), with the frontend state reset before the clip. The
+// slices start every kFeatureSliceStrideMs from the first sample, matching the
+// spectrograms used in training. Shorter clips are padded with zeros.
+TfLiteStatus GenerateClipFeatures(tflite::ErrorReporter* error_reporter, const int16_t* samples, int sample_count,
+                                  int8_t* features);
+
+#endif
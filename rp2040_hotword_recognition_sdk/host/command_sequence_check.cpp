@@ -0,0 +1,132 @@
+// Checks the command sequence recognizer (src/command_sequence.h) on the host:
+// the table builder shares the states of common beginnings and rejects
+// duplicate, unknown and excess sequences, and Process() matches detections
+// within the gaps, times out and restarts sequences.
+//
+// Usage: command_sequence_check
+// Uses the first two keywords of the model, so it runs with every WORDCOUNT.
+// Prints each failed check and returns 1 if any failed.
+
+#include <cstdio>
+#include <cstring>
+
+#include "check.h"
+#include "command_sequence.h"
+#include "micro_features/micro_model_settings.h"
+
+namespace {
+
+// The recognizer compares the label pointers of RecognizeCommands
+const char* const kWordA = kCategoryLabels[kUnknownIndex + 1];
+const char* const kWordB = kCategoryLabels[kUnknownIndex + 2];
+const char* const kNoWords[] = {nullptr};
+
+struct Result {
+	bool is_found;
+	const char* name;
+	int32_t start_time;
+	int32_t end_time;
+};
+
+Result Detect(CommandSequenceRecognizer* recognizer, int32_t time, const char* word, bool is_new_command = true) {
+	Result result = {false, nullptr, -1, -1};
+	result.is_found =
+	    recognizer->Process(time, word, is_new_command, &result.name, &result.start_time, &result.end_time);
+	return result;
+}
+
+bool IsSequence(const Result& result, const char* name, int32_t start_time, int32_t end_time) {
+	return result.is_found && (strcmp(result.name, name) == 0) && (result.start_time == start_time) &&
+	       (result.end_time == end_time);
+}
+
+void CheckTableBuilder() {
+	const int32_t gaps[] = {1000, 1000, 1000};
+	CommandSequenceRecognizer recognizer;
+	const char* const a_b[] = {kWordA, kWordB, nullptr};
+	const char* const unknown[] = {kWordA, "no such keyword", nullptr};
+	const char* const silence[] = {kCategoryLabels[kSilenceIndex], nullptr};
+	Check(recognizer.AddSequence("a b", a_b, gaps), "a sequence is added");
+	Check(!recognizer.AddSequence("a b again", a_b, gaps), "a duplicate sequence is rejected");
+	Check(!recognizer.AddSequence("unknown", unknown, gaps), "a sequence with an unknown word is rejected");
+	Check(!recognizer.AddSequence("silence", silence, gaps), "a sequence of silence is rejected");
+	Check(!recognizer.AddSequence("empty", kNoWords, gaps), "an empty sequence is rejected");
+
+	// All 8 sequences of 4 words starting with A fill the 15 states after the
+	// start state only if their beginnings share states, 32 would be needed
+	// otherwise
+	CommandSequenceRecognizer full_recognizer;
+	char names[8][8];
+	for (int i = 0; i < 8; i++) {
+		const char* const words[] = {kWordA, (i & 4) ? kWordB : kWordA, (i & 2) ? kWordB : kWordA,
+		                             (i & 1) ? kWordB : kWordA, nullptr};
+		snprintf(names[i], sizeof(names[i]), "a%c%c%c", (i & 4) ? 'b' : 'a', (i & 2) ? 'b' : 'a', (i & 1) ? 'b' : 'a');
+		Check(full_recognizer.AddSequence(names[i], words, gaps), "sequences with a common beginning share states");
+	}
+	const char* const b[] = {kWordB, nullptr};
+	Check(!full_recognizer.AddSequence("b", b, gaps), "a sequence is rejected when the table is full");
+	Check(full_recognizer.AddSequence("ab", a_b, gaps), "a beginning of other sequences needs no new state");
+	Detect(&full_recognizer, 0, kWordA);
+	Detect(&full_recognizer, 100, kWordB);
+	Detect(&full_recognizer, 200, kWordA);
+	Check(IsSequence(Detect(&full_recognizer, 300, kWordB), "abab", 0, 300), "a shared state leads to its sequence");
+}
+
+void CheckPrefixSequences() {
+	const int32_t gaps[] = {1000, 500, 1000};
+	CommandSequenceRecognizer recognizer;
+	const char* const a_b[] = {kWordA, kWordB, nullptr};
+	const char* const a_b_a[] = {kWordA, kWordB, kWordA, nullptr};
+	Check(recognizer.AddSequence("a b", a_b, gaps), "a sequence is added");
+	Check(recognizer.AddSequence("a b a", a_b_a, gaps), "a sequence extending another one is added");
+
+	Check(!Detect(&recognizer, 0, kWordA).is_found, "the first word completes nothing");
+	Check(IsSequence(Detect(&recognizer, 800, kWordB), "a b", 0, 800), "the shorter sequence completes");
+	Check(IsSequence(Detect(&recognizer, 1200, kWordA), "a b a", 0, 1200), "the longer sequence continues");
+
+	// The gap of the third word is shorter
+	Detect(&recognizer, 2000, kWordA);
+	Check(IsSequence(Detect(&recognizer, 2500, kWordB), "a b", 2000, 2500), "the shorter sequence completes again");
+	Check(!Detect(&recognizer, 3100, kWordA).is_found, "the longer sequence times out after its own gap");
+	Check(IsSequence(Detect(&recognizer, 3200, kWordB), "a b", 3100, 3200), "the timed out word starts anew");
+}
+
+void CheckGapsAndRestarts() {
+	const int32_t gaps[] = {1000, 1000, 1000};
+	CommandSequenceRecognizer recognizer;
+	const char* const a_b[] = {kWordA, kWordB, nullptr};
+	recognizer.AddSequence("a b", a_b, gaps);
+
+	Detect(&recognizer, 0, kWordA);
+	Check(!Detect(&recognizer, 1001, kWordB).is_found, "a word after the gap does not continue the sequence");
+	Detect(&recognizer, 2000, kWordA);
+	Check(IsSequence(Detect(&recognizer, 3000, kWordB), "a b", 2000, 3000), "a word at the gap continues the sequence");
+
+	// A repeated first word restarts the sequence at the later one
+	Detect(&recognizer, 10000, kWordA);
+	Detect(&recognizer, 10800, kWordA);
+	Check(IsSequence(Detect(&recognizer, 11700, kWordB), "a b", 10800, 11700), "a repeated first word restarts");
+
+	// A word that starts no sequence returns to the start state
+	Detect(&recognizer, 20000, kWordA);
+	Detect(&recognizer, 20100, kWordB);
+	Check(!Detect(&recognizer, 20200, kWordB).is_found, "a word outside every sequence completes nothing");
+	Detect(&recognizer, 20300, kWordA);
+	Check(IsSequence(Detect(&recognizer, 20400, kWordB), "a b", 20300, 20400), "a sequence starts after a mismatch");
+
+	// Repeated results of one detection, silence and unknown are ignored
+	Detect(&recognizer, 30000, kWordA);
+	Check(!Detect(&recognizer, 30100, kWordB, false).is_found, "a result that is no new command is ignored");
+	Detect(&recognizer, 30200, kCategoryLabels[kSilenceIndex]);
+	Detect(&recognizer, 30300, kCategoryLabels[kUnknownIndex]);
+	Check(IsSequence(Detect(&recognizer, 30400, kWordB), "a b", 30000, 30400), "silence and unknown are ignored");
+}
+
+}  // namespace
+
+int main() {
+	CheckTableBuilder();
+	CheckPrefixSequences();
+	CheckGapsAndRestarts();
+	return ReportChecks("Command sequences");
+}
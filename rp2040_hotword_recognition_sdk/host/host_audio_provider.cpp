@@ -0,0 +1,36 @@
+#include "host_audio_provider.h"
+
+#include "audio_provider.h"
+#include "micro_features/micro_model_settings.h"
+
+namespace {
+const int16_t* g_host_audio_data = nullptr;
+int g_host_audio_data_size = 0;
+int32_t g_host_audio_timestamp = 0;
+int16_t g_audio_output_buffer[kMaxAudioSampleSize];
+}  // namespace
+
+void SetHostAudioData(const int16_t* samples, int sample_count) {
+	g_host_audio_data = samples;
+	g_host_audio_data_size = sample_count;
+}
+
+void SetHostAudioTimestamp(int32_t time_in_ms) { g_host_audio_timestamp = time_in_ms; }
+
+TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter, int start_ms, int duration_ms,
+                             int* audio_samples_size, int16_t** audio_samples) {
+	const int start_offset = start_ms * (kAudioSampleFrequency / 1000);
+	for (int i = 0; i < kMaxAudioSampleSize; ++i) {
+		const int sample_index = start_offset + i;
+		if ((sample_index >= 0) && (sample_index < g_host_audio_data_size)) {
+			g_audio_output_buffer[i] = g_host_audio_data[sample_index];
+		} else {
+			g_audio_output_buffer[i] = 0;
+		}
+	}
+	*audio_samples_size = kMaxAudioSampleSize;
+	*audio_samples = g_audio_output_buffer;
+	return kTfLiteOk;
+}
+
+int32_t LatestAudioTimestamp() { return g_host_audio_timestamp; }
@@ -0,0 +1,17 @@
+#ifndef HOST_AUDIO_PROVIDER_H_
+#define HOST_AUDIO_PROVIDER_H_
+
+#include <stdint.h>
+
+// Host implementation of audio_provider.h serving samples from memory instead
+// of the PDM microphone. Samples before the start or past the end of the data
+// read as zero.
+
+// Sets the 16 kHz mono audio returned by GetAudioSamples(). The data is not
+// copied and must outlive its use.
+void SetHostAudioData(const int16_t* samples, int sample_count);
+
+// Sets the value returned by LatestAudioTimestamp().
+void SetHostAudioTimestamp(int32_t time_in_ms);
+
+#endif
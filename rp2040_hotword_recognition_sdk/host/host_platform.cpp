@@ -0,0 +1,42 @@
+#include "host_platform.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include "fork_join.h"
+#include "micro_features/micro_features_generator.h"
+#include "tensorflow/lite/micro/cortex_m_generic/debug_log_callback.h"
+#include "tensorflow/lite/micro/micro_time.h"
+
+namespace {
+void debug_log_stdout(const char* s) { fputs(s, stdout); }
+}  // namespace
+
+void InitializeHostPlatform() { RegisterDebugLogCallback(debug_log_stdout); }
+
+// There is no persisted frontend state on the host, replays start cold
+bool LoadMicroFeaturesNoiseEstimates(uint32_t* estimates, int channel_count) { return false; }
+
+// There is no second core on the host, the parts of a job run one after the other
+bool IsForkJoinWorkerReady() { return false; }
+
+void ForkJoin(ForkJoinFunction function, void* arg) {
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		function(arg, part);
+	}
+}
+
+void SetForkJoinEnabled(bool enabled) {}
+
+namespace tflite {
+
+// Microsecond ticks, matching the 1 MHz timer used on the device
+int32_t ticks_per_second() { return 1000000; }
+
+int32_t GetCurrentTimeTicks() {
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return static_cast<int32_t>(
+	    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+}  // namespace tflite
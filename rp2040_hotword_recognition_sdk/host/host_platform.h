@@ -0,0 +1,10 @@
+#ifndef HOST_PLATFORM_H_
+#define HOST_PLATFORM_H_
+
+// Host replacements for the platform hooks the firmware gets from the pico-sdk
+// and the cortex_m_generic target of Tensorflow Lite Micro.
+
+// Routes Tensorflow Lite Micro logging to stdout.
+void InitializeHostPlatform();
+
+#endif
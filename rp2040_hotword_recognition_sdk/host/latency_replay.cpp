@@ -0,0 +1,286 @@
+// Replays audio through the firmware feature provider, model and recognizer on
+// the host and measures the detection latency of the long averaging window of
+// RecognizeCommands and of the early-commit path (src/early_commit.h) with the
+// parameters of src/config.h. Inference is gated by the voice activity measure
+// like on the device.
+//
+// Usage: latency_replay [file.wav ...]
+// Without arguments the yes/no test clips are replayed, separated by stretches
+// of low level noise, and the latency is measured from the end of each clip.
+// With WAV files, whose word positions are unknown, the time gained by each
+// confirmed commit over the long window detection is reported instead.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "config.h"
+#include "early_commit.h"
+#include "feature_provider.h"
+#include "host_audio_provider.h"
+#include "host_platform.h"
+#include "micro_features/micro_model_settings.h"
+#include "micro_speech_model_data.h"
+#include "parallel_kernels.h"
+#include "recognize_commands.h"
+#include "streaming_depthwise_conv.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "testdata/no_1000ms_audio_data.h"
+#include "testdata/yes_1000ms_audio_data.h"
+#include "wav_file.h"
+
+namespace {
+
+constexpr int kTensorArenaSize = 32 * 1024;
+uint8_t tensor_arena[kTensorArenaSize];
+int8_t feature_buffer[kFeatureElementCount];
+
+// Width and range of the latency histogram buckets
+constexpr int32_t kBucketMs = 100;
+constexpr int32_t kBucketMinMs = -1000;
+constexpr int32_t kBucketMaxMs = 1000;
+
+struct Word {
+	int label;
+	int32_t start_ms;
+	int32_t end_ms;
+};
+
+struct Detection {
+	int label;
+	int32_t time_ms;
+};
+
+int LabelIndex(const char* label) {
+	for (int i = 0; i < kCategoryCount; i++) {
+		if (strcmp(label, kCategoryLabels[i]) == 0) {
+			return i;
+		}
+	}
+	return kUnknownIndex;
+}
+
+void AppendNoise(std::vector<int16_t>* audio, int duration_ms, uint32_t* seed) {
+	const int count = duration_ms * (kAudioSampleFrequency / 1000);
+	for (int i = 0; i < count; i++) {
+		*seed = *seed * 1664525u + 1013904223u;
+		audio->push_back(static_cast<int16_t>(static_cast<int32_t>(*seed >> 24) - 128) / 4);
+	}
+}
+
+void AppendWord(std::vector<int16_t>* audio, std::vector<Word>* words, const char* label, const int16_t* clip,
+                int clip_size) {
+	const int32_t start_ms = audio->size() / (kAudioSampleFrequency / 1000);
+	audio->insert(audio->end(), clip, clip + clip_size);
+	words->push_back({LabelIndex(label), start_ms, start_ms + clip_size / (kAudioSampleFrequency / 1000)});
+}
+
+// Returns the first detection of the word, or nullptr
+const Detection* FindWordDetection(const Word& word, const std::vector<Detection>& detections) {
+	for (const Detection& detection : detections) {
+		if ((detection.label == word.label) && (detection.time_ms >= word.start_ms) &&
+		    (detection.time_ms <= word.end_ms + g_rec_average_window_duration_ms + g_early_commit_confirm_ms)) {
+			return &detection;
+		}
+	}
+	return nullptr;
+}
+
+// Prints minimum, median, 90th percentile and maximum of the latencies
+void PrintDistribution(const char* name, std::vector<int32_t> latencies) {
+	if (latencies.empty()) {
+		printf("%s: no detections\n", name);
+		return;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	const size_t count = latencies.size();
+	printf("%s: %d detections, min %+d ms, median %+d ms, p90 %+d ms, max %+d ms\n", name, (int)count,
+	       (int)latencies[0], (int)latencies[count / 2], (int)latencies[(count * 9) / 10], (int)latencies[count - 1]);
+}
+
+// Prints the latencies of both paths per histogram bucket
+void PrintHistogram(const std::vector<int32_t>& long_latencies, const std::vector<int32_t>& early_latencies) {
+	printf("Latency histogram (long window / early commit):\n");
+	for (int32_t bucket = kBucketMinMs; bucket < kBucketMaxMs; bucket += kBucketMs) {
+		const auto in_bucket = [bucket](int32_t latency) {
+			return ((latency >= bucket) || (bucket == kBucketMinMs)) &&
+			       ((latency < bucket + kBucketMs) || (bucket + kBucketMs >= kBucketMaxMs));
+		};
+		const int long_count = std::count_if(long_latencies.begin(), long_latencies.end(), in_bucket);
+		const int early_count = std::count_if(early_latencies.begin(), early_latencies.end(), in_bucket);
+		if ((long_count > 0) || (early_count > 0)) {
+			printf("  %+5d ms: %3d / %3d\n", (int)bucket, long_count, early_count);
+		}
+	}
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<int16_t> audio;
+	std::vector<Word> words;
+	if (argc > 1) {
+		for (int i = 1; i < argc; i++) {
+			std::vector<int16_t> samples;
+			int sample_rate = 0;
+			if (!ReadWavFile(argv[i], &samples, &sample_rate) || (sample_rate != kAudioSampleFrequency)) {
+				fprintf(stderr, "Could not read %s as 16 kHz 16 bit PCM WAV file\n", argv[i]);
+				return 1;
+			}
+			audio.insert(audio.end(), samples.begin(), samples.end());
+		}
+	} else {
+		uint32_t seed = 1;
+		for (int i = 0; i < 4; i++) {
+			AppendNoise(&audio, 3000, &seed);
+			AppendWord(&audio, &words, "yes", g_yes_1000ms_audio_data, g_yes_1000ms_audio_data_size);
+			AppendNoise(&audio, 3000, &seed);
+			AppendWord(&audio, &words, "no", g_no_1000ms_audio_data, g_no_1000ms_audio_data_size);
+		}
+		AppendNoise(&audio, 3000, &seed);
+	}
+	SetHostAudioData(audio.data(), audio.size());
+
+	// Same operators as the firmware
+	const tflite::Model* model = tflite::GetModel(g_micro_speech_model_data);
+#if PARALLEL_KERNELS
+	static ParallelOpResolver<4> micro_op_resolver(error_reporter, STREAMING_INFERENCE);
+#elif STREAMING_INFERENCE
+	static StreamingOpResolver<4> micro_op_resolver(error_reporter);
+#else
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+#endif
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize,
+	                                            error_reporter);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed\n");
+		return 1;
+	}
+
+	FeatureProvider feature_provider(kFeatureElementCount, feature_buffer);
+	RecognizeCommands recognizer(error_reporter, g_rec_average_window_duration_ms, g_rec_detection_threshold,
+	                             g_rec_suppression_ms, g_rec_minimum_count);
+	EarlyCommitRecognizer early_commit(error_reporter, g_early_commit_window_ms, g_early_commit_threshold,
+	                                   g_early_commit_confirm_ms, g_rec_suppression_ms);
+	for (const EarlyCommitThreshold& threshold : g_early_commit_thresholds) {
+		early_commit.SetThreshold(threshold.label, threshold.threshold);
+	}
+	int8_t silence_scores[kCategoryCount];
+	for (int i = 0; i < kCategoryCount; i++) {
+		silence_scores[i] = (i == kSilenceIndex) ? 127 : -128;
+	}
+
+	std::vector<Detection> long_detections;
+	std::vector<Detection> early_detections;
+	int commit_count = 0;
+	int retract_count = 0;
+	const int32_t duration_ms = audio.size() / (kAudioSampleFrequency / 1000);
+	int32_t previous_time = 0;
+	int32_t commit_time = 0;
+	for (int32_t current_time = kFeatureSliceStrideMs; current_time <= duration_ms;
+	     current_time += kFeatureSliceStrideMs) {
+		SetHostAudioTimestamp(current_time);
+		int how_many_new_slices = 0;
+		if (feature_provider.PopulateFeatureData(error_reporter, previous_time, current_time, &how_many_new_slices) !=
+		    kTfLiteOk) {
+			return 1;
+		}
+		previous_time = current_time;
+		if (how_many_new_slices == 0) {
+			continue;
+		}
+
+		const int8_t* scores = silence_scores;
+		if (!g_vad_enabled || (feature_provider.speech_slice_count() > 0)) {
+			memcpy(interpreter.input(0)->data.int8, feature_buffer, kFeatureElementCount);
+			if (interpreter.Invoke() != kTfLiteOk) {
+				fprintf(stderr, "Invoke failed\n");
+				return 1;
+			}
+			scores = interpreter.output(0)->data.int8;
+		}
+
+		const char* found_command = nullptr;
+		uint8_t score = 0;
+		bool is_new_command = false;
+		recognizer.ProcessLatestScores(scores, current_time, &found_command, &score, &is_new_command);
+		if (is_new_command && (LabelIndex(found_command) > kUnknownIndex)) {
+			long_detections.push_back({LabelIndex(found_command), current_time});
+		}
+		const char* early_command = nullptr;
+		uint8_t early_score = 0;
+		const EarlyCommitRecognizer::Event event = early_commit.Process(scores, current_time, found_command,
+		                                                                is_new_command, &early_command, &early_score);
+		if (event == EarlyCommitRecognizer::kCommitted) {
+			commit_count++;
+			commit_time = current_time;
+		} else if (event == EarlyCommitRecognizer::kConfirmed) {
+			// The confirmed keyword was reported at its commit
+			early_detections.push_back({LabelIndex(early_command), commit_time});
+			printf("  %-8s committed @%6dms (%d), confirmed @%6dms\n", early_command, (int)commit_time, early_score,
+			       (int)current_time);
+		} else if (event == EarlyCommitRecognizer::kRetracted) {
+			retract_count++;
+			printf("  %-8s committed @%6dms (%d), retracted @%6dms\n", early_command, (int)commit_time, early_score,
+			       (int)current_time);
+		}
+	}
+
+	printf("Audio: %d ms, early commit window %d ms, confirmation within %d ms\n", (int)duration_ms,
+	       (int)g_early_commit_window_ms, (int)g_early_commit_confirm_ms);
+	printf("Early commits: %d, %d confirmed, %d retracted\n", commit_count, (int)early_detections.size(),
+	       retract_count);
+	if (words.empty()) {
+		// Time gained by each confirmed commit over the long window detection it waited for
+		std::vector<int32_t> gains;
+		for (const Detection& early : early_detections) {
+			for (const Detection& detection : long_detections) {
+				if ((detection.label == early.label) && (detection.time_ms >= early.time_ms)) {
+					gains.push_back(detection.time_ms - early.time_ms);
+					break;
+				}
+			}
+		}
+		PrintDistribution("Early commit gain over long window", gains);
+		return 0;
+	}
+
+	// Latency from the end of each test clip to the detection of its word. With
+	// early commit a word is reported at its confirmed commit, or at the long
+	// window detection if it was not committed.
+	std::vector<int32_t> long_latencies;
+	std::vector<int32_t> early_latencies;
+	int missed = 0;
+	int committed = 0;
+	for (const Word& word : words) {
+		const Detection* detection = FindWordDetection(word, long_detections);
+		if (detection == nullptr) {
+			missed++;
+			continue;
+		}
+		long_latencies.push_back(detection->time_ms - word.end_ms);
+		const Detection* early = FindWordDetection(word, early_detections);
+		if (early != nullptr) {
+			committed++;
+			detection = early;
+		}
+		early_latencies.push_back(detection->time_ms - word.end_ms);
+	}
+	PrintHistogram(long_latencies, early_latencies);
+	PrintDistribution("Long window latency after clip end", long_latencies);
+	PrintDistribution("Early commit latency after clip end", early_latencies);
+	printf("Words: %d, %d missed, %d committed early\n", (int)words.size(), missed, committed);
+	return 0;
+}
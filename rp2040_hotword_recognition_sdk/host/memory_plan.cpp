@@ -0,0 +1,388 @@
+// Precomputes the placement of the model tensors in the tensor arena and embeds
+// it in the model as "OfflineMemoryAllocation" metadata, which the TFLM
+// allocator uses instead of planning the tensors at boot.
+//
+// Usage: memory_plan [--model model.tflite] [--tflite out.tflite] [--cpp out.cpp]
+// Without --model the model compiled into the firmware is planned. The planned
+// model is written as .tflite file and/or as C++ source like the model data
+// files in src. The arena size and AllocateTensors() time of the original and
+// the planned model are reported, and both are checked to give the same output.
+//
+// The tensor lifetimes follow the TFLM AllocationInfoBuilder. Instead of the
+// greedy order (largest tensor first), every placement order is tried for up to
+// kMaxExhaustiveTensors tensors and the one with the smallest arena is kept.
+// Scratch buffers of the kernels are still placed by the planner at boot.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "clip_features.h"
+#include "host_platform.h"
+#include "micro_features/micro_features_generator.h"
+#include "micro_features/micro_model_settings.h"
+#include "micro_speech_model_data.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "testdata/yes_1000ms_audio_data.h"
+
+namespace {
+
+constexpr char kOfflineMemoryAllocation[] = "OfflineMemoryAllocation";
+constexpr int32_t kOnlinePlannedBuffer = -1;
+constexpr int kBufferAlignment = 16;
+constexpr int kMaxExhaustiveTensors = 8;
+constexpr int kTensorArenaSize = 64 * 1024;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+
+struct PlannedTensor {
+	int index;
+	int size;
+	int first_created;
+	int last_used;
+	int offset;
+};
+
+int TensorTypeSize(tflite::TensorType type) {
+	switch (type) {
+		case tflite::TensorType_INT8:
+		case tflite::TensorType_UINT8:
+		case tflite::TensorType_BOOL:
+			return 1;
+		case tflite::TensorType_INT16:
+		case tflite::TensorType_FLOAT16:
+			return 2;
+		case tflite::TensorType_INT32:
+		case tflite::TensorType_FLOAT32:
+			return 4;
+		case tflite::TensorType_INT64:
+		case tflite::TensorType_FLOAT64:
+			return 8;
+		default:
+			return 0;
+	}
+}
+
+void UpdateLifetime(std::vector<PlannedTensor*>& by_index, int tensor_index, int scope, bool created) {
+	if ((tensor_index < 0) || (by_index[tensor_index] == nullptr)) {
+		return;
+	}
+	PlannedTensor* tensor = by_index[tensor_index];
+	if (created && (tensor->first_created < 0)) {
+		tensor->first_created = scope;
+	}
+	tensor->last_used = std::max(tensor->last_used, scope);
+}
+
+// Collects the tensors of the first subgraph that live in the arena with their
+// lifetimes, numbered like in the AllocationInfoBuilder
+std::vector<PlannedTensor> CollectTensors(const tflite::Model* model) {
+	const tflite::SubGraph* subgraph = model->subgraphs()->Get(0);
+	std::vector<PlannedTensor> tensors;
+	for (size_t i = 0; i < subgraph->tensors()->size(); i++) {
+		const tflite::Tensor* tensor = subgraph->tensors()->Get(i);
+		const tflite::Buffer* buffer = model->buffers()->Get(tensor->buffer());
+		const bool is_constant = (buffer->data() != nullptr) && (buffer->data()->size() > 0);
+		if (is_constant || tensor->is_variable()) {
+			continue;
+		}
+		int size = TensorTypeSize(tensor->type());
+		for (size_t d = 0; (tensor->shape() != nullptr) && (d < tensor->shape()->size()); d++) {
+			size *= tensor->shape()->Get(d);
+		}
+		size = ((size + kBufferAlignment - 1) / kBufferAlignment) * kBufferAlignment;
+		tensors.push_back({static_cast<int>(i), size, -1, -1, 0});
+	}
+	std::vector<PlannedTensor*> by_index(subgraph->tensors()->size(), nullptr);
+	for (PlannedTensor& tensor : tensors) {
+		by_index[tensor.index] = &tensor;
+	}
+
+	int scope = 0;
+	for (size_t i = 0; i < subgraph->inputs()->size(); i++) {
+		UpdateLifetime(by_index, subgraph->inputs()->Get(i), scope, true);
+	}
+	for (size_t i = 0; i < subgraph->operators()->size(); i++) {
+		const tflite::Operator* op = subgraph->operators()->Get(i);
+		scope++;
+		for (size_t n = 0; n < op->outputs()->size(); n++) {
+			UpdateLifetime(by_index, op->outputs()->Get(n), scope, true);
+		}
+		for (size_t n = 0; n < op->inputs()->size(); n++) {
+			UpdateLifetime(by_index, op->inputs()->Get(n), scope, false);
+		}
+	}
+	for (size_t i = 0; i < subgraph->outputs()->size(); i++) {
+		UpdateLifetime(by_index, subgraph->outputs()->Get(i), scope, false);
+	}
+	return tensors;
+}
+
+bool LifetimesOverlap(const PlannedTensor& a, const PlannedTensor& b) {
+	return (a.first_created <= b.last_used) && (b.first_created <= a.last_used);
+}
+
+// Places the tensors in the given order, each at the lowest offset that does not
+// collide with an already placed tensor alive at the same time. Returns the
+// arena size.
+int PlaceTensors(std::vector<PlannedTensor>& tensors, const std::vector<int>& order) {
+	int arena_size = 0;
+	for (size_t i = 0; i < order.size(); i++) {
+		PlannedTensor& tensor = tensors[order[i]];
+		std::vector<int> candidates(1, 0);
+		for (size_t j = 0; j < i; j++) {
+			const PlannedTensor& other = tensors[order[j]];
+			if (LifetimesOverlap(tensor, other)) {
+				candidates.push_back(other.offset + other.size);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		for (int offset : candidates) {
+			bool fits = true;
+			for (size_t j = 0; j < i; j++) {
+				const PlannedTensor& other = tensors[order[j]];
+				if (LifetimesOverlap(tensor, other) && (offset < other.offset + other.size) &&
+				    (other.offset < offset + tensor.size)) {
+					fits = false;
+					break;
+				}
+			}
+			if (fits) {
+				tensor.offset = offset;
+				break;
+			}
+		}
+		arena_size = std::max(arena_size, tensor.offset + tensor.size);
+	}
+	return arena_size;
+}
+
+// Returns the arena size of the best placement found, tensors hold its offsets
+int PlanTensors(std::vector<PlannedTensor>& tensors, int* greedy_size) {
+	std::vector<int> order(tensors.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	// Greedy order of the TFLM planner: largest first, earlier created first
+	std::stable_sort(order.begin(), order.end(), [&tensors](int a, int b) {
+		return tensors[a].size > tensors[b].size;
+	});
+	std::vector<int> best_order = order;
+	int best_size = PlaceTensors(tensors, order);
+	*greedy_size = best_size;
+	if (tensors.size() <= kMaxExhaustiveTensors) {
+		std::sort(order.begin(), order.end());
+		do {
+			const int size = PlaceTensors(tensors, order);
+			if (size < best_size) {
+				best_size = size;
+				best_order = order;
+			}
+		} while (std::next_permutation(order.begin(), order.end()));
+	}
+	PlaceTensors(tensors, best_order);
+	return best_size;
+}
+
+// Returns a copy of the model with the offsets as OfflineMemoryAllocation
+// metadata: version, subgraph, tensor count and one offset per tensor.
+std::vector<uint8_t> EmbedPlan(const tflite::Model* model, const std::vector<PlannedTensor>& tensors) {
+	std::unique_ptr<tflite::ModelT> model_object(model->UnPack());
+	const size_t tensor_count = model->subgraphs()->Get(0)->tensors()->size();
+	std::vector<int32_t> plan(3 + tensor_count, kOnlinePlannedBuffer);
+	plan[0] = 1;
+	plan[1] = 0;
+	plan[2] = tensor_count;
+	for (const PlannedTensor& tensor : tensors) {
+		plan[3 + tensor.index] = tensor.offset;
+	}
+
+	std::unique_ptr<tflite::BufferT> buffer(new tflite::BufferT());
+	for (int32_t value : plan) {
+		for (int i = 0; i < 4; i++) {
+			buffer->data.push_back((static_cast<uint32_t>(value) >> (8 * i)) & 0xff);
+		}
+	}
+	// Replace a plan embedded before
+	std::vector<std::unique_ptr<tflite::MetadataT>>& metadata = model_object->metadata;
+	metadata.erase(std::remove_if(metadata.begin(), metadata.end(),
+	                              [](const std::unique_ptr<tflite::MetadataT>& entry) {
+		                              return entry->name == kOfflineMemoryAllocation;
+	                              }),
+	               metadata.end());
+	std::unique_ptr<tflite::MetadataT> entry(new tflite::MetadataT());
+	entry->name = kOfflineMemoryAllocation;
+	entry->buffer = model_object->buffers.size();
+	model_object->buffers.push_back(std::move(buffer));
+	metadata.push_back(std::move(entry));
+
+	// The flatbuffers copy of TFLM has no implicit default allocator
+	flatbuffers::DefaultAllocator allocator;
+	flatbuffers::FlatBufferBuilder builder(1024, &allocator);
+	tflite::FinishModelBuffer(builder, tflite::Model::Pack(builder, model_object.get()));
+	return std::vector<uint8_t>(builder.GetBufferPointer(), builder.GetBufferPointer() + builder.GetSize());
+}
+
+struct AllocationResult {
+	bool ok;
+	int arena_used_bytes;
+	double allocate_us;
+	std::vector<int8_t> output;
+};
+
+// Allocates the model repeatedly to time AllocateTensors() and runs it once on
+// the features
+AllocationResult AllocateModel(tflite::ErrorReporter* error_reporter, const tflite::Model* model,
+                               const tflite::MicroOpResolver& micro_op_resolver, const int8_t* features) {
+	AllocationResult result = {false, 0, 0.0, {}};
+	constexpr int kRuns = 200;
+	for (int run = 0; run < kRuns; run++) {
+		tflite::MicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize, error_reporter);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (interpreter.AllocateTensors() != kTfLiteOk) {
+			return result;
+		}
+		result.allocate_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		if (run == kRuns - 1) {
+			result.arena_used_bytes = interpreter.arena_used_bytes();
+			memcpy(interpreter.input(0)->data.int8, features, kFeatureElementCount);
+			if (interpreter.Invoke() != kTfLiteOk) {
+				return result;
+			}
+			const TfLiteTensor* output = interpreter.output(0);
+			result.output.assign(output->data.int8, output->data.int8 + output->bytes);
+		}
+	}
+	result.allocate_us /= kRuns;
+	result.ok = true;
+	return result;
+}
+
+bool WriteFile(const char* path, const std::string& data) {
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+	return (fclose(file) == 0) && written;
+}
+
+// Formats the model like the model data files in src
+std::string ModelSource(const std::vector<uint8_t>& model_data, const char* source) {
+	std::string text = std::string("// Generated by host/memory_plan.cpp from ") + source + ", do not edit\n";
+	text += "#include <cstdint>\n#include \"micro_speech_model_data.h\"\n";
+	text += "alignas(16) const unsigned char g_micro_speech_model_data[] = {\n";
+	char value[8];
+	for (size_t i = 0; i < model_data.size(); i++) {
+		snprintf(value, sizeof(value), "0x%02x", model_data[i]);
+		text += ((i % 12) == 0) ? "  " : " ";
+		text += value;
+		text += (i + 1 == model_data.size()) ? "\n" : (((i % 12) == 11) ? ",\n" : ",");
+	}
+	text += "};\nconst unsigned int g_micro_speech_model_data_size = " + std::to_string(model_data.size()) + ";\n";
+	return text;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* model_path = nullptr;
+	const char* tflite_path = nullptr;
+	const char* cpp_path = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--model") == 0) && (i + 1 < argc)) {
+			model_path = argv[++i];
+		} else if ((strcmp(argv[i], "--tflite") == 0) && (i + 1 < argc)) {
+			tflite_path = argv[++i];
+		} else if ((strcmp(argv[i], "--cpp") == 0) && (i + 1 < argc)) {
+			cpp_path = argv[++i];
+		} else {
+			fprintf(stderr, "Usage: %s [--model model.tflite] [--tflite out.tflite] [--cpp out.cpp]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<uint8_t> model_file;
+	const uint8_t* model_data = g_micro_speech_model_data;
+	if (model_path != nullptr) {
+		FILE* file = fopen(model_path, "rb");
+		if (file == nullptr) {
+			fprintf(stderr, "Could not open %s\n", model_path);
+			return 1;
+		}
+		uint8_t buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			model_file.insert(model_file.end(), buffer, buffer + read);
+		}
+		fclose(file);
+		model_data = model_file.data();
+	}
+	const tflite::Model* model = tflite::GetModel(model_data);
+
+	std::vector<PlannedTensor> tensors = CollectTensors(model);
+	int greedy_size = 0;
+	const int planned_size = PlanTensors(tensors, &greedy_size);
+	printf("Tensor plan: %d bytes (greedy order: %d bytes)\n", planned_size, greedy_size);
+	for (const PlannedTensor& tensor : tensors) {
+		printf("  tensor %2d: offset %5d, %5d bytes, operators %d to %d\n", tensor.index, tensor.offset, tensor.size,
+		       tensor.first_created, tensor.last_used);
+	}
+
+	const std::vector<uint8_t> planned_data = EmbedPlan(model, tensors);
+	const tflite::Model* planned_model = tflite::GetModel(planned_data.data());
+
+	// Same operators as the firmware
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	{
+		tflite::MicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize, error_reporter);
+		if (interpreter.AllocateTensors() != kTfLiteOk) {
+			fprintf(stderr, "AllocateTensors() failed\n");
+			return 1;
+		}
+		const TfLiteTensor* input = interpreter.input(0);
+		SetMicroFeaturesInputQuantization(input->params.scale, input->params.zero_point);
+	}
+	int8_t features[kFeatureElementCount];
+	GenerateClipFeatures(error_reporter, g_yes_1000ms_audio_data, g_yes_1000ms_audio_data_size, features);
+	const AllocationResult reference = AllocateModel(error_reporter, model, micro_op_resolver, features);
+	const AllocationResult planned = AllocateModel(error_reporter, planned_model, micro_op_resolver, features);
+	if (!reference.ok || !planned.ok) {
+		fprintf(stderr, "Allocating or running the model failed\n");
+		return 1;
+	}
+	if (planned.output != reference.output) {
+		fprintf(stderr, "The planned model gives a different output\n");
+		return 1;
+	}
+	printf("Arena: %d bytes online planned, %d bytes offline planned\n", reference.arena_used_bytes,
+	       planned.arena_used_bytes);
+	printf("AllocateTensors: %.1f us online planned, %.1f us offline planned\n", reference.allocate_us,
+	       planned.allocate_us);
+
+	const std::string planned_bytes(planned_data.begin(), planned_data.end());
+	if ((tflite_path != nullptr) && !WriteFile(tflite_path, planned_bytes)) {
+		fprintf(stderr, "Could not write %s\n", tflite_path);
+		return 1;
+	}
+	if ((cpp_path != nullptr) &&
+	    !WriteFile(cpp_path, ModelSource(planned_data, model_path != nullptr ? model_path : "the compiled in model"))) {
+		fprintf(stderr, "Could not write %s\n", cpp_path);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,378 @@
+// Benchmarks a model on the host: input size, multiply-accumulate operations of
+// the convolution and fully connected layers, invoke time and, given a speech
+// commands style dataset directory (one subdirectory of WAV clips per label),
+// the accuracy on features generated like on the device. The streaming
+// convolution is checked against the full one on a window sliding over the test
+// clip, the parallel kernels against the CMSIS-NN ones on the clip and random
+// windows, and the compiled model (host/model_compiler.cpp) against the
+// interpreter on the same windows.
+//
+// Usage: model_benchmark [--model model.tflite] [--runs N] [--data dir] [--limit N]
+// Without --model the model compiled into the firmware is used. The features
+// follow the firmware settings, so MFCC models need a host build with the
+// matching MFCC_COEFFICIENTS. The compiled model is only checked for the model
+// compiled into the firmware.
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "clip_features.h"
+#include "compiled_model.h"
+#include "host_platform.h"
+#include "micro_features/micro_features_generator.h"
+#include "micro_features/micro_model_settings.h"
+#include "micro_speech_model_data.h"
+#include "parallel_kernels.h"
+#include "stats_profiler.h"
+#include "streaming_depthwise_conv.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+#include "testdata/yes_1000ms_audio_data.h"
+#include "wav_file.h"
+
+namespace {
+
+constexpr int kTensorArenaSize = 64 * 1024;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+alignas(16) uint8_t streaming_arena[kTensorArenaSize];
+alignas(16) uint8_t parallel_arena[kTensorArenaSize];
+int8_t features[kFeatureElementCount];
+
+int64_t ShapeElements(const flatbuffers::Vector<int32_t>* shape) {
+	int64_t count = 1;
+	for (size_t i = 0; i < shape->size(); i++) {
+		count *= shape->Get(i);
+	}
+	return count;
+}
+
+// Prints the multiply-accumulate operations of every compute heavy layer
+int64_t PrintLayerMacs(const tflite::Model* model) {
+	const tflite::SubGraph* subgraph = model->subgraphs()->Get(0);
+	int64_t total_macs = 0;
+	for (size_t i = 0; i < subgraph->operators()->size(); i++) {
+		const tflite::Operator* op = subgraph->operators()->Get(i);
+		const tflite::BuiltinOperator code = tflite::GetBuiltinCode(model->operator_codes()->Get(op->opcode_index()));
+		const flatbuffers::Vector<int32_t>* output_shape = subgraph->tensors()->Get(op->outputs()->Get(0))->shape();
+		const flatbuffers::Vector<int32_t>* weights_shape =
+		    op->inputs()->size() > 1 ? subgraph->tensors()->Get(op->inputs()->Get(1))->shape() : nullptr;
+		int64_t macs = 0;
+		if (code == tflite::BuiltinOperator_DEPTHWISE_CONV_2D) {
+			// Each output element takes kernel height * width products
+			macs = ShapeElements(output_shape) * weights_shape->Get(1) * weights_shape->Get(2);
+		} else if (code == tflite::BuiltinOperator_CONV_2D) {
+			macs = ShapeElements(output_shape) * weights_shape->Get(1) * weights_shape->Get(2) * weights_shape->Get(3);
+		} else if (code == tflite::BuiltinOperator_FULLY_CONNECTED) {
+			macs = ShapeElements(output_shape) * weights_shape->Get(1);
+		} else {
+			continue;
+		}
+		printf("  %-20s %8lld MACs\n", tflite::EnumNameBuiltinOperator(code), (long long)macs);
+		total_macs += macs;
+	}
+	return total_macs;
+}
+
+int LabelIndex(const char* label) {
+	for (int i = 0; i < kCategoryCount; i++) {
+		if (strcmp(label, kCategoryLabels[i]) == 0) {
+			return i;
+		}
+	}
+	return kUnknownIndex;
+}
+
+std::vector<std::string> ListDirectory(const std::string& path) {
+	std::vector<std::string> entries;
+	DIR* dir = opendir(path.c_str());
+	if (dir == nullptr) {
+		return entries;
+	}
+	while (struct dirent* entry = readdir(dir)) {
+		if (entry->d_name[0] != '.') {
+			entries.push_back(entry->d_name);
+		}
+	}
+	closedir(dir);
+	return entries;
+}
+
+// Slides the window over silence, the clip features and silence again, one slice
+// per step and three slices every tenth step like a loop catching up, and
+// compares the model with streaming convolution against the full model
+bool BenchmarkStreaming(tflite::ErrorReporter* error_reporter, const tflite::Model* model,
+                        tflite::MicroInterpreter* full_interpreter, const int8_t* clip_features) {
+	static StreamingOpResolver<4> micro_op_resolver(error_reporter);
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, streaming_arena, kTensorArenaSize,
+	                                            error_reporter);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed for streaming inference\n");
+		return false;
+	}
+
+	std::vector<int8_t> slices(3 * kFeatureElementCount, GetMicroFeaturesSilenceValue());
+	memcpy(&slices[kFeatureElementCount], clip_features, kFeatureElementCount);
+	int32_t computed_rows_before;
+	int32_t cached_rows_before;
+	GetStreamingConvRowCounts(&computed_rows_before, &cached_rows_before);
+	int window_count = 0;
+	int max_difference = 0;
+	double full_us = 0.0;
+	double streaming_us = 0.0;
+	for (int start = 0; start + kFeatureSliceCount <= 3 * kFeatureSliceCount;
+	     start += (window_count % 10 == 9) ? 3 : 1, window_count++) {
+		const int8_t* window = &slices[start * kFeatureSliceSize];
+		memcpy(full_interpreter->input(0)->data.int8, window, kFeatureElementCount);
+		memcpy(interpreter.input(0)->data.int8, window, kFeatureElementCount);
+		std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+		full_interpreter->Invoke();
+		full_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - time).count();
+		time = std::chrono::steady_clock::now();
+		interpreter.Invoke();
+		streaming_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - time).count();
+		for (int i = 0; i < kCategoryCount; i++) {
+			max_difference = std::max(max_difference, std::abs(full_interpreter->output(0)->data.int8[i] -
+			                                                   interpreter.output(0)->data.int8[i]));
+		}
+	}
+	int32_t computed_rows;
+	int32_t cached_rows;
+	GetStreamingConvRowCounts(&computed_rows, &cached_rows);
+	computed_rows -= computed_rows_before;
+	cached_rows -= cached_rows_before;
+	printf("Streaming: %d windows, %d of %d convolution rows computed, max score difference %d\n", window_count,
+	       (int)computed_rows, (int)(computed_rows + cached_rows), max_difference);
+	printf("  Invoke %.1f us (full %.1f us), arena used %d bytes (full %d bytes)\n", streaming_us / window_count,
+	       full_us / window_count, (int)interpreter.arena_used_bytes(), (int)full_interpreter->arena_used_bytes());
+	return max_difference == 0;
+}
+
+// Compares the parallel kernels with the CMSIS-NN kernels. The host has no
+// second core, so both parts of every job run one after the other.
+bool CheckParallelKernels(tflite::ErrorReporter* error_reporter, const tflite::Model* model,
+                          tflite::MicroInterpreter* full_interpreter, const int8_t* clip_features) {
+	static ParallelOpResolver<4> micro_op_resolver(error_reporter);
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, parallel_arena, kTensorArenaSize,
+	                                            error_reporter);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed for the parallel kernels\n");
+		return false;
+	}
+
+	constexpr int kWindowCount = 20;
+	std::vector<int8_t> window(clip_features, clip_features + kFeatureElementCount);
+	uint32_t random = 1;
+	int max_difference = 0;
+	for (int i = 0; i < kWindowCount; i++) {
+		memcpy(full_interpreter->input(0)->data.int8, window.data(), kFeatureElementCount);
+		memcpy(interpreter.input(0)->data.int8, window.data(), kFeatureElementCount);
+		full_interpreter->Invoke();
+		interpreter.Invoke();
+		for (int j = 0; j < kCategoryCount; j++) {
+			max_difference = std::max(max_difference, std::abs(full_interpreter->output(0)->data.int8[j] -
+			                                                   interpreter.output(0)->data.int8[j]));
+		}
+		for (int j = 0; j < kFeatureElementCount; j++) {
+			random = random * 1103515245 + 12345;
+			window[j] = static_cast<int8_t>(random >> 24);
+		}
+	}
+	printf("Parallel kernels: %d windows, max score difference %d, arena used %d bytes\n", kWindowCount,
+	       max_difference, (int)interpreter.arena_used_bytes());
+	return max_difference == 0;
+}
+
+// Compares the compiled model with the interpreter and reports the invoke time
+// of both
+bool CheckCompiledModel(tflite::MicroInterpreter* full_interpreter, const int8_t* clip_features) {
+	if ((g_compiled_model_input_size != kFeatureElementCount) || (g_compiled_model_output_size != kCategoryCount)) {
+		fprintf(stderr, "Compiled model does not match the feature settings\n");
+		return false;
+	}
+	constexpr int kWindowCount = 20;
+	std::vector<int8_t> window(clip_features, clip_features + kFeatureElementCount);
+	int8_t scores[kCategoryCount];
+	uint32_t random = 1;
+	int max_difference = 0;
+	double interpreter_us = 0.0;
+	double compiled_us = 0.0;
+	for (int i = 0; i < kWindowCount; i++) {
+		memcpy(full_interpreter->input(0)->data.int8, window.data(), kFeatureElementCount);
+		std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+		full_interpreter->Invoke();
+		interpreter_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - time).count();
+		time = std::chrono::steady_clock::now();
+		if (!CompiledModelInvoke(window.data(), scores)) {
+			fprintf(stderr, "Compiled model failed\n");
+			return false;
+		}
+		compiled_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - time).count();
+		for (int j = 0; j < kCategoryCount; j++) {
+			max_difference = std::max(max_difference, std::abs(full_interpreter->output(0)->data.int8[j] - scores[j]));
+		}
+		for (int j = 0; j < kFeatureElementCount; j++) {
+			random = random * 1103515245 + 12345;
+			window[j] = static_cast<int8_t>(random >> 24);
+		}
+	}
+	printf("Compiled model: %d windows, max score difference %d, buffers %d bytes\n", kWindowCount, max_difference,
+	       g_compiled_model_buffer_size);
+	printf("  Invoke %.1f us (interpreter %.1f us)\n", compiled_us / kWindowCount, interpreter_us / kWindowCount);
+	return max_difference == 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* model_path = nullptr;
+	const char* data_path = nullptr;
+	int runs = 100;
+	int limit = 0;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--model") == 0) && (i + 1 < argc)) {
+			model_path = argv[++i];
+		} else if ((strcmp(argv[i], "--data") == 0) && (i + 1 < argc)) {
+			data_path = argv[++i];
+		} else if ((strcmp(argv[i], "--runs") == 0) && (i + 1 < argc)) {
+			runs = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "--limit") == 0) && (i + 1 < argc)) {
+			limit = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Usage: %s [--model model.tflite] [--runs N] [--data dir] [--limit N]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<uint8_t> model_file;
+	const uint8_t* model_data = g_micro_speech_model_data;
+	if (model_path != nullptr) {
+		FILE* file = fopen(model_path, "rb");
+		if (file == nullptr) {
+			fprintf(stderr, "Could not open %s\n", model_path);
+			return 1;
+		}
+		uint8_t buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			model_file.insert(model_file.end(), buffer, buffer + read);
+		}
+		fclose(file);
+		model_data = model_file.data();
+	}
+	const tflite::Model* model = tflite::GetModel(model_data);
+
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	static StatsProfiler profiler;
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize,
+	                                            error_reporter, nullptr, &profiler);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed\n");
+		return 1;
+	}
+	TfLiteTensor* input = interpreter.input(0);
+	if ((input->dims->data[input->dims->size - 1] != kFeatureElementCount) ||
+	    (interpreter.output(0)->dims->data[1] != kCategoryCount)) {
+		fprintf(stderr, "Model does not match the feature settings (%d inputs, %d categories)\n",
+		        kFeatureElementCount, kCategoryCount);
+		return 1;
+	}
+	SetMicroFeaturesInputQuantization(input->params.scale, input->params.zero_point);
+
+	printf("Input: %d x %d = %d features\n", kFeatureSliceCount, kFeatureSliceSize, kFeatureElementCount);
+	const int64_t total_macs = PrintLayerMacs(model);
+	printf("  %-20s %8lld MACs\n", "total", (long long)total_macs);
+	printf("Arena used: %d bytes\n", (int)interpreter.arena_used_bytes());
+
+	GenerateClipFeatures(error_reporter, g_yes_1000ms_audio_data, g_yes_1000ms_audio_data_size, features);
+	memcpy(input->data.int8, features, kFeatureElementCount);
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++) {
+		interpreter.Invoke();
+	}
+	const double invoke_us =
+	    std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+	printf("Invoke: %.1f us (mean of %d runs)\n", invoke_us, runs);
+	StatsProfiler::TagStats stats[StatsProfiler::kMaxTags];
+	const int tag_count = profiler.GetStats(stats, StatsProfiler::kMaxTags);
+	for (int i = 0; i < tag_count; i++) {
+		printf("  %-20s min %5d us, mean %5d us, max %5d us, p99 %5d us (latest %d)\n", stats[i].tag,
+		       stats[i].min_ticks, stats[i].mean_ticks, stats[i].max_ticks, stats[i].p99_ticks, stats[i].count);
+	}
+	if (!BenchmarkStreaming(error_reporter, model, &interpreter, features)) {
+		fprintf(stderr, "Streaming inference differs from the full inference\n");
+		return 1;
+	}
+	if (!CheckParallelKernels(error_reporter, model, &interpreter, features)) {
+		fprintf(stderr, "Parallel kernels differ from the CMSIS-NN kernels\n");
+		return 1;
+	}
+	if ((model_path == nullptr) && !CheckCompiledModel(&interpreter, features)) {
+		fprintf(stderr, "Compiled model differs from the interpreter\n");
+		return 1;
+	}
+
+	if (data_path == nullptr) {
+		return 0;
+	}
+	int correct = 0;
+	int total = 0;
+	for (const std::string& label : ListDirectory(data_path)) {
+		if (label[0] == '_') {
+			continue;  // _background_noise_
+		}
+		const int expected = LabelIndex(label.c_str());
+		int count = 0;
+		for (const std::string& name : ListDirectory(std::string(data_path) + "/" + label)) {
+			if ((limit > 0) && (count >= limit)) {
+				break;
+			}
+			std::vector<int16_t> samples;
+			int sample_rate = 0;
+			if (!ReadWavFile((std::string(data_path) + "/" + label + "/" + name).c_str(), &samples, &sample_rate) ||
+			    (sample_rate != kAudioSampleFrequency)) {
+				continue;
+			}
+			GenerateClipFeatures(error_reporter, samples.data(), samples.size(), features);
+			memcpy(input->data.int8, features, kFeatureElementCount);
+			interpreter.Invoke();
+			const int8_t* scores = interpreter.output(0)->data.int8;
+			int top = 0;
+			for (int i = 1; i < kCategoryCount; i++) {
+				if (scores[i] > scores[top]) {
+					top = i;
+				}
+			}
+			correct += (top == expected);
+			total++;
+			count++;
+		}
+	}
+	printf("Accuracy: %.2f%% (%d of %d clips)\n", total > 0 ? 100.0 * correct / total : 0.0, correct, total);
+	return 0;
+}
@@ -0,0 +1,524 @@
+// Compiles the model into a C++ inference function without interpreter (see
+// COMPILED_MODEL in ../CMakeLists.txt). The generated CompiledModelInvoke()
+// calls the CMSIS-NN routines of the TFLM kernels one after the other, with the
+// shapes, quantization parameters and weights written as constants and the
+// intermediate tensors in static buffers. The parameters are computed by the
+// same TFLM functions the kernels use at boot, so the scores are identical to
+// the interpreter (checked by model_benchmark).
+//
+// Usage: model_compiler [--model model.tflite] [compiled_model.cpp]
+// Without --model the compiled in model is compiled. Only int8 models made of
+// the operators of the firmware (RESHAPE, DEPTHWISE_CONV_2D, FULLY_CONNECTED
+// with 2D output and SOFTMAX) are supported.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CMSIS/NN/Include/arm_nnfunctions.h"
+#include "host_platform.h"
+#include "micro_speech_model_data.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/fully_connected.h"
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+
+namespace {
+
+constexpr int kTensorArenaSize = 64 * 1024;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+constexpr int kValuesPerLine = 12;
+// Integer bits of the input differences in the int8 softmax, as in the kernel
+constexpr int kScaledDiffIntegerBits = 5;
+
+// Generated source, collected per section while walking the operators
+struct Compilation {
+	std::string constants;
+	std::string buffers;
+	std::string body;
+	// Expression of the data of every tensor produced so far
+	std::vector<std::string> tensor_data;
+	int weight_bytes = 0;
+	int buffer_bytes = 0;
+	int scratch_bytes = 0;
+	bool uses_memcpy = false;
+};
+
+void Appendf(std::string* text, const char* format, ...) {
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	text->append(line);
+}
+
+template <typename T>
+void AppendArray(std::string* text, const char* declaration, const char* name, const T* values, int count) {
+	Appendf(text, "%s %s[%d] = {", declaration, name, count);
+	for (int i = 0; i < count; i++) {
+		text->append(i == 0 ? "" : ",");
+		text->append(i % kValuesPerLine == 0 ? "\n\t" : " ");
+		Appendf(text, "%d", (int)values[i]);
+	}
+	text->append("};\n");
+}
+
+void AppendDims(std::string* text, const char* name, int n, int h, int w, int c) {
+	Appendf(text, "constexpr cmsis_nn_dims %s = {%d, %d, %d, %d};\n", name, n, h, w, c);
+}
+
+bool ConvertActivation(tflite::ActivationFunctionType type, TfLiteFusedActivation* activation) {
+	switch (type) {
+		case tflite::ActivationFunctionType_NONE:
+			*activation = kTfLiteActNone;
+			return true;
+		case tflite::ActivationFunctionType_RELU:
+			*activation = kTfLiteActRelu;
+			return true;
+		case tflite::ActivationFunctionType_RELU_N1_TO_1:
+			*activation = kTfLiteActReluN1To1;
+			return true;
+		case tflite::ActivationFunctionType_RELU6:
+			*activation = kTfLiteActRelu6;
+			return true;
+		default:
+			fprintf(stderr, "Unsupported fused activation %s\n", tflite::EnumNameActivationFunctionType(type));
+			return false;
+	}
+}
+
+// Operator tensors, TfLiteTensors with quantization parameters allocated by the
+// interpreter and released at the end of the operator
+class OperatorTensors {
+ public:
+	OperatorTensors(TfLiteContext* context, const tflite::Operator* op) : context_(context), op_(op) {}
+	~OperatorTensors() {
+		for (TfLiteTensor* tensor : tensors_) {
+			tflite::GetMicroContext(context_)->DeallocateTempTfLiteTensor(tensor);
+		}
+	}
+
+	// Input or nullptr if the optional input is missing
+	TfLiteTensor* Input(int index) {
+		if ((index >= (int)op_->inputs()->size()) || (op_->inputs()->Get(index) < 0)) {
+			return nullptr;
+		}
+		return Get(op_->inputs()->Get(index));
+	}
+	TfLiteTensor* Output() { return Get(op_->outputs()->Get(0)); }
+
+ private:
+	TfLiteTensor* Get(int tensor_index) {
+		TfLiteTensor* tensor = context_->GetTensor(context_, tensor_index);
+		tensors_.push_back(tensor);
+		return tensor;
+	}
+
+	TfLiteContext* context_;
+	const tflite::Operator* op_;
+	std::vector<TfLiteTensor*> tensors_;
+};
+
+// MicroInterpreter giving access to the context, whose GetTensor() returns the
+// tensors with their quantization parameters
+class ContextInterpreter : public tflite::MicroInterpreter {
+ public:
+	using tflite::MicroInterpreter::MicroInterpreter;
+	TfLiteContext* mutable_context() { return const_cast<TfLiteContext*>(&context()); }
+};
+
+bool IsInt8(const TfLiteTensor* tensor) { return (tensor != nullptr) && (tensor->type == kTfLiteInt8); }
+
+// Returns the expression of the operator output data, a static buffer unless
+// it is the model output
+std::string OutputData(const tflite::SubGraph* subgraph, int tensor_index, const TfLiteTensor* tensor,
+                       Compilation* compilation) {
+	if (tensor_index == subgraph->outputs()->Get(0)) {
+		compilation->tensor_data[tensor_index] = "output";
+	} else {
+		const std::string name = "tensor" + std::to_string(tensor_index);
+		Appendf(&compilation->buffers, "alignas(16) int8_t %s[%d];\n", name.c_str(), (int)tensor->bytes);
+		compilation->buffer_bytes += tensor->bytes;
+		compilation->tensor_data[tensor_index] = name;
+	}
+	return compilation->tensor_data[tensor_index];
+}
+
+bool CompileReshape(const tflite::SubGraph* subgraph, const tflite::Operator* op, OperatorTensors* tensors,
+                    Compilation* compilation) {
+	const TfLiteTensor* input = tensors->Input(0);
+	const TfLiteTensor* output = tensors->Output();
+	if (!IsInt8(input) || !IsInt8(output) || (input->bytes != output->bytes)) {
+		fprintf(stderr, "RESHAPE needs int8 tensors of the same size\n");
+		return false;
+	}
+	const std::string& input_data = compilation->tensor_data[op->inputs()->Get(0)];
+	const int output_index = op->outputs()->Get(0);
+	if (output_index == subgraph->outputs()->Get(0)) {
+		Appendf(&compilation->body, "\tmemcpy(output, %s, %d);\n", input_data.c_str(), (int)output->bytes);
+		compilation->tensor_data[output_index] = "output";
+		compilation->uses_memcpy = true;
+	} else {
+		// Same data in another shape
+		compilation->tensor_data[output_index] = input_data;
+	}
+	return true;
+}
+
+bool CompileDepthwiseConv(TfLiteContext* context, const tflite::SubGraph* subgraph, const tflite::Operator* op,
+                          int op_index, OperatorTensors* tensors, Compilation* compilation) {
+	const tflite::DepthwiseConv2DOptions* options = op->builtin_options_as_DepthwiseConv2DOptions();
+	TfLiteTensor* input = tensors->Input(0);
+	TfLiteTensor* filter = tensors->Input(1);
+	TfLiteTensor* bias = tensors->Input(2);
+	TfLiteTensor* output = tensors->Output();
+	if ((options == nullptr) || !IsInt8(input) || !IsInt8(filter) || !IsInt8(output) ||
+	    ((bias != nullptr) && (bias->type != kTfLiteInt32)) || (input->dims->data[0] != 1)) {
+		fprintf(stderr, "DEPTHWISE_CONV_2D needs int8 tensors, int32 bias and batch size 1\n");
+		return false;
+	}
+	TfLiteFusedActivation activation;
+	if (!ConvertActivation(options->fused_activation_function(), &activation)) {
+		return false;
+	}
+
+	// Padding and quantization like CalculateOpDataDepthwiseConv()
+	const int input_height = input->dims->data[1];
+	const int input_width = input->dims->data[2];
+	const int filter_height = filter->dims->data[1];
+	const int filter_width = filter->dims->data[2];
+	const int channels = filter->dims->data[3];
+	int output_height;
+	int output_width;
+	const TfLitePaddingValues padding = tflite::ComputePaddingHeightWidth(
+	    options->stride_h(), options->stride_w(), options->dilation_h_factor(), options->dilation_w_factor(),
+	    input_height, input_width, filter_height, filter_width,
+	    options->padding() == tflite::Padding_SAME ? kTfLitePaddingSame : kTfLitePaddingValid, &output_height,
+	    &output_width);
+	int32_t multiplier;
+	int shift;
+	int32_t activation_min;
+	int32_t activation_max;
+	std::vector<int32_t> multipliers(channels);
+	std::vector<int32_t> shifts(channels);
+	if (tflite::PopulateConvolutionQuantizationParams(context, input, filter, bias, output, activation, &multiplier,
+	                                                  &shift, &activation_min, &activation_max, multipliers.data(),
+	                                                  shifts.data(), channels) != kTfLiteOk) {
+		return false;
+	}
+
+	cmsis_nn_dw_conv_params params;
+	params.input_offset = -input->params.zero_point;
+	params.output_offset = output->params.zero_point;
+	params.ch_mult = options->depth_multiplier();
+	params.stride = {options->stride_w(), options->stride_h()};
+	params.padding = {padding.width, padding.height};
+	params.dilation = {options->dilation_w_factor(), options->dilation_h_factor()};
+	params.activation = {activation_min, activation_max};
+	const cmsis_nn_dims input_dims = {1, input_height, input_width, input->dims->data[3]};
+	const cmsis_nn_dims filter_dims = {filter->dims->data[0], filter_height, filter_width, channels};
+	const cmsis_nn_dims output_dims = {1, output_height, output_width, channels};
+	const int scratch_bytes = arm_depthwise_conv_wrapper_s8_get_buffer_size(&params, &input_dims, &filter_dims,
+	                                                                        &output_dims);
+	if (scratch_bytes > compilation->scratch_bytes) {
+		compilation->scratch_bytes = scratch_bytes;
+	}
+
+	std::string* constants = &compilation->constants;
+	const std::string prefix = "kOp" + std::to_string(op_index);
+	Appendf(constants, "\n// Operator %d: DEPTHWISE_CONV_2D %dx%dx%d -> %dx%dx%d\n", op_index, input_height,
+	        input_width, input_dims.c, output_height, output_width, channels);
+	AppendArray(constants, "alignas(16) constexpr int8_t", (prefix + "Filter").c_str(), filter->data.int8,
+	            filter->bytes);
+	compilation->weight_bytes += filter->bytes;
+	if (bias != nullptr) {
+		AppendArray(constants, "constexpr int32_t", (prefix + "Bias").c_str(), bias->data.i32, channels);
+		compilation->weight_bytes += bias->bytes;
+	}
+	AppendArray(constants, "constexpr int32_t", (prefix + "Multipliers").c_str(), multipliers.data(), channels);
+	AppendArray(constants, "constexpr int32_t", (prefix + "Shifts").c_str(), shifts.data(), channels);
+	Appendf(constants,
+	        "constexpr cmsis_nn_dw_conv_params %sParams = {%d, %d, %d, {%d, %d}, {%d, %d}, {%d, %d}, {%d, %d}};\n",
+	        prefix.c_str(), (int)params.input_offset, (int)params.output_offset, (int)params.ch_mult,
+	        (int)params.stride.w, (int)params.stride.h, (int)params.padding.w, (int)params.padding.h,
+	        (int)params.dilation.w, (int)params.dilation.h, (int)params.activation.min, (int)params.activation.max);
+	AppendDims(constants, (prefix + "InputDims").c_str(), input_dims.n, input_dims.h, input_dims.w, input_dims.c);
+	AppendDims(constants, (prefix + "FilterDims").c_str(), filter_dims.n, filter_dims.h, filter_dims.w,
+	           filter_dims.c);
+	AppendDims(constants, (prefix + "BiasDims").c_str(), 1, 1, 1, channels);
+	AppendDims(constants, (prefix + "OutputDims").c_str(), output_dims.n, output_dims.h, output_dims.w,
+	           output_dims.c);
+
+	const std::string& input_data = compilation->tensor_data[op->inputs()->Get(0)];
+	const std::string output_data = OutputData(subgraph, op->outputs()->Get(0), output, compilation);
+	const std::string bias_data = bias != nullptr ? prefix + "Bias" : "nullptr";
+	Appendf(&compilation->body,
+	        "\t// Operator %d: DEPTHWISE_CONV_2D\n"
+	        "\tconst cmsis_nn_per_channel_quant_params op%d_quant_params = {const_cast<int32_t*>(%sMultipliers),\n"
+	        "\t                                                             const_cast<int32_t*>(%sShifts)};\n",
+	        op_index, op_index, prefix.c_str(), prefix.c_str());
+	Appendf(&compilation->body,
+	        "\tif (arm_depthwise_conv_wrapper_s8(&context, &%sParams, &op%d_quant_params, &%sInputDims, %s,\n",
+	        prefix.c_str(), op_index, prefix.c_str(), input_data.c_str());
+	Appendf(&compilation->body,
+	        "\t                                  &%sFilterDims, %sFilter, &%sBiasDims, %s, &%sOutputDims,\n",
+	        prefix.c_str(), prefix.c_str(), prefix.c_str(), bias_data.c_str(), prefix.c_str());
+	Appendf(&compilation->body,
+	        "\t                                  %s) != ARM_MATH_SUCCESS) {\n"
+	        "\t\treturn false;\n"
+	        "\t}\n",
+	        output_data.c_str());
+	return true;
+}
+
+bool CompileFullyConnected(TfLiteContext* context, const tflite::SubGraph* subgraph, const tflite::Operator* op,
+                           int op_index, OperatorTensors* tensors, Compilation* compilation) {
+	const tflite::FullyConnectedOptions* options = op->builtin_options_as_FullyConnectedOptions();
+	TfLiteTensor* input = tensors->Input(0);
+	TfLiteTensor* filter = tensors->Input(1);
+	TfLiteTensor* bias = tensors->Input(2);
+	TfLiteTensor* output = tensors->Output();
+	// The kernel takes the 1x1 convolution path for outputs with more dimensions
+	if ((options == nullptr) || !IsInt8(input) || !IsInt8(filter) || !IsInt8(output) ||
+	    ((bias != nullptr) && (bias->type != kTfLiteInt32)) || (output->dims->size != 2)) {
+		fprintf(stderr, "FULLY_CONNECTED needs int8 tensors, int32 bias and 2D output\n");
+		return false;
+	}
+	TfLiteFusedActivation activation;
+	if (!ConvertActivation(options->fused_activation_function(), &activation)) {
+		return false;
+	}
+	tflite::OpDataFullyConnected data;
+	if (tflite::CalculateOpDataFullyConnected(context, activation, kTfLiteInt8, input, filter, bias, output, &data) !=
+	    kTfLiteOk) {
+		return false;
+	}
+
+	const int batches = output->dims->data[0];
+	const int output_depth = output->dims->data[1];
+	const int accum_depth = filter->dims->data[filter->dims->size - 1];
+	const cmsis_nn_dims filter_dims = {accum_depth, 1, 1, output_depth};
+	const int scratch_bytes = arm_fully_connected_s8_get_buffer_size(&filter_dims);
+	if (scratch_bytes > compilation->scratch_bytes) {
+		compilation->scratch_bytes = scratch_bytes;
+	}
+
+	std::string* constants = &compilation->constants;
+	const std::string prefix = "kOp" + std::to_string(op_index);
+	Appendf(constants, "\n// Operator %d: FULLY_CONNECTED %dx%d -> %dx%d\n", op_index, batches, accum_depth, batches,
+	        output_depth);
+	AppendArray(constants, "alignas(16) constexpr int8_t", (prefix + "Filter").c_str(), filter->data.int8,
+	            filter->bytes);
+	compilation->weight_bytes += filter->bytes;
+	if (bias != nullptr) {
+		AppendArray(constants, "constexpr int32_t", (prefix + "Bias").c_str(), bias->data.i32, output_depth);
+		compilation->weight_bytes += bias->bytes;
+	}
+	Appendf(constants, "constexpr cmsis_nn_fc_params %sParams = {%d, 0, %d, {%d, %d}};\n", prefix.c_str(),
+	        (int)-data.input_zero_point, (int)data.output_zero_point, (int)data.output_activation_min,
+	        (int)data.output_activation_max);
+	Appendf(constants, "constexpr cmsis_nn_per_tensor_quant_params %sQuantParams = {%d, %d};\n", prefix.c_str(),
+	        (int)data.output_multiplier, data.output_shift);
+	AppendDims(constants, (prefix + "InputDims").c_str(), batches, 1, 1, accum_depth);
+	AppendDims(constants, (prefix + "FilterDims").c_str(), filter_dims.n, filter_dims.h, filter_dims.w,
+	           filter_dims.c);
+	AppendDims(constants, (prefix + "BiasDims").c_str(), 1, 1, 1, output_depth);
+	AppendDims(constants, (prefix + "OutputDims").c_str(), batches, 1, 1, output_depth);
+
+	const std::string& input_data = compilation->tensor_data[op->inputs()->Get(0)];
+	const std::string output_data = OutputData(subgraph, op->outputs()->Get(0), output, compilation);
+	const std::string bias_data = bias != nullptr ? prefix + "Bias" : "nullptr";
+	Appendf(&compilation->body,
+	        "\t// Operator %d: FULLY_CONNECTED\n"
+	        "\tif (arm_fully_connected_s8(&context, &%sParams, &%sQuantParams, &%sInputDims, %s, &%sFilterDims,\n",
+	        op_index, prefix.c_str(), prefix.c_str(), prefix.c_str(), input_data.c_str(), prefix.c_str());
+	Appendf(&compilation->body,
+	        "\t                           %sFilter, &%sBiasDims, %s, &%sOutputDims, %s) != ARM_MATH_SUCCESS) {\n"
+	        "\t\treturn false;\n"
+	        "\t}\n",
+	        prefix.c_str(), prefix.c_str(), bias_data.c_str(), prefix.c_str(), output_data.c_str());
+	return true;
+}
+
+bool CompileSoftmax(const tflite::SubGraph* subgraph, const tflite::Operator* op, int op_index,
+                    OperatorTensors* tensors, Compilation* compilation) {
+	const tflite::SoftmaxOptions* options = op->builtin_options_as_SoftmaxOptions();
+	const TfLiteTensor* input = tensors->Input(0);
+	TfLiteTensor* output = tensors->Output();
+	if ((options == nullptr) || !IsInt8(input) || !IsInt8(output) || (output->params.zero_point != -128) ||
+	    (output->params.scale != 1.f / 256)) {
+		fprintf(stderr, "SOFTMAX needs int8 tensors and an output scale of 1/256 with zero point -128\n");
+		return false;
+	}
+
+	// Scaling like CalculateSoftmaxParams()
+	int32_t input_multiplier;
+	int input_left_shift;
+	tflite::PreprocessSoftmaxScaling(static_cast<double>(options->beta()), static_cast<double>(input->params.scale),
+	                                 kScaledDiffIntegerBits, &input_multiplier, &input_left_shift);
+	const int32_t diff_min = -1.0 * tflite::CalculateInputRadius(kScaledDiffIntegerBits, input_left_shift);
+	const int depth = input->dims->data[input->dims->size - 1];
+	const int outer_size = tflite::NumElements(input) / depth;
+
+	std::string* constants = &compilation->constants;
+	const std::string prefix = "kOp" + std::to_string(op_index);
+	Appendf(constants, "\n// Operator %d: SOFTMAX %dx%d\n", op_index, outer_size, depth);
+	Appendf(constants, "constexpr int32_t %sInputMultiplier = %d;\n", prefix.c_str(), (int)input_multiplier);
+	Appendf(constants, "constexpr int32_t %sInputLeftShift = %d;\n", prefix.c_str(), input_left_shift);
+	Appendf(constants, "constexpr int32_t %sDiffMin = %d;\n", prefix.c_str(), (int)diff_min);
+
+	const std::string& input_data = compilation->tensor_data[op->inputs()->Get(0)];
+	const std::string output_data = OutputData(subgraph, op->outputs()->Get(0), output, compilation);
+	Appendf(&compilation->body,
+	        "\t// Operator %d: SOFTMAX\n"
+	        "\tarm_softmax_s8(%s, %d, %d, %sInputMultiplier, %sInputLeftShift, %sDiffMin, %s);\n",
+	        op_index, input_data.c_str(), outer_size, depth, prefix.c_str(), prefix.c_str(), prefix.c_str(),
+	        output_data.c_str());
+	return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* model_path = nullptr;
+	const char* source_path = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--model") == 0) && (i + 1 < argc)) {
+			model_path = argv[++i];
+		} else if (source_path == nullptr) {
+			source_path = argv[i];
+		} else {
+			fprintf(stderr, "Usage: %s [--model model.tflite] [compiled_model.cpp]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<uint8_t> model_file;
+	const uint8_t* model_data = g_micro_speech_model_data;
+	if (model_path != nullptr) {
+		FILE* file = fopen(model_path, "rb");
+		if (file == nullptr) {
+			fprintf(stderr, "Could not open %s\n", model_path);
+			return 1;
+		}
+		uint8_t buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			model_file.insert(model_file.end(), buffer, buffer + read);
+		}
+		fclose(file);
+		model_data = model_file.data();
+	}
+
+	const tflite::Model* model = tflite::GetModel(model_data);
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	static ContextInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize, error_reporter);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed\n");
+		return 1;
+	}
+	TfLiteContext* context = interpreter.mutable_context();
+	const TfLiteTensor* input = interpreter.input(0);
+	const TfLiteTensor* output = interpreter.output(0);
+	if ((model->subgraphs()->size() != 1) || (interpreter.inputs_size() != 1) || (interpreter.outputs_size() != 1) ||
+	    !IsInt8(input) || !IsInt8(output)) {
+		fprintf(stderr, "Model needs one subgraph with one int8 input and output\n");
+		return 1;
+	}
+
+	const tflite::SubGraph* subgraph = model->subgraphs()->Get(0);
+	Compilation compilation;
+	compilation.tensor_data.resize(subgraph->tensors()->size());
+	compilation.tensor_data[subgraph->inputs()->Get(0)] = "input";
+	for (size_t i = 0; i < subgraph->operators()->size(); i++) {
+		const tflite::Operator* op = subgraph->operators()->Get(i);
+		const tflite::BuiltinOperator code = tflite::GetBuiltinCode(model->operator_codes()->Get(op->opcode_index()));
+		if (compilation.tensor_data[op->inputs()->Get(0)].empty() || (op->outputs()->size() != 1)) {
+			fprintf(stderr, "Operator %d is not part of a single chain\n", (int)i);
+			return 1;
+		}
+		OperatorTensors tensors(context, op);
+		bool compiled = false;
+		if (code == tflite::BuiltinOperator_RESHAPE) {
+			compiled = CompileReshape(subgraph, op, &tensors, &compilation);
+		} else if (code == tflite::BuiltinOperator_DEPTHWISE_CONV_2D) {
+			compiled = CompileDepthwiseConv(context, subgraph, op, i, &tensors, &compilation);
+		} else if (code == tflite::BuiltinOperator_FULLY_CONNECTED) {
+			compiled = CompileFullyConnected(context, subgraph, op, i, &tensors, &compilation);
+		} else if (code == tflite::BuiltinOperator_SOFTMAX) {
+			compiled = CompileSoftmax(subgraph, op, i, &tensors, &compilation);
+		} else {
+			fprintf(stderr, "Unsupported operator %s\n", tflite::EnumNameBuiltinOperator(code));
+		}
+		if (!compiled) {
+			fprintf(stderr, "Could not compile operator %d\n", (int)i);
+			return 1;
+		}
+	}
+	if (compilation.tensor_data[subgraph->outputs()->Get(0)] != "output") {
+		fprintf(stderr, "Model output is not computed\n");
+		return 1;
+	}
+	printf("Compiled %d operators: %d bytes weights, %d bytes buffers, %d bytes scratch\n",
+	       (int)subgraph->operators()->size(), compilation.weight_bytes, compilation.buffer_bytes,
+	       compilation.scratch_bytes);
+
+	if (source_path == nullptr) {
+		return 0;
+	}
+	FILE* file = fopen(source_path, "w");
+	if (file == nullptr) {
+		fprintf(stderr, "Could not write %s\n", source_path);
+		return 1;
+	}
+	fprintf(file,
+	        "// Generated by host/model_compiler.cpp, do not edit\n"
+	        "#include \"compiled_model.h\"\n"
+	        "\n"
+	        "%s"
+	        "#include \"CMSIS/NN/Include/arm_nnfunctions.h\"\n"
+	        "\n"
+	        "namespace {\n",
+	        compilation.uses_memcpy ? "#include <string.h>\n\n" : "");
+	fputs(compilation.constants.c_str(), file);
+	fprintf(file, "\n// Intermediate tensors and kernel scratch data\n%s", compilation.buffers.c_str());
+	if (compilation.scratch_bytes > 0) {
+		fprintf(file, "alignas(16) int8_t scratch_buffer[%d];\n", compilation.scratch_bytes);
+	}
+	fprintf(file,
+	        "}  // namespace\n"
+	        "\n"
+	        "const float g_compiled_model_input_scale = %.9g;\n"
+	        "const int32_t g_compiled_model_input_zero_point = %d;\n"
+	        "const int g_compiled_model_input_size = %d;\n"
+	        "const int g_compiled_model_output_size = %d;\n"
+	        "const int g_compiled_model_buffer_size = %d;\n"
+	        "\n"
+	        "bool CompiledModelInvoke(const int8_t* input, int8_t* output) {\n",
+	        input->params.scale, (int)input->params.zero_point, (int)input->bytes, (int)output->bytes,
+	        compilation.buffer_bytes + compilation.scratch_bytes);
+	if (compilation.scratch_bytes > 0) {
+		fprintf(file, "\tconst cmsis_nn_context context = {scratch_buffer, %d};\n", compilation.scratch_bytes);
+	} else {
+		fprintf(file, "\tconst cmsis_nn_context context = {nullptr, 0};\n");
+	}
+	fprintf(file, "%s\treturn true;\n}\n", compilation.body.c_str());
+	return fclose(file) == 0 ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+// Checks that RecognizeCommands, which keeps running score sums, gives the same
+// results as the averaging over the stored results it replaced: every call of a
+// posterior trace (src/posterior_trace.h) must return the same label, score and
+// detection for a grid of recognizer parameters.
+//
+// Usage: recognizer_check [trace.bin ...]
+// Replays the given traces, recorded by scripts/record_posterior_trace.py or
+// trace_record, and synthetic traces of random, one-hot and tied scores that go
+// through the trace frame format as well. Each configuration of each trace is a
+// check: prints its first differing call and returns 1 if any call differs.
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "check.h"
+#include "micro_features/micro_model_settings.h"
+#include "posterior_trace.h"
+#include "recognize_commands.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+namespace {
+
+// Parameter grid, including windows with more results than the 50 the
+// recognizer stores at one result per 20 ms slice
+const int32_t kWindowDurations[] = {200, 500, 750, 1000, 1500};
+const int kThresholds[] = {0, 100, 150, 200, 240};
+const int32_t kSuppressions[] = {0, 250, 1500};
+const int32_t kMinimumCounts[] = {1, 3, 6};
+
+// Length of each synthetic trace
+constexpr int kSyntheticFrameCount = 5000;
+
+struct TraceEntry {
+	int32_t time_ms;
+	int8_t scores[kCategoryCount];
+};
+
+// Discards the messages of the queue limit, which both recognizers hit alike
+class SilentErrorReporter : public tflite::ErrorReporter {
+ public:
+	int Report(const char* format, va_list args) override { return 0; }
+};
+
+// The averaging of RecognizeCommands before it kept running sums: the stored
+// results are summed on every call and each category is divided
+class ReferenceRecognizer {
+ public:
+	ReferenceRecognizer(int32_t average_window_duration_ms, uint8_t detection_threshold, int32_t suppression_ms,
+	                    int32_t minimum_count)
+	    : average_window_duration_ms_(average_window_duration_ms),
+	      detection_threshold_(detection_threshold),
+	      suppression_ms_(suppression_ms),
+	      minimum_count_(minimum_count),
+	      front_index_(0),
+	      size_(0),
+	      previous_top_label_(kCategoryLabels[kSilenceIndex]),
+	      previous_top_label_time_(INT32_MIN) {}
+
+	void Process(const int8_t* latest_scores, int32_t current_time_ms, const char** found_command, uint8_t* score,
+	             bool* is_new_command) {
+		if (size_ < kMaxResults) {
+			TraceEntry& entry = results_[(front_index_ + size_) % kMaxResults];
+			entry.time_ms = current_time_ms;
+			for (int i = 0; i < kCategoryCount; ++i) {
+				entry.scores[i] = latest_scores[i];
+			}
+			size_++;
+		}
+		const int64_t time_limit = current_time_ms - average_window_duration_ms_;
+		while ((size_ > 0) && (results_[front_index_].time_ms < time_limit)) {
+			front_index_ = (front_index_ + 1) % kMaxResults;
+			size_--;
+		}
+
+		const int64_t how_many_results = size_;
+		const int64_t samples_duration = current_time_ms - results_[front_index_].time_ms;
+		if ((how_many_results < minimum_count_) || (samples_duration < (average_window_duration_ms_ / 4))) {
+			*found_command = previous_top_label_;
+			*score = 0;
+			*is_new_command = false;
+			return;
+		}
+
+		int32_t average_scores[kCategoryCount];
+		for (int offset = 0; offset < size_; ++offset) {
+			const int8_t* scores = results_[(front_index_ + offset) % kMaxResults].scores;
+			for (int i = 0; i < kCategoryCount; ++i) {
+				if (offset == 0) {
+					average_scores[i] = scores[i] + 128;
+				} else {
+					average_scores[i] += scores[i] + 128;
+				}
+			}
+		}
+		for (int i = 0; i < kCategoryCount; ++i) {
+			average_scores[i] /= how_many_results;
+		}
+		int current_top_index = 0;
+		int32_t current_top_score = 0;
+		for (int i = 0; i < kCategoryCount; ++i) {
+			if (average_scores[i] > current_top_score) {
+				current_top_score = average_scores[i];
+				current_top_index = i;
+			}
+		}
+		const char* current_top_label = kCategoryLabels[current_top_index];
+
+		int64_t time_since_last_top;
+		if ((previous_top_label_ == kCategoryLabels[0]) || (previous_top_label_time_ == INT32_MIN)) {
+			time_since_last_top = INT32_MAX;
+		} else {
+			time_since_last_top = current_time_ms - previous_top_label_time_;
+		}
+		if ((current_top_score > detection_threshold_) &&
+		    ((current_top_label != previous_top_label_) || (time_since_last_top > suppression_ms_))) {
+			previous_top_label_ = current_top_label;
+			previous_top_label_time_ = current_time_ms;
+			*is_new_command = true;
+		} else {
+			*is_new_command = false;
+		}
+		*found_command = current_top_label;
+		*score = current_top_score;
+	}
+
+ private:
+	static constexpr int kMaxResults = 50;
+
+	int32_t average_window_duration_ms_;
+	uint8_t detection_threshold_;
+	int32_t suppression_ms_;
+	int32_t minimum_count_;
+	TraceEntry results_[kMaxResults];
+	int front_index_;
+	int size_;
+	const char* previous_top_label_;
+	int32_t previous_top_label_time_;
+};
+
+// Reads the frames of a trace, skipping the bytes between them
+void ReadTraceData(const std::vector<uint8_t>& data, std::vector<TraceEntry>* trace) {
+	for (size_t offset = 0; offset < data.size();) {
+		TraceEntry entry;
+		const int frame_size =
+		    ReadPosteriorTraceFrame(data.data() + offset, data.size() - offset, &entry.time_ms, entry.scores);
+		if (frame_size == 0) {
+			offset++;
+			continue;
+		}
+		// A device reset starts the time again, only the last run is kept
+		if (!trace->empty() && (entry.time_ms < trace->back().time_ms)) {
+			trace->clear();
+		}
+		trace->push_back(entry);
+		offset += frame_size;
+	}
+}
+
+bool ReadTrace(const char* path, std::vector<TraceEntry>* trace) {
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + read);
+	}
+	fclose(file);
+	ReadTraceData(data, trace);
+	return true;
+}
+
+uint32_t NextRandom(uint32_t* seed) {
+	*seed = *seed * 1664525u + 1013904223u;
+	return *seed >> 8;
+}
+
+// Kinds of synthetic traces
+enum class Scores { kRandom, kOneHot, kTied };
+
+// Writes a synthetic trace as frames, with time steps of 10 to 40 ms and
+// occasional pauses, and reads it back
+std::vector<TraceEntry> SyntheticTrace(Scores kind, uint32_t seed) {
+	std::vector<uint8_t> data;
+	int32_t time_ms = 0;
+	int top_index = 0;
+	for (int frame = 0; frame < kSyntheticFrameCount; frame++) {
+		time_ms += 10 + NextRandom(&seed) % 31;
+		if (NextRandom(&seed) % 200 == 0) {
+			time_ms += NextRandom(&seed) % 3000;
+		}
+		if (NextRandom(&seed) % 30 == 0) {
+			top_index = NextRandom(&seed) % kCategoryCount;
+		}
+		int8_t scores[kCategoryCount];
+		for (int i = 0; i < kCategoryCount; i++) {
+			switch (kind) {
+				case Scores::kRandom:
+					scores[i] = static_cast<int8_t>(static_cast<int>(NextRandom(&seed) % 256) - 128);
+					break;
+				case Scores::kOneHot:
+					scores[i] = (i == top_index) ? 127 : -128;
+					break;
+				case Scores::kTied:
+					// Few distinct values, so several categories often share the top average
+					scores[i] = static_cast<int8_t>(static_cast<int>(NextRandom(&seed) % 3) * 127 - 128);
+					break;
+			}
+		}
+		uint8_t frame_data[kPosteriorTraceFrameSize];
+		const int frame_size = WritePosteriorTraceFrame(time_ms, scores, frame_data);
+		data.insert(data.end(), frame_data, frame_data + frame_size);
+	}
+	std::vector<TraceEntry> trace;
+	ReadTraceData(data, &trace);
+	return trace;
+}
+
+// Replays the trace through both recognizers for every configuration of the
+// grid, each a check that no call differs, and counts the calls and detections
+void CompareRecognizers(const char* name, const std::vector<TraceEntry>& trace, int64_t* call_count,
+                        int64_t* detection_count) {
+	static SilentErrorReporter error_reporter;
+	for (const int32_t window_duration_ms : kWindowDurations) {
+		for (const int threshold : kThresholds) {
+			for (const int32_t suppression_ms : kSuppressions) {
+				for (const int32_t minimum_count : kMinimumCounts) {
+					RecognizeCommands recognizer(&error_reporter, window_duration_ms, threshold, suppression_ms,
+					                             minimum_count);
+					ReferenceRecognizer reference(window_duration_ms, threshold, suppression_ms, minimum_count);
+					// Results of the last call, the first differing one if any
+					int32_t time_ms = 0;
+					const char* found_command = "";
+					uint8_t score = 0;
+					bool is_new_command = false;
+					const char* reference_command = "";
+					uint8_t reference_score = 0;
+					bool is_reference_new_command = false;
+					bool is_identical = true;
+					for (const TraceEntry& entry : trace) {
+						time_ms = entry.time_ms;
+						recognizer.ProcessLatestScores(entry.scores, entry.time_ms, &found_command, &score,
+						                               &is_new_command);
+						reference.Process(entry.scores, entry.time_ms, &reference_command, &reference_score,
+						                  &is_reference_new_command);
+						(*call_count)++;
+						if (is_new_command) {
+							(*detection_count)++;
+						}
+						if ((found_command != reference_command) || (score != reference_score) ||
+						    (is_new_command != is_reference_new_command)) {
+							is_identical = false;
+							break;
+						}
+					}
+					Check(is_identical,
+					      "%s, window %d ms, threshold %d, suppression %d ms, min count %d @%dms: "
+					      "%s %d%s instead of %s %d%s",
+					      name, (int)window_duration_ms, threshold, (int)suppression_ms, (int)minimum_count,
+					      (int)time_ms, found_command, score, is_new_command ? " new" : "", reference_command,
+					      reference_score, is_reference_new_command ? " new" : "");
+				}
+			}
+		}
+	}
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	struct NamedTrace {
+		const char* name;
+		std::vector<TraceEntry> trace;
+	};
+	std::vector<NamedTrace> traces;
+	for (int i = 1; i < argc; i++) {
+		NamedTrace named_trace = {argv[i], {}};
+		if (!ReadTrace(argv[i], &named_trace.trace) || named_trace.trace.empty()) {
+			fprintf(stderr, "Could not read a posterior trace from %s\n", argv[i]);
+			return 1;
+		}
+		traces.push_back(named_trace);
+	}
+	traces.push_back({"random scores", SyntheticTrace(Scores::kRandom, 1)});
+	traces.push_back({"one-hot scores", SyntheticTrace(Scores::kOneHot, 2)});
+	traces.push_back({"tied scores", SyntheticTrace(Scores::kTied, 3)});
+
+	for (const NamedTrace& named_trace : traces) {
+		int64_t call_count = 0;
+		int64_t detection_count = 0;
+		CompareRecognizers(named_trace.name, named_trace.trace, &call_count, &detection_count);
+		printf("%s: %d frames, %lld calls, %lld detections\n", named_trace.name, (int)named_trace.trace.size(),
+		       (long long)call_count, (long long)detection_count);
+	}
+	return ReportChecks("Recognizer");
+}
@@ -0,0 +1,312 @@
+// Replays a posterior trace (src/posterior_trace.h) through RecognizeCommands
+// for every combination of a grid of recognizer parameters and reports
+// precision, recall and detection latency against the labeled words, to tune
+// the recognizer parameters of src/config.h without reflashing the device.
+//
+// Usage: recognizer_tuning trace.bin labels.txt [--jobs N] [--top N]
+// The trace is recorded from the device with scripts/record_posterior_trace.py
+// or from WAV files with trace_record, the label file has one word per line,
+// start and end in seconds and the label separated by tabs (Audacity label
+// track). Bytes between frames, like text output of the device, are skipped.
+// A detection is correct if it has the label of a word and falls between its
+// start and kMatchToleranceMs after its end; the latency is measured from the
+// end of the word. The configurations are split across N threads (default:
+// number of cores). Reported are the parameters of config.h, the best
+// configurations by F1 score and the configurations not beaten in precision,
+// recall and latency at once.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "micro_features/micro_model_settings.h"
+#include "posterior_trace.h"
+#include "recognize_commands.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+namespace {
+
+// Time after the end of a word a detection still counts for it
+constexpr int32_t kMatchToleranceMs = 1000;
+// Number of configurations not beaten in any metric printed at most
+constexpr int kMaxFrontPrinted = 20;
+
+// Parameter grid, the averaging window stays below the 50 results the
+// recognizer keeps at one result per 20 ms slice
+const int32_t kWindowDurations[] = {200, 300, 400, 500, 600, 700, 800, 900};
+const int kThresholds[] = {100, 110, 120, 130, 140, 150, 160, 170, 180, 190, 200, 210, 220, 230, 240, 250};
+const int32_t kSuppressions[] = {250, 500, 750, 1000, 1250, 1500};
+const int32_t kMinimumCounts[] = {1, 2, 3, 4, 5, 6};
+
+struct TraceEntry {
+	int32_t time_ms;
+	int8_t scores[kCategoryCount];
+};
+
+struct Word {
+	int label;
+	int32_t start_ms;
+	int32_t end_ms;
+};
+
+struct Config {
+	int32_t window_duration_ms;
+	uint8_t threshold;
+	int32_t suppression_ms;
+	int32_t minimum_count;
+};
+
+struct Result {
+	Config config;
+	int correct;
+	int detections;
+	double precision;
+	double recall;
+	double f1;
+	double mean_latency_ms;
+};
+
+bool ReadTrace(const char* path, std::vector<TraceEntry>* trace) {
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + read);
+	}
+	fclose(file);
+	for (size_t offset = 0; offset < data.size();) {
+		TraceEntry entry;
+		const int frame_size =
+		    ReadPosteriorTraceFrame(data.data() + offset, data.size() - offset, &entry.time_ms, entry.scores);
+		if (frame_size == 0) {
+			offset++;
+			continue;
+		}
+		// A device reset starts the time again, only the last run is kept
+		if (!trace->empty() && (entry.time_ms < trace->back().time_ms)) {
+			trace->clear();
+		}
+		trace->push_back(entry);
+		offset += frame_size;
+	}
+	return true;
+}
+
+bool ReadLabels(const char* path, std::vector<Word>* words, int* ignored_count) {
+	FILE* file = fopen(path, "r");
+	if (file == nullptr) {
+		return false;
+	}
+	double start_s;
+	double end_s;
+	char label[64];
+	while (fscanf(file, "%lf %lf %63s", &start_s, &end_s, label) == 3) {
+		int index = -1;
+		for (int i = kUnknownIndex + 1; i < kCategoryCount; i++) {
+			if (strcmp(label, kCategoryLabels[i]) == 0) {
+				index = i;
+			}
+		}
+		if (index < 0) {
+			(*ignored_count)++;
+			continue;
+		}
+		words->push_back(
+		    {index, static_cast<int32_t>(start_s * 1000.0 + 0.5), static_cast<int32_t>(end_s * 1000.0 + 0.5)});
+	}
+	fclose(file);
+	return true;
+}
+
+Result Evaluate(const Config& config, const std::vector<TraceEntry>& trace, const std::vector<Word>& words,
+                tflite::ErrorReporter* error_reporter) {
+	RecognizeCommands recognizer(error_reporter, config.window_duration_ms, config.threshold, config.suppression_ms,
+	                             config.minimum_count);
+	std::vector<bool> matched(words.size(), false);
+	Result result = {config, 0, 0, 0.0, 0.0, 0.0, 0.0};
+	int64_t latency_sum_ms = 0;
+	size_t first_word = 0;
+	for (const TraceEntry& entry : trace) {
+		const char* found_command = nullptr;
+		uint8_t score = 0;
+		bool is_new_command = false;
+		recognizer.ProcessLatestScores(entry.scores, entry.time_ms, &found_command, &score, &is_new_command);
+		if (!is_new_command || (found_command == kCategoryLabels[kSilenceIndex]) ||
+		    (found_command == kCategoryLabels[kUnknownIndex])) {
+			continue;
+		}
+		result.detections++;
+		// Words are sorted by start, skip the ones that can no longer match
+		while ((first_word < words.size()) && (words[first_word].end_ms + kMatchToleranceMs < entry.time_ms)) {
+			first_word++;
+		}
+		for (size_t i = first_word; (i < words.size()) && (words[i].start_ms <= entry.time_ms); i++) {
+			if (!matched[i] && (found_command == kCategoryLabels[words[i].label]) &&
+			    (entry.time_ms <= words[i].end_ms + kMatchToleranceMs)) {
+				matched[i] = true;
+				result.correct++;
+				latency_sum_ms += entry.time_ms - words[i].end_ms;
+				break;
+			}
+		}
+	}
+	result.precision = result.detections > 0 ? static_cast<double>(result.correct) / result.detections : 1.0;
+	result.recall = words.empty() ? 1.0 : static_cast<double>(result.correct) / words.size();
+	result.f1 = (result.precision + result.recall) > 0.0
+	                ? 2.0 * result.precision * result.recall / (result.precision + result.recall)
+	                : 0.0;
+	result.mean_latency_ms = result.correct > 0 ? static_cast<double>(latency_sum_ms) / result.correct : 0.0;
+	return result;
+}
+
+// Whether a is at least as good as b in every metric and better in one
+bool Dominates(const Result& a, const Result& b) {
+	const bool at_least = (a.precision >= b.precision) && (a.recall >= b.recall) &&
+	                      (a.mean_latency_ms <= b.mean_latency_ms);
+	const bool better = (a.precision > b.precision) || (a.recall > b.recall) ||
+	                    (a.mean_latency_ms < b.mean_latency_ms);
+	return at_least && better;
+}
+
+void PrintHeader() {
+	printf("  %6s %9s %11s %9s %9s %6s %8s %8s\n", "Window", "Threshold", "Suppression", "Min count", "Precision",
+	       "Recall", "F1", "Latency");
+}
+
+void PrintResult(const Result& result) {
+	printf("  %4d ms %9d %8d ms %9d %8.1f%% %5.1f%% %8.3f %+5.0f ms\n", (int)result.config.window_duration_ms,
+	       result.config.threshold, (int)result.config.suppression_ms, (int)result.config.minimum_count,
+	       100.0 * result.precision, 100.0 * result.recall, result.f1, result.mean_latency_ms);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* trace_path = nullptr;
+	const char* labels_path = nullptr;
+	int jobs = std::max(1u, std::thread::hardware_concurrency());
+	int top_count = 10;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc)) {
+			jobs = std::max(1, atoi(argv[++i]));
+		} else if ((strcmp(argv[i], "--top") == 0) && (i + 1 < argc)) {
+			top_count = std::max(1, atoi(argv[++i]));
+		} else if (trace_path == nullptr) {
+			trace_path = argv[i];
+		} else if (labels_path == nullptr) {
+			labels_path = argv[i];
+		} else {
+			trace_path = nullptr;
+			break;
+		}
+	}
+	if ((trace_path == nullptr) || (labels_path == nullptr)) {
+		fprintf(stderr, "Usage: %s trace.bin labels.txt [--jobs N] [--top N]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<TraceEntry> trace;
+	if (!ReadTrace(trace_path, &trace) || trace.empty()) {
+		fprintf(stderr, "Could not read a trace of this model from %s\n", trace_path);
+		return 1;
+	}
+	std::vector<Word> words;
+	int ignored_count = 0;
+	if (!ReadLabels(labels_path, &words, &ignored_count)) {
+		fprintf(stderr, "Could not read %s\n", labels_path);
+		return 1;
+	}
+	std::sort(words.begin(), words.end(), [](const Word& a, const Word& b) { return a.start_ms < b.start_ms; });
+	printf("Trace: %d frames, %d ms, %d words (%d labels of other words ignored)\n", (int)trace.size(),
+	       (int)(trace.back().time_ms - trace.front().time_ms), (int)words.size(), ignored_count);
+
+	std::vector<Config> configs;
+	for (int32_t window_duration_ms : kWindowDurations) {
+		for (int threshold : kThresholds) {
+			for (int32_t suppression_ms : kSuppressions) {
+				for (int32_t minimum_count : kMinimumCounts) {
+					configs.push_back(
+					    {window_duration_ms, static_cast<uint8_t>(threshold), suppression_ms, minimum_count});
+				}
+			}
+		}
+	}
+
+	// RecognizeCommands keeps all its state in the object, so the threads only
+	// share the read-only trace and claim configurations through the counter
+	static tflite::MicroErrorReporter micro_error_reporter;
+	std::vector<Result> results(configs.size());
+	std::atomic<size_t> next_config(0);
+	const auto evaluate_configs = [&]() {
+		for (size_t i = next_config++; i < configs.size(); i = next_config++) {
+			results[i] = Evaluate(configs[i], trace, words, &micro_error_reporter);
+		}
+	};
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int job = 1; job < jobs; job++) {
+		threads.emplace_back(evaluate_configs);
+	}
+	evaluate_configs();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("Evaluated %d configurations in %.2f s with %d threads, %.0f configurations/s\n", (int)configs.size(),
+	       seconds, jobs, seconds > 0.0 ? configs.size() / seconds : 0.0);
+
+	printf("config.h:\n");
+	PrintHeader();
+	PrintResult(Evaluate({g_rec_average_window_duration_ms, g_rec_detection_threshold, g_rec_suppression_ms,
+	                      g_rec_minimum_count},
+	                     trace, words, &micro_error_reporter));
+
+	std::vector<Result> sorted = results;
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Result& a, const Result& b) {
+		return (a.f1 > b.f1) || ((a.f1 == b.f1) && (a.mean_latency_ms < b.mean_latency_ms));
+	});
+	printf("Best %d by F1 score:\n", std::min(top_count, (int)sorted.size()));
+	PrintHeader();
+	for (int i = 0; (i < top_count) && (i < (int)sorted.size()); i++) {
+		PrintResult(sorted[i]);
+	}
+
+	// Configurations trading precision, recall and latency against each other,
+	// one per distinct combination of the metrics
+	std::vector<Result> front;
+	for (const Result& result : sorted) {
+		bool dominated = false;
+		for (const Result& other : sorted) {
+			if (Dominates(other, result)) {
+				dominated = true;
+				break;
+			}
+		}
+		const bool duplicate = std::any_of(front.begin(), front.end(), [&result](const Result& other) {
+			return (other.precision == result.precision) && (other.recall == result.recall) &&
+			       (other.mean_latency_ms == result.mean_latency_ms);
+		});
+		if (!dominated && !duplicate) {
+			front.push_back(result);
+		}
+	}
+	std::sort(front.begin(), front.end(),
+	          [](const Result& a, const Result& b) { return a.mean_latency_ms < b.mean_latency_ms; });
+	printf("Trade-off (%d configurations not beaten in precision, recall and latency at once%s):\n", (int)front.size(),
+	       (int)front.size() > kMaxFrontPrinted ? ", lowest latency first" : "");
+	PrintHeader();
+	for (int i = 0; (i < kMaxFrontPrinted) && (i < (int)front.size()); i++) {
+		PrintResult(front[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,201 @@
+// Replays audio through the firmware feature provider and model on the host and
+// writes the scores fed to the recognizer as posterior trace
+// (src/posterior_trace.h), the same frames the firmware sends with
+// g_trace_output_enabled. Inference is gated by the voice activity measure like
+// on the device, skipped windows are traced with silence scores.
+//
+// Usage: trace_record [--labels labels.txt] trace.bin [file.wav ...]
+// Without WAV files the yes/no test clips are replayed, separated by stretches
+// of low level noise, and their positions are written as label file for
+// recognizer_tuning. Label files have one word per line, start and end in
+// seconds and the label separated by tabs, like the label tracks of Audacity.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "config.h"
+#include "feature_provider.h"
+#include "host_audio_provider.h"
+#include "host_platform.h"
+#include "micro_features/micro_model_settings.h"
+#include "micro_speech_model_data.h"
+#include "parallel_kernels.h"
+#include "posterior_trace.h"
+#include "streaming_depthwise_conv.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "testdata/no_1000ms_audio_data.h"
+#include "testdata/yes_1000ms_audio_data.h"
+#include "wav_file.h"
+
+namespace {
+
+constexpr int kTensorArenaSize = 32 * 1024;
+uint8_t tensor_arena[kTensorArenaSize];
+int8_t feature_buffer[kFeatureElementCount];
+
+struct Word {
+	const char* label;
+	int32_t start_ms;
+	int32_t end_ms;
+};
+
+void AppendNoise(std::vector<int16_t>* audio, int duration_ms, uint32_t* seed) {
+	const int count = duration_ms * (kAudioSampleFrequency / 1000);
+	for (int i = 0; i < count; i++) {
+		*seed = *seed * 1664525u + 1013904223u;
+		audio->push_back(static_cast<int16_t>(static_cast<int32_t>(*seed >> 24) - 128) / 4);
+	}
+}
+
+void AppendWord(std::vector<int16_t>* audio, std::vector<Word>* words, const char* label, const int16_t* clip,
+                int clip_size) {
+	const int32_t start_ms = audio->size() / (kAudioSampleFrequency / 1000);
+	audio->insert(audio->end(), clip, clip + clip_size);
+	words->push_back({label, start_ms, start_ms + clip_size / (kAudioSampleFrequency / 1000)});
+}
+
+bool WriteLabels(const char* path, const std::vector<Word>& words) {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		return false;
+	}
+	for (const Word& word : words) {
+		fprintf(file, "%.3f\t%.3f\t%s\n", word.start_ms / 1000.0, word.end_ms / 1000.0, word.label);
+	}
+	return fclose(file) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const char* labels_path = nullptr;
+	const char* trace_path = nullptr;
+	std::vector<const char*> wav_paths;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--labels") == 0) && (i + 1 < argc)) {
+			labels_path = argv[++i];
+		} else if (trace_path == nullptr) {
+			trace_path = argv[i];
+		} else {
+			wav_paths.push_back(argv[i]);
+		}
+	}
+	if (trace_path == nullptr) {
+		fprintf(stderr, "Usage: %s [--labels labels.txt] trace.bin [file.wav ...]\n", argv[0]);
+		return 1;
+	}
+
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<int16_t> audio;
+	std::vector<Word> words;
+	if (!wav_paths.empty()) {
+		for (const char* path : wav_paths) {
+			std::vector<int16_t> samples;
+			int sample_rate = 0;
+			if (!ReadWavFile(path, &samples, &sample_rate) || (sample_rate != kAudioSampleFrequency)) {
+				fprintf(stderr, "Could not read %s as 16 kHz 16 bit PCM WAV file\n", path);
+				return 1;
+			}
+			audio.insert(audio.end(), samples.begin(), samples.end());
+		}
+	} else {
+		uint32_t seed = 1;
+		for (int i = 0; i < 4; i++) {
+			AppendNoise(&audio, 3000, &seed);
+			AppendWord(&audio, &words, "yes", g_yes_1000ms_audio_data, g_yes_1000ms_audio_data_size);
+			AppendNoise(&audio, 3000, &seed);
+			AppendWord(&audio, &words, "no", g_no_1000ms_audio_data, g_no_1000ms_audio_data_size);
+		}
+		AppendNoise(&audio, 3000, &seed);
+	}
+	SetHostAudioData(audio.data(), audio.size());
+
+	// Same operators as the firmware
+	const tflite::Model* model = tflite::GetModel(g_micro_speech_model_data);
+#if PARALLEL_KERNELS
+	static ParallelOpResolver<4> micro_op_resolver(error_reporter, STREAMING_INFERENCE);
+#elif STREAMING_INFERENCE
+	static StreamingOpResolver<4> micro_op_resolver(error_reporter);
+#else
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+#endif
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize,
+	                                            error_reporter);
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed\n");
+		return 1;
+	}
+
+	FILE* trace_file = fopen(trace_path, "wb");
+	if (trace_file == nullptr) {
+		fprintf(stderr, "Could not write %s\n", trace_path);
+		return 1;
+	}
+	FeatureProvider feature_provider(kFeatureElementCount, feature_buffer);
+	int8_t silence_scores[kCategoryCount];
+	for (int i = 0; i < kCategoryCount; i++) {
+		silence_scores[i] = (i == kSilenceIndex) ? 127 : -128;
+	}
+	uint8_t frame[kPosteriorTraceFrameSize];
+	int frame_count = 0;
+	const int32_t duration_ms = audio.size() / (kAudioSampleFrequency / 1000);
+	int32_t previous_time = 0;
+	for (int32_t current_time = kFeatureSliceStrideMs; current_time <= duration_ms;
+	     current_time += kFeatureSliceStrideMs) {
+		SetHostAudioTimestamp(current_time);
+		int how_many_new_slices = 0;
+		if (feature_provider.PopulateFeatureData(error_reporter, previous_time, current_time, &how_many_new_slices) !=
+		    kTfLiteOk) {
+			return 1;
+		}
+		previous_time = current_time;
+		if (how_many_new_slices == 0) {
+			continue;
+		}
+
+		const int8_t* scores = silence_scores;
+		if (!g_vad_enabled || (feature_provider.speech_slice_count() > 0)) {
+			memcpy(interpreter.input(0)->data.int8, feature_buffer, kFeatureElementCount);
+			if (interpreter.Invoke() != kTfLiteOk) {
+				fprintf(stderr, "Invoke failed\n");
+				return 1;
+			}
+			scores = interpreter.output(0)->data.int8;
+		}
+		const int frame_size = WritePosteriorTraceFrame(current_time, scores, frame);
+		if (fwrite(frame, 1, frame_size, trace_file) != (size_t)frame_size) {
+			fprintf(stderr, "Could not write %s\n", trace_path);
+			return 1;
+		}
+		frame_count++;
+	}
+	if (fclose(trace_file) != 0) {
+		fprintf(stderr, "Could not write %s\n", trace_path);
+		return 1;
+	}
+	printf("Wrote %d frames of %d ms audio to %s\n", frame_count, (int)duration_ms, trace_path);
+
+	if (labels_path != nullptr) {
+		if (words.empty()) {
+			fprintf(stderr, "Labels are only known for the test clips\n");
+			return 1;
+		}
+		if (!WriteLabels(labels_path, words)) {
+			fprintf(stderr, "Could not write %s\n", labels_path);
+			return 1;
+		}
+		printf("Wrote %d labels to %s\n", (int)words.size(), labels_path);
+	}
+	return 0;
+}
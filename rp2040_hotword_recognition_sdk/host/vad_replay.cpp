@@ -0,0 +1,319 @@
+// Replays audio through the firmware feature provider, model and recognizer on
+// the host, once with every inference run and once gated by the voice activity
+// measure, and reports the inference duty cycle of the gate and the keyword
+// detections it lost. With CASCADE_GATE the two-stage cascade is replayed as
+// well: the yes/no model gates the recognition model on the windows passing the
+// voice activity gate, and its inference time and detection latency are
+// compared with running the recognition model on all of them.
+//
+// Usage: vad_replay [file.wav ...]
+// Without arguments the yes/no test clips are replayed, separated by stretches
+// of low level noise.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cascade_gate.h"
+#include "config.h"
+#include "feature_provider.h"
+#include "gate_model_data.h"
+#include "host_audio_provider.h"
+#include "host_platform.h"
+#include "micro_features/micro_model_settings.h"
+#include "micro_speech_model_data.h"
+#include "recognize_commands.h"
+#include "parallel_kernels.h"
+#include "streaming_depthwise_conv.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "testdata/no_1000ms_audio_data.h"
+#include "testdata/yes_1000ms_audio_data.h"
+#include "wav_file.h"
+
+namespace {
+
+constexpr int kTensorArenaSize = 64 * 1024;
+uint8_t tensor_arena[kTensorArenaSize];
+int8_t feature_buffer[kFeatureElementCount];
+
+struct Detection {
+	int label;
+	int32_t time_ms;
+};
+
+int LabelIndex(const char* label) {
+	for (int i = 0; i < kCategoryCount; i++) {
+		if (label == kCategoryLabels[i]) {
+			return i;
+		}
+	}
+	return kUnknownIndex;
+}
+
+void AppendNoise(std::vector<int16_t>* audio, int duration_ms, uint32_t* seed) {
+	const int count = duration_ms * (kAudioSampleFrequency / 1000);
+	for (int i = 0; i < count; i++) {
+		*seed = *seed * 1664525u + 1013904223u;
+		audio->push_back(static_cast<int16_t>(static_cast<int32_t>(*seed >> 24) - 128) / 4);
+	}
+}
+
+void AppendClip(std::vector<int16_t>* audio, const int16_t* clip, int clip_size) {
+	audio->insert(audio->end(), clip, clip + clip_size);
+}
+
+const Detection* FindMatch(const Detection& detection, const std::vector<Detection>& detections) {
+	for (const Detection& other : detections) {
+		if ((other.label == detection.label) &&
+		    (abs(other.time_ms - detection.time_ms) <= g_rec_average_window_duration_ms)) {
+			return &other;
+		}
+	}
+	return nullptr;
+}
+
+bool Matches(const Detection& detection, const std::vector<Detection>& detections) {
+	return FindMatch(detection, detections) != nullptr;
+}
+
+double MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	InitializeHostPlatform();
+	static tflite::MicroErrorReporter micro_error_reporter;
+	tflite::ErrorReporter* error_reporter = &micro_error_reporter;
+
+	std::vector<int16_t> audio;
+	if (argc > 1) {
+		for (int i = 1; i < argc; i++) {
+			std::vector<int16_t> samples;
+			int sample_rate = 0;
+			if (!ReadWavFile(argv[i], &samples, &sample_rate) || (sample_rate != kAudioSampleFrequency)) {
+				fprintf(stderr, "Could not read %s as 16 kHz 16 bit PCM WAV file\n", argv[i]);
+				return 1;
+			}
+			audio.insert(audio.end(), samples.begin(), samples.end());
+		}
+	} else {
+		uint32_t seed = 1;
+		for (int i = 0; i < 4; i++) {
+			AppendNoise(&audio, 3000, &seed);
+			AppendClip(&audio, g_yes_1000ms_audio_data, g_yes_1000ms_audio_data_size);
+			AppendNoise(&audio, 3000, &seed);
+			AppendClip(&audio, g_no_1000ms_audio_data, g_no_1000ms_audio_data_size);
+		}
+		AppendNoise(&audio, 3000, &seed);
+	}
+	SetHostAudioData(audio.data(), audio.size());
+
+	const tflite::Model* model = tflite::GetModel(g_micro_speech_model_data);
+#if PARALLEL_KERNELS
+	static ParallelOpResolver<4> micro_op_resolver(error_reporter, STREAMING_INFERENCE);
+#elif STREAMING_INFERENCE
+	static StreamingOpResolver<4> micro_op_resolver(error_reporter);
+#else
+	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+#endif
+	micro_op_resolver.AddDepthwiseConv2D();
+	micro_op_resolver.AddFullyConnected();
+	micro_op_resolver.AddSoftmax();
+	micro_op_resolver.AddReshape();
+#if CASCADE_GATE
+	// Both models share the arena like on the device
+	tflite::MicroAllocator* allocator = tflite::MicroAllocator::Create(tensor_arena, kTensorArenaSize, error_reporter);
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, allocator, error_reporter);
+#else
+	static tflite::MicroInterpreter interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize,
+	                                            error_reporter);
+#endif
+	if (interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed\n");
+		return 1;
+	}
+	int8_t* model_input_buffer = interpreter.input(0)->data.int8;
+#if CASCADE_GATE
+	static tflite::MicroInterpreter gate_interpreter(tflite::GetModel(g_gate_model_data), micro_op_resolver,
+	                                                 allocator, error_reporter);
+	if (gate_interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed for the gate model\n");
+		return 1;
+	}
+	// Recognition model only run while the gate is open, so its streaming
+	// convolution computes the window again after the gate was closed
+	static tflite::MicroInterpreter cascade_interpreter(model, micro_op_resolver, allocator, error_reporter);
+	if (cascade_interpreter.AllocateTensors() != kTfLiteOk) {
+		fprintf(stderr, "AllocateTensors() failed for the cascade\n");
+		return 1;
+	}
+	CascadeGate cascade_gate(g_cascade_gate_threshold, g_cascade_hold_ms);
+	cascade_gate.SetInputQuantization(interpreter.input(0)->params.scale, interpreter.input(0)->params.zero_point,
+	                                  gate_interpreter.input(0)->params.scale,
+	                                  gate_interpreter.input(0)->params.zero_point);
+	RecognizeCommands cascade_recognizer(error_reporter, g_rec_average_window_duration_ms,
+	                                     g_rec_detection_threshold, g_rec_suppression_ms, g_rec_minimum_count);
+	std::vector<Detection> cascade_detections;
+	int cascade_inference_count = 0;
+	double gate_us = 0.0;
+	double model_us = 0.0;
+	double always_us = 0.0;
+#endif
+
+	FeatureProvider feature_provider(kFeatureElementCount, feature_buffer);
+	RecognizeCommands reference_recognizer(error_reporter, g_rec_average_window_duration_ms,
+	                                       g_rec_detection_threshold, g_rec_suppression_ms, g_rec_minimum_count);
+	RecognizeCommands gated_recognizer(error_reporter, g_rec_average_window_duration_ms, g_rec_detection_threshold,
+	                                   g_rec_suppression_ms, g_rec_minimum_count);
+	int8_t silence_scores[kCategoryCount];
+	for (int i = 0; i < kCategoryCount; i++) {
+		silence_scores[i] = (i == kSilenceIndex) ? 127 : -128;
+	}
+
+	std::vector<Detection> reference_detections;
+	std::vector<Detection> gated_detections;
+	int inference_count = 0;
+	int gated_inference_count = 0;
+	const int32_t duration_ms = audio.size() / (kAudioSampleFrequency / 1000);
+	int32_t previous_time = 0;
+	for (int32_t current_time = kFeatureSliceStrideMs; current_time <= duration_ms;
+	     current_time += kFeatureSliceStrideMs) {
+		SetHostAudioTimestamp(current_time);
+		int how_many_new_slices = 0;
+		if (feature_provider.PopulateFeatureData(error_reporter, previous_time, current_time, &how_many_new_slices) !=
+		    kTfLiteOk) {
+			return 1;
+		}
+		previous_time = current_time;
+		if (how_many_new_slices == 0) {
+			continue;
+		}
+
+		const bool gate_open = feature_provider.speech_slice_count() > 0;
+#if CASCADE_GATE
+		// The models share their tensor memory, so every output is taken before
+		// the next model runs
+		int8_t cascade_scores[kCategoryCount];
+		bool cascade_open = false;
+		if (gate_open) {
+			cascade_gate.ConvertFeatures(feature_buffer, gate_interpreter.input(0)->data.int8, kFeatureElementCount);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (gate_interpreter.Invoke() != kTfLiteOk) {
+				fprintf(stderr, "Invoke failed for the gate model\n");
+				return 1;
+			}
+			gate_us += MicrosecondsSince(start);
+			cascade_open = cascade_gate.Update(gate_interpreter.output(0)->data.int8, current_time);
+		}
+		if (cascade_open) {
+			memcpy(cascade_interpreter.input(0)->data.int8, feature_buffer, kFeatureElementCount);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if (cascade_interpreter.Invoke() != kTfLiteOk) {
+				fprintf(stderr, "Invoke failed for the cascade\n");
+				return 1;
+			}
+			model_us += MicrosecondsSince(start);
+			memcpy(cascade_scores, cascade_interpreter.output(0)->data.int8, kCategoryCount);
+			cascade_inference_count++;
+		}
+#endif
+
+		for (int i = 0; i < kFeatureElementCount; i++) {
+			model_input_buffer[i] = feature_buffer[i];
+		}
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (interpreter.Invoke() != kTfLiteOk) {
+			fprintf(stderr, "Invoke failed\n");
+			return 1;
+		}
+		const double invoke_us = MicrosecondsSince(start);
+		const int8_t* model_scores = interpreter.output(0)->data.int8;
+		inference_count++;
+		if (gate_open) {
+			gated_inference_count++;
+#if CASCADE_GATE
+			always_us += invoke_us;
+#endif
+		}
+
+		const char* found_command = nullptr;
+		uint8_t score = 0;
+		bool is_new_command = false;
+		reference_recognizer.ProcessLatestScores(model_scores, current_time, &found_command, &score,
+		                                         &is_new_command);
+		if (is_new_command && (LabelIndex(found_command) > kUnknownIndex)) {
+			reference_detections.push_back({LabelIndex(found_command), current_time});
+		}
+		gated_recognizer.ProcessLatestScores(gate_open ? model_scores : silence_scores, current_time, &found_command,
+		                                     &score, &is_new_command);
+		if (is_new_command && (LabelIndex(found_command) > kUnknownIndex)) {
+			gated_detections.push_back({LabelIndex(found_command), current_time});
+		}
+#if CASCADE_GATE
+		cascade_recognizer.ProcessLatestScores(cascade_open ? cascade_scores : silence_scores, current_time,
+		                                       &found_command, &score, &is_new_command);
+		if (is_new_command && (LabelIndex(found_command) > kUnknownIndex)) {
+			cascade_detections.push_back({LabelIndex(found_command), current_time});
+		}
+#endif
+	}
+
+	printf("Audio: %d ms, %d inferences\n", duration_ms, inference_count);
+	printf("Inference duty cycle: %.1f%% (%d of %d)\n",
+	       inference_count > 0 ? 100.0 * gated_inference_count / inference_count : 0.0, gated_inference_count,
+	       inference_count);
+#if CASCADE_GATE
+	// Against the recognition model running on every window of the voice activity gate
+	int cascade_missed = 0;
+	int32_t latency_sum_ms = 0;
+	int32_t latency_max_ms = 0;
+	for (const Detection& detection : gated_detections) {
+		const Detection* match = FindMatch(detection, cascade_detections);
+		if (match == nullptr) {
+			cascade_missed++;
+			continue;
+		}
+		latency_sum_ms += match->time_ms - detection.time_ms;
+		latency_max_ms = std::max(latency_max_ms, match->time_ms - detection.time_ms);
+	}
+	int cascade_added = 0;
+	for (const Detection& detection : cascade_detections) {
+		cascade_added += Matches(detection, gated_detections) ? 0 : 1;
+	}
+	const int matched = (int)gated_detections.size() - cascade_missed;
+	const int window_count = std::max(gated_inference_count, 1);
+	printf("Cascade: recognition model on %d of %d windows, %.1f us gate and %.1f us model per window "
+	       "(%.1f us always running the model)\n",
+	       cascade_inference_count, gated_inference_count, gate_us / window_count, model_us / window_count,
+	       always_us / window_count);
+	printf("Cascade detections: %d, %d false rejects, %d added, latency %+.0f ms mean, %+d ms max\n",
+	       (int)cascade_detections.size(), cascade_missed, cascade_added,
+	       matched > 0 ? (double)latency_sum_ms / matched : 0.0, (int)latency_max_ms);
+#endif
+	int missed = 0;
+	for (const Detection& detection : reference_detections) {
+		const bool found = Matches(detection, gated_detections);
+		printf("  %-8s @%6dms %s\n", kCategoryLabels[detection.label], detection.time_ms, found ? "" : "(rejected by gate)");
+		if (!found) {
+			missed++;
+		}
+	}
+	int added = 0;
+	for (const Detection& detection : gated_detections) {
+		if (!Matches(detection, reference_detections)) {
+			printf("  %-8s @%6dms (only with gate)\n", kCategoryLabels[detection.label], detection.time_ms);
+			added++;
+		}
+	}
+	printf("Detections: %d ungated, %d gated, %d false rejects, %d added\n", (int)reference_detections.size(),
+	       (int)gated_detections.size(), missed, added);
+	return 0;
+}
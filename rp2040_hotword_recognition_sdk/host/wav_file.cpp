@@ -0,0 +1,57 @@
+#include "wav_file.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+uint32_t ReadLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+uint16_t ReadLe16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+}  // namespace
+
+bool ReadWavFile(const char* path, std::vector<int16_t>* samples, int* sample_rate) {
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + read);
+	}
+	fclose(file);
+
+	if ((data.size() < 12) || (memcmp(&data[0], "RIFF", 4) != 0) || (memcmp(&data[8], "WAVE", 4) != 0)) {
+		return false;
+	}
+	int channels = 0;
+	int bits_per_sample = 0;
+	size_t offset = 12;
+	while (offset + 8 <= data.size()) {
+		const uint8_t* chunk = &data[offset];
+		const size_t chunk_size = ReadLe32(chunk + 4);
+		const size_t chunk_end = offset + 8 + chunk_size;
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && chunk_end <= data.size()) {
+			const uint16_t format = ReadLe16(chunk + 8);
+			channels = ReadLe16(chunk + 10);
+			*sample_rate = ReadLe32(chunk + 12);
+			bits_per_sample = ReadLe16(chunk + 22);
+			if ((format != 1) || (bits_per_sample != 16) || (channels < 1)) {
+				return false;
+			}
+		} else if (memcmp(chunk, "data", 4) == 0 && channels > 0) {
+			const size_t available = (chunk_end <= data.size() ? chunk_size : data.size() - offset - 8);
+			const size_t frame_count = available / (2 * channels);
+			samples->resize(frame_count);
+			for (size_t i = 0; i < frame_count; ++i) {
+				(*samples)[i] = (int16_t)ReadLe16(chunk + 8 + i * 2 * channels);
+			}
+			return true;
+		}
+		// Chunks are padded to an even size
+		offset = chunk_end + (chunk_size & 1);
+	}
+	return false;
+}
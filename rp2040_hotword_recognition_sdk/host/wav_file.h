@@ -0,0 +1,12 @@
+#ifndef WAV_FILE_H_
+#define WAV_FILE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+// Reads a 16 bit PCM WAV file. Multi-channel files are reduced to their first
+// channel. Returns false if the file can't be read or has another format.
+bool ReadWavFile(const char* path, std::vector<int16_t>* samples, int* sample_rate);
+
+#endif
@@ -38,4 +38,10 @@ int pdm_microphone_read(int16_t* buffer, size_t samples);
 void pdm_microphone_set_filter_lowpass_hz(float lp_hz);
 void pdm_microphone_set_filter_highpass_hz(float hp_hz);
 
+// Clock scaling: the PIO clock divider register value that keeps the PDM clock
+// at the sample rate with the given system clock, computed ahead, and written
+// with a single register access, so it can follow a change of clk_sys at once
+uint32_t pdm_microphone_get_clkdiv(uint32_t sys_clock_hz);
+void pdm_microphone_set_clkdiv(uint32_t clkdiv);
+
 #endif
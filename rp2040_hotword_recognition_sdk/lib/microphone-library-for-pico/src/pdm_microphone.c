@@ -225,6 +225,27 @@ void pdm_microphone_set_filter_highpass_hz(float hp_hz) {
     pdm_mic.filter.HP_HZ = hp_hz;
 }
 
+// Clock scaling
+uint32_t pdm_microphone_get_clkdiv(uint32_t sys_clock_hz) {
+    if (pdm_mic.config.sample_rate == 0) {
+        return 0;
+    }
+
+    float clk_div = sys_clock_hz / (pdm_mic.config.sample_rate * PDM_DECIMATION * 4.0);
+    uint16_t div_int;
+    uint8_t div_frac;
+    pio_calculate_clkdiv_from_float(clk_div, &div_int, &div_frac);
+
+    return (((uint32_t)div_int) << PIO_SM0_CLKDIV_INT_LSB) | (((uint32_t)div_frac) << PIO_SM0_CLKDIV_FRAC_LSB);
+}
+void pdm_microphone_set_clkdiv(uint32_t clkdiv) {
+    if ((pdm_mic.config.pio == NULL) || (clkdiv == 0)) {
+        return;
+    }
+
+    pdm_mic.config.pio->sm[pdm_mic.config.pio_sm].clkdiv = clkdiv;
+}
+
 int pdm_microphone_read(int16_t* buffer, size_t samples) {
     int filter_stride = (pdm_mic.filter.Fs / 1000);
     samples = (samples / filter_stride) * filter_stride;
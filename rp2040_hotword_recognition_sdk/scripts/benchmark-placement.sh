@@ -0,0 +1,47 @@
+#! /bin/bash
+# Builds the firmware for every placement of model data and hot code
+# (MODEL_DATA_IN_RAM and HOT_CODE_IN_RAM in CMakeLists.txt) into
+# build-placement-<model><code> with the boot benchmarks (BOOT_BENCHMARKS in
+# CMakeLists.txt), uploads it and collects the invoke times printed at boot
+
+SERIAL_PORT=/dev/ttyACM0
+TIMEOUT=60
+
+if [ ! -f "CMakeLists.txt" ] || [ ! -f "cmake/pico_sdk_import.cmake" ] || [ ! -d "src" ] || [ ! -d "lib/microphone-library-for-pico" ]; then
+  echo "Execute benchmark script from project root folder containing CMakeLists.txt"
+  exit 1
+fi
+
+results=()
+for model_in_ram in 0 1; do
+  for code_in_ram in 0 1; do
+    build_path=build-placement-${model_in_ram}${code_in_ram}
+    mkdir -p $build_path
+    (cd $build_path && cmake .. -DMODEL_DATA_IN_RAM=$model_in_ram -DHOT_CODE_IN_RAM=$code_in_ram -DBOOT_BENCHMARKS=1 > /dev/null && make -j$(nproc) > /dev/null)
+    if [ $? -ne 0 ]; then
+      echo "Build in $build_path failed"
+      exit 1
+    fi
+    ./scripts/upload-uf2.sh $build_path
+
+    # The boot output waits on the device until the restarted serial port is opened
+    echo -n "Waiting for $SERIAL_PORT "
+    while [ ! -c "$SERIAL_PORT" ]; do
+      echo -n "."
+      sleep 0.5
+    done
+    echo ""
+    sleep 1
+    line=$(timeout $TIMEOUT grep -a -m 1 "Invoke time" $SERIAL_PORT)
+    if [ -z "$line" ]; then
+      line="no invoke time within $TIMEOUT s"
+    fi
+    echo "$line"
+    results+=("$line")
+  done
+done
+
+echo ""
+for line in "${results[@]}"; do
+  echo "$line"
+done
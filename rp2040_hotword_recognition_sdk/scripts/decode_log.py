@@ -0,0 +1,141 @@
+#! /usr/bin/env python3
+# Decodes the binary frames of the log ring (g_binary_log_enabled in src/config.h)
+# from the serial output of the device or a recorded file into text, with the
+# message formats of src/log_messages.h, and passes the text output through.
+# Usage: decode_log.py [--time] [serial port or file] (default: /dev/ttyACM0)
+# With --time, decoded lines start with the device time in ms and the core.
+
+import os
+import re
+import struct
+import sys
+import tty
+
+SYNC = b"\x00\xa7"
+FRAME_VERSION = 1
+HEADER_SIZE = 4
+CHECKSUM_SIZE = 2
+TEXT_ID = 0
+MESSAGES_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "log_messages.h")
+
+
+def fletcher16(data):
+  sum1 = 0
+  sum2 = 0
+  for byte in data:
+    sum1 = (sum1 + byte) % 255
+    sum2 = (sum2 + sum1) % 255
+  return (sum2 << 8) | sum1
+
+
+def read_formats(path):
+  """Returns the format strings of the LOG_MESSAGE list, indexed by message ID."""
+  with open(path) as header:
+    source = header.read().replace("\\\n", " ")
+  entries = re.findall(r'LOG_MESSAGE\(\s*(\w+)\s*,\s*((?:"(?:[^"\\]|\\.)*"\s*)+)\)', source)
+  formats = []
+  for _, literals in entries:
+    text = "".join(re.findall(r'"((?:[^"\\]|\\.)*)"', literals))
+    formats.append(text.encode("latin-1").decode("unicode_escape"))
+  return formats
+
+
+def decode_arguments(payload, arg_count, string_args):
+  """Returns the arguments of a message frame."""
+  args = []
+  offset = 0
+  for i in range(arg_count):
+    if string_args & (1 << i):
+      length = payload[offset]
+      args.append(payload[offset + 1:offset + 1 + length].decode("utf-8", "replace"))
+      offset += 1 + length
+    else:
+      (value,) = struct.unpack_from("<i", payload, offset)
+      args.append(value)
+      offset += 4
+  return tuple(args)
+
+
+class LogDecoder:
+  def __init__(self, formats, show_time):
+    self.formats = formats
+    self.show_time = show_time
+    # Text of the debug log callback arrives in pieces, collected per core
+    self.lines = {}
+
+  def print_line(self, core, time_us, text):
+    if self.show_time:
+      text = "%10.3f c%d | %s" % (time_us / 1000.0, core, text)
+    print(text)
+
+  def decode_frame(self, payload):
+    core, message_id, arg_count, string_args, time_us = struct.unpack_from("<BHBBI", payload, 0)
+    body = payload[9:]
+    if message_id == TEXT_ID:
+      text = self.lines.get(core, "") + body[:arg_count].decode("utf-8", "replace")
+      *complete, rest = text.split("\n")
+      for line in complete:
+        self.print_line(core, time_us, line.rstrip("\r"))
+      self.lines[core] = rest
+    elif message_id < len(self.formats):
+      args = decode_arguments(body, arg_count, string_args)
+      try:
+        text = self.formats[message_id] % args
+      except (TypeError, ValueError):
+        text = "%s %r" % (self.formats[message_id], args)
+      self.print_line(core, time_us, text)
+    else:
+      self.print_line(core, time_us, "Unknown log message %d, is %s up to date?" % (message_id, MESSAGES_PATH))
+
+  def decode_stream(self, stream):
+    buffer = b""
+    while True:
+      data = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+      if not data:
+        break
+      buffer += data
+      while True:
+        start = buffer.find(SYNC)
+        if start < 0:
+          # Keep a possible partial sync byte
+          keep = 1 if buffer.endswith(SYNC[:1]) else 0
+          sys.stdout.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+          buffer = buffer[len(buffer) - keep:]
+          break
+        sys.stdout.write(buffer[:start].decode("utf-8", "replace"))
+        buffer = buffer[start:]
+        if len(buffer) < HEADER_SIZE:
+          break
+        version, payload_size = struct.unpack_from("<BB", buffer, 2)
+        frame_size = HEADER_SIZE + payload_size + CHECKSUM_SIZE
+        if len(buffer) < frame_size:
+          break
+        payload = buffer[HEADER_SIZE:HEADER_SIZE + payload_size]
+        (checksum,) = struct.unpack_from("<H", buffer, HEADER_SIZE + payload_size)
+        if (version != FRAME_VERSION) or (payload_size < 9) or (checksum != fletcher16(payload)):
+          # Not a valid frame, skip the sync and resynchronize
+          buffer = buffer[len(SYNC):]
+          continue
+        self.decode_frame(payload)
+        buffer = buffer[frame_size:]
+      sys.stdout.flush()
+
+
+def main():
+  args = sys.argv[1:]
+  show_time = "--time" in args
+  args = [arg for arg in args if arg != "--time"]
+  path = args[0] if args else "/dev/ttyACM0"
+  decoder = LogDecoder(read_formats(MESSAGES_PATH), show_time)
+  with open(path, "rb", buffering=0) as stream:
+    # Binary frames must not pass the newline translation of the terminal
+    if os.isatty(stream.fileno()):
+      tty.setraw(stream.fileno())
+    try:
+      decoder.decode_stream(stream)
+    except KeyboardInterrupt:
+      pass
+
+
+if __name__ == "__main__":
+  main()
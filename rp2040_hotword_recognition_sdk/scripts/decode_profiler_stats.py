@@ -0,0 +1,93 @@
+#! /usr/bin/env python3
+# Decodes the binary operator statistics frames of the StatsProfiler
+# (MICRO_PROFILER 2 in CMakeLists.txt) from the serial output of the device or a
+# recorded file and passes the text output through.
+# Usage: decode_profiler_stats.py [serial port or file] (default: /dev/ttyACM0)
+
+import os
+import struct
+import sys
+import tty
+
+SYNC = b"\x00\xa5"
+FRAME_VERSION = 1
+HEADER_SIZE = 6
+CHECKSUM_SIZE = 2
+
+
+def fletcher16(data):
+  sum1 = 0
+  sum2 = 0
+  for byte in data:
+    sum1 = (sum1 + byte) % 255
+    sum2 = (sum2 + sum1) % 255
+  return (sum2 << 8) | sum1
+
+
+def decode_payload(payload, tag_count):
+  """Returns a list of (tag, count, min, mean, max, p99) tuples."""
+  stats = []
+  offset = 0
+  for _ in range(tag_count):
+    tag_length = payload[offset]
+    offset += 1
+    tag = payload[offset:offset + tag_length].decode("ascii", "replace")
+    offset += tag_length
+    count, min_ticks, mean_ticks, max_ticks, p99_ticks = struct.unpack_from("<Hiiii", payload, offset)
+    offset += struct.calcsize("<Hiiii")
+    stats.append((tag, count, min_ticks, mean_ticks, max_ticks, p99_ticks))
+  return stats
+
+
+def print_stats(stats):
+  print("%-20s %6s %8s %8s %8s %8s" % ("Operator", "Count", "Min us", "Mean us", "Max us", "P99 us"))
+  for tag, count, min_ticks, mean_ticks, max_ticks, p99_ticks in stats:
+    print("%-20s %6d %8d %8d %8d %8d" % (tag, count, min_ticks, mean_ticks, max_ticks, p99_ticks))
+  print(flush=True)
+
+
+def decode_stream(stream):
+  buffer = b""
+  while True:
+    data = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+    if not data:
+      break
+    buffer += data
+    while True:
+      start = buffer.find(SYNC)
+      if start < 0:
+        # Keep a possible partial sync byte
+        keep = 1 if buffer.endswith(SYNC[:1]) else 0
+        sys.stdout.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+        buffer = buffer[len(buffer) - keep:]
+        break
+      sys.stdout.write(buffer[:start].decode("utf-8", "replace"))
+      buffer = buffer[start:]
+      if len(buffer) < HEADER_SIZE:
+        break
+      version, tag_count, payload_size = struct.unpack_from("<BBH", buffer, 2)
+      frame_size = HEADER_SIZE + payload_size + CHECKSUM_SIZE
+      if len(buffer) < frame_size:
+        break
+      payload = buffer[HEADER_SIZE:HEADER_SIZE + payload_size]
+      (checksum,) = struct.unpack_from("<H", buffer, HEADER_SIZE + payload_size)
+      if (version != FRAME_VERSION) or (checksum != fletcher16(payload)):
+        # Not a valid frame, skip the sync and resynchronize
+        buffer = buffer[len(SYNC):]
+        continue
+      print_stats(decode_payload(payload, tag_count))
+      buffer = buffer[frame_size:]
+  sys.stdout.flush()
+
+
+def main():
+  path = sys.argv[1] if len(sys.argv) > 1 else "/dev/ttyACM0"
+  with open(path, "rb", buffering=0) as stream:
+    # Binary frames must not pass the newline translation of the terminal
+    if os.isatty(stream.fileno()):
+      tty.setraw(stream.fileno())
+    decode_stream(stream)
+
+
+if __name__ == "__main__":
+  main()
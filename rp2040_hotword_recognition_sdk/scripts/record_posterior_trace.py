@@ -0,0 +1,81 @@
+#! /usr/bin/env python3
+# Records the binary posterior trace frames of the firmware (g_trace_output_enabled
+# in src/config.h) from the serial output of the device into a trace file for
+# the host tool recognizer_tuning, and passes the text output through.
+# Usage: record_posterior_trace.py trace.bin [serial port] (default: /dev/ttyACM0)
+# Stop recording with Ctrl+C.
+
+import os
+import struct
+import sys
+import tty
+
+SYNC = b"\x00\xa6"
+FRAME_VERSION = 1
+HEADER_SIZE = 4
+TIME_SIZE = 4
+CHECKSUM_SIZE = 2
+
+
+def fletcher16(data):
+  sum1 = 0
+  sum2 = 0
+  for byte in data:
+    sum1 = (sum1 + byte) % 255
+    sum2 = (sum2 + sum1) % 255
+  return (sum2 << 8) | sum1
+
+
+def record_stream(stream, trace):
+  buffer = b""
+  while True:
+    data = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+    if not data:
+      break
+    buffer += data
+    while True:
+      start = buffer.find(SYNC)
+      if start < 0:
+        # Keep a possible partial sync byte
+        keep = 1 if buffer.endswith(SYNC[:1]) else 0
+        sys.stdout.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+        buffer = buffer[len(buffer) - keep:]
+        break
+      sys.stdout.write(buffer[:start].decode("utf-8", "replace"))
+      buffer = buffer[start:]
+      if len(buffer) < HEADER_SIZE:
+        break
+      version, category_count = struct.unpack_from("<BB", buffer, 2)
+      payload_size = TIME_SIZE + category_count
+      frame_size = HEADER_SIZE + payload_size + CHECKSUM_SIZE
+      if len(buffer) < frame_size:
+        break
+      payload = buffer[HEADER_SIZE:HEADER_SIZE + payload_size]
+      (checksum,) = struct.unpack_from("<H", buffer, HEADER_SIZE + payload_size)
+      if (version != FRAME_VERSION) or (checksum != fletcher16(payload)):
+        # Not a valid frame, skip the sync and resynchronize
+        buffer = buffer[len(SYNC):]
+        continue
+      trace.write(buffer[:frame_size])
+      buffer = buffer[frame_size:]
+    sys.stdout.flush()
+
+
+def main():
+  if len(sys.argv) < 2:
+    print("Usage: %s trace.bin [serial port]" % sys.argv[0], file=sys.stderr)
+    sys.exit(1)
+  path = sys.argv[2] if len(sys.argv) > 2 else "/dev/ttyACM0"
+  with open(sys.argv[1], "wb") as trace, open(path, "rb", buffering=0) as stream:
+    # Binary frames must not pass the newline translation of the terminal
+    if os.isatty(stream.fileno()):
+      tty.setraw(stream.fileno())
+    try:
+      record_stream(stream, trace)
+    except KeyboardInterrupt:
+      pass
+    print("Recorded %d bytes of frames to %s" % (trace.tell(), sys.argv[1]), file=sys.stderr)
+
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,52 @@
+# MFCC feature mode for the micro preprocessing of the tensorflow speech_commands
+# training scripts. The firmware (MFCC_COEFFICIENTS in CMakeLists.txt) applies a
+# DCT-II to the 40 channel log filterbank output of the micro frontend and keeps
+# the lowest coefficients. This module applies the same Q15 DCT table during
+# training and freezing, so the trained model sees the features of the device.
+import math
+import os
+import re
+
+# Channels of the micro frontend filterbank the DCT is applied to
+FILTERBANK_CHANNELS = 40
+
+
+def dct_matrix(coefficients, channels=FILTERBANK_CHANNELS):
+  """DCT-II rows scaled by sqrt(2/N), rounded to the Q15 table of the firmware."""
+  scale = math.sqrt(2.0 / channels)
+  return [[math.floor(32768.0 * scale * math.cos(math.pi * k * (n + 0.5) / channels) + 0.5) / 32768.0
+           for n in range(channels)] for k in range(coefficients)]
+
+
+def apply(fingerprint, coefficients):
+  """Reduces [..., FILTERBANK_CHANNELS] log filterbank features to coefficients."""
+  if coefficients >= FILTERBANK_CHANNELS:
+    return fingerprint
+  import tensorflow as tf
+  dct = tf.constant(dct_matrix(coefficients), dtype=tf.float32)
+  return tf.tensordot(fingerprint, tf.transpose(dct), axes=1)
+
+
+def patch_speech_commands_scripts(path):
+  """Patches input_data.py and freeze.py of a speech_commands copy.
+
+  The micro frontend is then always run with FILTERBANK_CHANNELS channels and
+  reduced to the fingerprint width (--feature_bin_count) by apply(). Patching is
+  idempotent, a feature bin count of 40 keeps the original log filterbank features.
+  """
+  for name in ("input_data.py", "freeze.py"):
+    filename = os.path.join(path, name)
+    with open(filename) as file:
+      source = file.read()
+    if "micro_mfcc" in source:
+      continue
+    source = source.replace("num_channels=model_settings['fingerprint_width']",
+                            "num_channels=micro_mfcc.FILTERBANK_CHANNELS")
+    source, count = re.subn(r"tf\.multiply\(micro_frontend, \(10\.0 / 256\.0\)\)",
+                            "micro_mfcc.apply(tf.multiply(micro_frontend, (10.0 / 256.0)), "
+                            "model_settings['fingerprint_width'])", source)
+    if count == 0:
+      raise RuntimeError("micro frontend scaling not found in " + filename)
+    source = "import micro_mfcc\n" + source
+    with open(filename, "w") as file:
+      file.write(source)
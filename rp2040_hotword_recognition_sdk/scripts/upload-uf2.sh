@@ -3,7 +3,7 @@
 SERIAL_PORT=/dev/ttyACM0
 MICRO_PATH=/media/${USER}/RPI-RP2
 MAGIC_BAUD_RATE=1200
-BUILD_PATH=build
+BUILD_PATH=${1:-build}
 
 if [ ! -f "CMakeLists.txt" ] || [ ! -f "cmake/pico_sdk_import.cmake" ] || [ ! -d "src" ] || [ ! -d "lib" ]; then
   echo "Execute upload script from project root folder containing CMakeLists.txt"
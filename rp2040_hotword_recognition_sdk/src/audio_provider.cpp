@@ -27,10 +27,20 @@ limitations under the License.
 #include <stdio.h>        // printf
 #include <pico/stdlib.h>  // leds
 
+namespace {
+// Called whenever the audio crosses a feature slice stride
+void (*g_audio_slice_handler)() = nullptr;
+}  // namespace
+
+void SetAudioSliceHandler(void (*handler)()) { g_audio_slice_handler = handler; }
+
 #ifndef LOADDATA
 
+#include <hardware/sync.h>  // __wfe
+
 #ifdef PRINTTIMINGS
 #include <pico/time.h>  // time
+#include "log_ring.h"
 #endif
 
 #ifdef __cplusplus
@@ -41,12 +51,12 @@ extern "C" {
 }
 #endif
 
-#define SAMPLE_BUFFER_SIZE 16
+#define SAMPLE_BUFFER_SIZE kAudioCaptureBlockSize
 
 namespace {
 bool g_is_audio_initialized = false;
-// An internal buffer able to fit 16x our sample size
-constexpr int kAudioCaptureBufferSize = SAMPLE_BUFFER_SIZE * 16;
+// The capture ring, see kAudioCaptureRingBlockCount
+constexpr int kAudioCaptureBufferSize = SAMPLE_BUFFER_SIZE * kAudioCaptureRingBlockCount;
 int16_t g_audio_capture_buffer[kAudioCaptureBufferSize];
 // A buffer that holds our output
 int16_t g_audio_output_buffer[kMaxAudioSampleSize];
@@ -80,7 +90,12 @@ void CaptureSamples() {
 	// Read the data to the correct place in our buffer
 	pdm_microphone_read(g_audio_capture_buffer + capture_index, number_of_samples);
 	// This is how we let the outside world know that new audio data has arrived.
+	const bool is_new_slice =
+	    (time_in_ms / kFeatureSliceStrideMs) != (g_latest_audio_timestamp / kFeatureSliceStrideMs);
 	g_latest_audio_timestamp = time_in_ms;
+	if (is_new_slice && (g_audio_slice_handler != nullptr)) {
+		g_audio_slice_handler();
+	}
 
 #ifdef PRINTTIMINGS
 	absolute_time_t end_time = get_absolute_time();
@@ -130,19 +145,16 @@ TfLiteStatus InitAudioRecording(tflite::ErrorReporter* error_reporter) {
 		TF_LITE_REPORT_ERROR(error_reporter, "Microphone started");
 	}
 
-	// Block until we have our first audio sample
+	// Block until we have our first audio sample, the capture interrupt ends the
+	// sleep
 	while (!g_latest_audio_timestamp) {
+		__wfe();
 	}
 
 	return kTfLiteOk;
 }
 
-TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter, int start_ms, int duration_ms,
-                             int* audio_samples_size, int16_t** audio_samples) {
-#ifdef PRINTTIMINGS
-	absolute_time_t start_time = get_absolute_time();
-#endif
-	// Set everything up to start receiving audio
+TfLiteStatus StartAudioCapture(tflite::ErrorReporter* error_reporter) {
 	if (!g_is_audio_initialized) {
 		TfLiteStatus init_status = InitAudioRecording(error_reporter);
 		if (init_status != kTfLiteOk) {
@@ -150,6 +162,19 @@ TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter, int start_ms
 		}
 		g_is_audio_initialized = true;
 	}
+	return kTfLiteOk;
+}
+
+TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter, int start_ms, int duration_ms,
+                             int* audio_samples_size, int16_t** audio_samples) {
+#ifdef PRINTTIMINGS
+	absolute_time_t start_time = get_absolute_time();
+#endif
+	// Set everything up to start receiving audio
+	TfLiteStatus start_status = StartAudioCapture(error_reporter);
+	if (start_status != kTfLiteOk) {
+		return start_status;
+	}
 	// This next part should only be called when the main thread notices that the
 	// latest audio sample data timestamp has changed, so that there's new data
 	// in the capture ring buffer. The ring buffer will eventually wrap around and
@@ -179,12 +204,8 @@ TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter, int start_ms
 	write_time = absolute_time_diff_us(start_time, end_time);
 	write_interval = absolute_time_diff_us(write_timestamp, end_time);
 	write_timestamp = end_time;
-	printf("rec time: %lld us\n", rec_time);
-	printf("rec interval: %lld us\n", rec_interval);
-	printf("write time: %lld us\n", write_time);
-	printf("write interval: %lld us\n", write_interval);
-	printf("g_latest_audio_timestamp: %d\n", g_latest_audio_timestamp);
-	printf("\n");
+	Log(kLogAudioTimings, (int32_t)rec_time, (int32_t)rec_interval, (int32_t)write_time, (int32_t)write_interval,
+	    (int32_t)g_latest_audio_timestamp);
 #endif
 
 	return kTfLiteOk;
@@ -192,8 +213,43 @@ TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter, int start_ms
 
 int32_t LatestAudioTimestamp() { return g_latest_audio_timestamp; }
 
+const int16_t* GetCapturedAudioBlock(int32_t time_ms) {
+	const int32_t latest_time = g_latest_audio_timestamp;
+	// The block of the next capture interrupt replaces the oldest one
+	if ((time_ms < 0) || (time_ms >= latest_time) || (time_ms <= latest_time - kAudioCaptureRingBlockCount)) {
+		return nullptr;
+	}
+	const int32_t start_sample_offset = time_ms * (kAudioSampleFrequency / 1000);
+	return g_audio_capture_buffer + (start_sample_offset % kAudioCaptureBufferSize);
+}
+
 #else  // LOADDATA
 
+namespace {
+repeating_timer_t g_slice_timer;
+bool g_is_slice_timer_started = false;
+
+bool OnSliceTimer(repeating_timer_t* timer) {
+	if (g_audio_slice_handler != nullptr) {
+		g_audio_slice_handler();
+	}
+	return true;
+}
+}  // namespace
+
+// The test data is not captured in blocks
+const int16_t* GetCapturedAudioBlock(int32_t time_ms) { return nullptr; }
+
+// The test data needs no warm-up. A timer stands in for the capture interrupt
+// and calls the slice handler at the rate of a microphone.
+TfLiteStatus StartAudioCapture(tflite::ErrorReporter* error_reporter) {
+	if (!g_is_slice_timer_started) {
+		add_repeating_timer_ms(kFeatureSliceStrideMs, OnSliceTimer, nullptr, &g_slice_timer);
+		g_is_slice_timer_started = true;
+	}
+	return kTfLiteOk;
+}
+
 #ifndef CUSTOMDATA
 // Load example test data files
 // https://raw.githubusercontent.com/adafruit/Adafruit_TFLite_Micro_Speech/master/examples/micro_speech_mock/audio_provider.cpp
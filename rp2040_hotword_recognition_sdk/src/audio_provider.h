@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_PROVIDER_H_
 #define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_PROVIDER_H_
 
+#include "config.h"
+#include "micro_features/micro_model_settings.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 
@@ -33,6 +35,36 @@ TfLiteStatus GetAudioSamples(tflite::ErrorReporter* error_reporter,
                              int start_ms, int duration_ms,
                              int* audio_samples_size, int16_t** audio_samples);
 
+// Starts the audio capture ahead of the first GetAudioSamples() call, which
+// otherwise starts it, so the microphone warms up while the rest of the
+// application initializes. The capture interrupt runs on the calling core.
+TfLiteStatus StartAudioCapture(tflite::ErrorReporter* error_reporter);
+
+// Sets a function called from the capture interrupt whenever the captured audio
+// crosses a feature slice stride, so a new slice can be computed, instead of
+// polling LatestAudioTimestamp(). Set it before the capture starts.
+void SetAudioSliceHandler(void (*handler)());
+
+// Samples per block of the capture interrupt, 1 ms of audio
+constexpr int kAudioCaptureBlockSize = 16;
+
+// Blocks of the capture ring. After a stall the feature provider fetches the
+// audio of every slice it computes in one call: up to the whole window with
+// kCatchUpAll and kCatchUpBounded, at most g_feature_max_slices_per_call slices
+// with kCatchUpNewest (src/config.h). The ring holds the audio of these slices,
+// and one stride more for the capture that continues during the call.
+constexpr int kAudioCaptureRingBlockCount =
+    (((g_feature_catch_up_policy == kCatchUpNewest) ? g_feature_max_slices_per_call : kFeatureSliceCount) + 1) *
+        kFeatureSliceStrideMs +
+    kFeatureSliceDurationMs;
+
+// Returns the captured block of kAudioCaptureBlockSize samples that starts at
+// time_ms, in place in the capture ring, so further consumers like the USB
+// microphone (src/usb/usb_composite.h) need no copy. Returns nullptr if the block
+// was not captured yet or is about to be overwritten. A block stays valid for
+// kAudioCaptureRingBlockCount - 1 ms after it was captured.
+const int16_t* GetCapturedAudioBlock(int32_t time_ms);
+
 // Returns the time that audio data was last captured in milliseconds. There's
 // no contract about what time zero represents, the accuracy, or the granularity
 // of the result. Subsequent calls will generally not return a lower value, but
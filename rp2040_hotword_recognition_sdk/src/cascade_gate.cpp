@@ -0,0 +1,46 @@
+#include "cascade_gate.h"
+
+#include <math.h>
+
+namespace {
+// Category of the yes/no model, see micro_model_settings.cpp
+constexpr int kGateSilenceIndex = 0;
+}  // namespace
+
+CascadeGate::CascadeGate(uint8_t threshold, int32_t hold_ms)
+    : threshold_(threshold), hold_ms_(hold_ms), has_fired_(false), fired_time_(0) {
+	for (int i = 0; i < 256; i++) {
+		input_table_[i] = static_cast<int8_t>(i - 128);
+	}
+}
+
+void CascadeGate::SetInputQuantization(float scale, int32_t zero_point, float gate_scale, int32_t gate_zero_point) {
+#if MFCC_COEFFICIENTS > 0
+	// Cepstral features are quantized with the input scale of the recognition model
+	for (int i = 0; i < 256; i++) {
+		const int32_t value = lroundf((i - 128 - zero_point) * scale / gate_scale) + gate_zero_point;
+		input_table_[i] = static_cast<int8_t>(value < -128 ? -128 : (value > 127 ? 127 : value));
+	}
+#else
+	// Log-mel features have a fixed quantization (see GenerateMicroFeatures())
+	(void)scale;
+	(void)zero_point;
+	(void)gate_scale;
+	(void)gate_zero_point;
+#endif
+}
+
+void CascadeGate::ConvertFeatures(const int8_t* features, int8_t* gate_input, int count) const {
+	for (int i = 0; i < count; i++) {
+		gate_input[i] = input_table_[features[i] + 128];
+	}
+}
+
+bool CascadeGate::Update(const int8_t* gate_scores, int32_t current_time) {
+	const int speech_score = 127 - gate_scores[kGateSilenceIndex];
+	if (speech_score >= threshold_) {
+		has_fired_ = true;
+		fired_time_ = current_time;
+	}
+	return has_fired_ && (current_time - fired_time_ <= hold_ms_);
+}
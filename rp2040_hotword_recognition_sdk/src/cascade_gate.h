@@ -0,0 +1,36 @@
+#ifndef CASCADE_GATE_H_
+#define CASCADE_GATE_H_
+
+#include <stdint.h>
+
+// Gate of the two-stage cascade (CASCADE_GATE in CMakeLists.txt): the small
+// yes/no model runs on every spectrogram window and the recognition model only
+// while the gate model finds speech, and for a hold time after, so a word is
+// still recognized over all windows it passes through.
+class CascadeGate {
+ public:
+	// Opens the gate if the speech score of the gate model (255 minus its
+	// silence score) reaches the threshold, and keeps it open for hold_ms
+	CascadeGate(uint8_t threshold, int32_t hold_ms);
+
+	// Takes the input quantization of the recognition model, whose features are
+	// converted for the gate model
+	void SetInputQuantization(float scale, int32_t zero_point, float gate_scale, int32_t gate_zero_point);
+
+	// Converts features of the recognition model into gate model input
+	void ConvertFeatures(const int8_t* features, int8_t* gate_input, int count) const;
+
+	// Takes the gate model scores of the window at current_time and returns
+	// whether the recognition model runs on it
+	bool Update(const int8_t* gate_scores, int32_t current_time);
+
+ private:
+	uint8_t threshold_;
+	int32_t hold_ms_;
+	bool has_fired_;
+	int32_t fired_time_;
+	// Gate model input by recognition model input + 128
+	int8_t input_table_[256];
+};
+
+#endif
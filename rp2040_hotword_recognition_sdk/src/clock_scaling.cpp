@@ -0,0 +1,138 @@
+#include "clock_scaling.h"
+
+#include "config.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/vreg.h"
+#include "log_ring.h"
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "pico/pdm_microphone.h"
+#ifdef __cplusplus
+}
+#endif
+
+namespace {
+// Core voltage after reset
+constexpr int32_t kBootVoltageMv = 1100;
+
+struct OperatingPoint {
+	const char* name;
+	uint32_t clock_khz;
+	int32_t voltage_mv;
+	// Integer divider of clk_sys from PLL_SYS
+	uint32_t divider;
+	// Inferences since the last report
+	int32_t inference_count;
+	uint64_t invoke_us;
+	// Waits for the voltage to settle before the switches to the point since the
+	// last report, at the clock of the point switched from
+	uint64_t settle_us;
+	uint32_t settle_clock_khz;
+};
+
+OperatingPoint operating_points[kClockOperatingPointCount] = {
+    {"idle", 0, kBootVoltageMv, 1, 0, 0, 0, 0},
+    {"boost", 0, kBootVoltageMv, 1, 0, 0, 0, 0},
+};
+bool is_scaling_active = false;
+ClockOperatingPoint current_point = kClockIdle;
+int32_t report_time = 0;
+
+enum vreg_voltage VoltageSetting(int32_t voltage_mv) {
+	// VREG_VOLTAGE_0_85 to VREG_VOLTAGE_1_30 in steps of 50 mV
+	const int32_t clamped_mv = (voltage_mv < 850) ? 850 : ((voltage_mv > 1300) ? 1300 : voltage_mv);
+	return static_cast<enum vreg_voltage>(VREG_VOLTAGE_0_85 + (clamped_mv - 850) / 50);
+}
+
+// Estimated core energy in uJ of running for duration_us: the current scales with
+// clock and voltage, the power with the voltage once more
+uint64_t EstimateEnergyUj(uint32_t clock_khz, int32_t voltage_mv, uint64_t duration_us) {
+	const uint64_t current_ua =
+	    ((uint64_t)g_clock_core_ua_per_mhz * clock_khz * voltage_mv) / (1000 * (uint64_t)kBootVoltageMv);
+	return (current_ua * voltage_mv * duration_us) / 1000000000ull;
+}
+}  // namespace
+
+void InitClockScaling() {
+	const uint32_t boot_khz = clock_get_hz(clk_sys) / 1000;
+	for (OperatingPoint& point : operating_points) {
+		point.clock_khz = boot_khz;
+	}
+	if (!g_clock_scaling_enabled) {
+		return;
+	}
+	// PLL_SYS runs at the boost frequency from now on
+	vreg_set_voltage(VoltageSetting(g_boost_voltage_mv));
+	busy_wait_us_32(g_voltage_settle_us);
+	if (!set_sys_clock_khz(g_boost_clock_khz, false)) {
+		vreg_set_voltage(VoltageSetting(kBootVoltageMv));
+		return;
+	}
+	operating_points[kClockBoost].clock_khz = g_boost_clock_khz;
+	operating_points[kClockBoost].voltage_mv = g_boost_voltage_mv;
+	operating_points[kClockIdle].clock_khz = g_boost_clock_khz / g_idle_clock_divider;
+	operating_points[kClockIdle].voltage_mv = g_idle_voltage_mv;
+	operating_points[kClockIdle].divider = g_idle_clock_divider;
+	is_scaling_active = true;
+	current_point = kClockBoost;
+	SetClockOperatingPoint(kClockIdle);
+}
+
+void SetClockOperatingPoint(ClockOperatingPoint point) {
+	if (!is_scaling_active || (point == current_point)) {
+		return;
+	}
+	const OperatingPoint& current = operating_points[current_point];
+	const OperatingPoint& next = operating_points[point];
+	// Before the microphone is initialized, it picks up the reported clock itself
+	const uint32_t pdm_clkdiv = pdm_microphone_get_clkdiv(next.clock_khz * 1000);
+	if (next.voltage_mv > current.voltage_mv) {
+		vreg_set_voltage(VoltageSetting(next.voltage_mv));
+		busy_wait_us_32(g_voltage_settle_us);
+		operating_points[point].settle_us += g_voltage_settle_us;
+		operating_points[point].settle_clock_khz = current.clock_khz;
+	}
+	const uint32_t interrupts = save_and_disable_interrupts();
+	clocks_hw->clk[clk_sys].div = next.divider << CLOCKS_CLK_SYS_DIV_INT_LSB;
+	pdm_microphone_set_clkdiv(pdm_clkdiv);
+	restore_interrupts(interrupts);
+	clock_set_reported_hz(clk_sys, next.clock_khz * 1000);
+	if (next.voltage_mv < current.voltage_mv) {
+		vreg_set_voltage(VoltageSetting(next.voltage_mv));
+	}
+	current_point = point;
+}
+
+void RecordClockInference(uint32_t invoke_us) {
+	OperatingPoint& point = operating_points[current_point];
+	point.inference_count++;
+	point.invoke_us += invoke_us;
+}
+
+void ReportClockScaling() {
+	for (OperatingPoint& point : operating_points) {
+		if (point.inference_count > 0) {
+			const uint32_t mean_us = (uint32_t)(point.invoke_us / point.inference_count);
+			const uint64_t energy_uj = EstimateEnergyUj(point.clock_khz, point.voltage_mv, point.invoke_us) +
+			                           EstimateEnergyUj(point.settle_clock_khz, point.voltage_mv, point.settle_us);
+			Log(kLogClockPoint, point.name, (int32_t)(point.clock_khz / 1000), point.voltage_mv,
+			    point.inference_count, (int32_t)mean_us, (int32_t)(energy_uj / point.inference_count));
+		}
+		point.inference_count = 0;
+		point.invoke_us = 0;
+		point.settle_us = 0;
+	}
+}
+
+void ReportClockScalingIfDue(int32_t current_time) {
+	if ((g_clock_report_interval_ms <= 0) || (current_time - report_time < g_clock_report_interval_ms)) {
+		return;
+	}
+	ReportClockScaling();
+	report_time = current_time;
+}
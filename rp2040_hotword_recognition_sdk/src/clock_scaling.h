@@ -0,0 +1,46 @@
+#ifndef CLOCK_SCALING_H_
+#define CLOCK_SCALING_H_
+
+#include <stdint.h>
+
+// Dynamic voltage and frequency scaling of clk_sys (g_clock_scaling_enabled in
+// src/config.h). The model, and the gate model of the cascade, runs at the
+// boost point, everything else, the frontend, the recognizer and the idle sleep,
+// at the idle point.
+//
+// PLL_SYS is set to the boost frequency once at boot and the idle point divides
+// it with the integer divider of clk_sys, so switching never relocks the PLL or
+// runs clk_sys from the reference clock in between. The clk_sys divider and the
+// PIO divider of the PDM microphone are written back to back with interrupts
+// masked, so the PDM clock is only off for a few cycles and capture keeps its
+// sample rate. The core voltage is raised, and left to settle, before the clock
+// goes up, and lowered after it went down.
+//
+// The invoke time at each point is counted, and the energy per inference
+// estimated with the current model of g_clock_core_ua_per_mhz, since the board
+// cannot measure its supply current. The estimate includes the wait for the
+// voltage to settle before switching to the point, at the raised voltage and
+// the clock before the switch.
+enum ClockOperatingPoint { kClockIdle, kClockBoost, kClockOperatingPointCount };
+
+// Sets PLL_SYS to the boost frequency and switches to the idle point. Call once
+// from core 0 at boot, before the microphone starts. Without clock scaling, or
+// if the boost frequency cannot be reached, both points stay at the boot clock.
+void InitClockScaling();
+
+// Switches clk_sys, the core voltage and the PDM divider to the point. Call from
+// core 0 only.
+void SetClockOperatingPoint(ClockOperatingPoint point);
+
+// Counts an inference that took invoke_us at the current operating point
+void RecordClockInference(uint32_t invoke_us);
+
+// Logs clock, voltage, inference count, mean invoke time and estimated energy per
+// inference, settling included, of each operating point that ran inferences, and
+// resets the counts
+void ReportClockScaling();
+
+// Calls ReportClockScaling() every g_clock_report_interval_ms
+void ReportClockScalingIfDue(int32_t current_time);
+
+#endif
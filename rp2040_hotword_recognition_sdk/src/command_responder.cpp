@@ -15,14 +15,34 @@ limitations under the License.
 
 #include "command_responder.h"
 
+#include "log_ring.h"
+
 // The default implementation writes out the name of the recognized command
-// to the error console. Real applications will want to take some custom
-// action instead, and should implement their own versions of this function.
+// to the log ring (src/log_ring.h), which does not wait for the serial port.
+// Real applications will want to take some custom action instead, and should
+// implement their own versions of this function.
 void RespondToCommand(tflite::ErrorReporter* error_reporter,
                       int32_t current_time, const char* found_command,
                       uint8_t score, bool is_new_command) {
   if (is_new_command) {
-    TF_LITE_REPORT_ERROR(error_reporter, "Heard %s (%d) @%dms", found_command,
-                         score, current_time);
+    Log(kLogHeard, found_command, score, current_time);
+  }
+}
+
+void RespondToCommandSequence(tflite::ErrorReporter* error_reporter,
+                              const char* sequence, int32_t start_time,
+                              int32_t end_time) {
+  Log(kLogHeardSequence, sequence, start_time, end_time);
+}
+
+void RespondToEarlyCommit(tflite::ErrorReporter* error_reporter,
+                          int32_t current_time, const char* command,
+                          uint8_t score, EarlyCommitRecognizer::Event event) {
+  if (event == EarlyCommitRecognizer::kCommitted) {
+    Log(kLogHeardEarly, command, score, current_time);
+  } else if (event == EarlyCommitRecognizer::kConfirmed) {
+    Log(kLogConfirmed, command, current_time);
+  } else if (event == EarlyCommitRecognizer::kRetracted) {
+    Log(kLogRetracted, command, current_time);
   }
 }
@@ -18,6 +18,7 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_COMMAND_RESPONDER_H_
 #define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_COMMAND_RESPONDER_H_
 
+#include "early_commit.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 
@@ -29,4 +30,17 @@ void RespondToCommand(tflite::ErrorReporter* error_reporter,
                       int32_t current_time, const char* found_command,
                       uint8_t score, bool is_new_command);
 
+// Called when the keywords of a command sequence (see g_command_sequences in
+// config.h) were heard, from the first to the last of them.
+void RespondToCommandSequence(tflite::ErrorReporter* error_reporter,
+                              const char* sequence, int32_t start_time,
+                              int32_t end_time);
+
+// Called with the events of the early-commit path (see g_early_commit_enabled
+// in config.h). A committed command has already been heard, a retracted one
+// turned out to be wrong.
+void RespondToEarlyCommit(tflite::ErrorReporter* error_reporter,
+                          int32_t current_time, const char* command,
+                          uint8_t score, EarlyCommitRecognizer::Event event);
+
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_COMMAND_RESPONDER_H_
@@ -0,0 +1,105 @@
+#include "command_sequence.h"
+
+#include <string.h>
+
+namespace {
+// Index of a keyword label, or -1 for silence, unknown and other labels
+int KeywordIndex(const char* label, bool compare_text) {
+	for (int i = kUnknownIndex + 1; i < kCategoryCount; i++) {
+		if ((label == kCategoryLabels[i]) || (compare_text && (strcmp(label, kCategoryLabels[i]) == 0))) {
+			return i;
+		}
+	}
+	return -1;
+}
+}  // namespace
+
+CommandSequenceRecognizer::CommandSequenceRecognizer()
+    : state_count_(1), state_(kStartState), first_word_time_(0), last_word_time_(0) {
+	for (int state = 0; state < kMaxStates; state++) {
+		for (int i = 0; i < kCategoryCount; i++) {
+			next_state_[state][i] = kNoState;
+			max_gap_ms_[state][i] = 0;
+		}
+		sequence_name_[state] = nullptr;
+		has_next_[state] = false;
+	}
+}
+
+bool CommandSequenceRecognizer::AddSequence(const char* name, const char* const* words, const int32_t* max_gap_ms) {
+	int word_count = 0;
+	int categories[kMaxWords];
+	int new_state_count = 0;
+	int state = kStartState;
+	for (; (word_count < kMaxWords) && (words[word_count] != nullptr); word_count++) {
+		categories[word_count] = KeywordIndex(words[word_count], true);
+		if (categories[word_count] < 0) {
+			return false;
+		}
+		// Words past the existing states each need a new state
+		if (state != kNoState) {
+			state = next_state_[state][categories[word_count]];
+		}
+		if (state == kNoState) {
+			new_state_count++;
+		}
+	}
+	if ((word_count == 0) || (state_count_ + new_state_count > kMaxStates) ||
+	    ((state != kNoState) && (sequence_name_[state] != nullptr))) {
+		return false;
+	}
+
+	state = kStartState;
+	for (int word = 0; word < word_count; word++) {
+		const int category = categories[word];
+		if (next_state_[state][category] == kNoState) {
+			next_state_[state][category] = static_cast<int8_t>(state_count_++);
+			has_next_[state] = true;
+		}
+		// Transitions shared with other sequences allow the longest of their gaps
+		if ((word > 0) && (max_gap_ms[word - 1] > max_gap_ms_[state][category])) {
+			max_gap_ms_[state][category] = max_gap_ms[word - 1];
+		}
+		state = next_state_[state][category];
+	}
+	sequence_name_[state] = name;
+	return true;
+}
+
+bool CommandSequenceRecognizer::Process(int32_t current_time, const char* found_command, bool is_new_command,
+                                        const char** name, int32_t* start_time, int32_t* end_time) {
+	if (!is_new_command) {
+		return false;
+	}
+	const int category = KeywordIndex(found_command, false);
+	if (category < 0) {
+		return false;
+	}
+
+	// Continue the current sequence, or start a new one with this word
+	int next_state = kNoState;
+	if ((state_ != kStartState) && (current_time - last_word_time_ <= max_gap_ms_[state_][category])) {
+		next_state = next_state_[state_][category];
+	}
+	if (next_state == kNoState) {
+		next_state = next_state_[kStartState][category];
+		first_word_time_ = current_time;
+	}
+	if (next_state == kNoState) {
+		state_ = kStartState;
+		return false;
+	}
+	state_ = next_state;
+	last_word_time_ = current_time;
+	if (sequence_name_[state_] == nullptr) {
+		return false;
+	}
+
+	*name = sequence_name_[state_];
+	*start_time = first_word_time_;
+	*end_time = current_time;
+	if (!has_next_[state_]) {
+		state_ = kStartState;
+	}
+	return true;
+}
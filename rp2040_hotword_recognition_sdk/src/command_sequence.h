@@ -0,0 +1,53 @@
+#ifndef COMMAND_SEQUENCE_H_
+#define COMMAND_SEQUENCE_H_
+
+#include <stdint.h>
+
+#include "micro_features/micro_model_settings.h"
+
+// Recognizes sequences of keywords, like "stop" followed by "go", in the
+// detections of RecognizeCommands. The sequences are compiled into a state
+// machine when they are added: a table with the next state per state and
+// keyword, and the maximum time allowed since the previous keyword for every
+// transition. Processing a detection is a single table lookup, whatever the
+// number of sequences. Sequences with a common beginning share its states.
+class CommandSequenceRecognizer {
+ public:
+	// Limits of the compiled table
+	static constexpr int kMaxWords = 4;
+	static constexpr int kMaxStates = 16;
+
+	CommandSequenceRecognizer();
+
+	// Adds the sequence of up to kMaxWords keyword labels, ending at the first
+	// nullptr. max_gap_ms[i] is the maximum time between the detections of word
+	// i and word i + 1. Returns false if a word is not a keyword of the model,
+	// the sequence was added before or the table is full.
+	bool AddSequence(const char* name, const char* const* words, const int32_t* max_gap_ms);
+
+	// Takes the result of RecognizeCommands at current_time. Returns true when a
+	// detection completes a sequence, with its name and the detection times of
+	// its first and last word.
+	bool Process(int32_t current_time, const char* found_command, bool is_new_command, const char** name,
+	             int32_t* start_time, int32_t* end_time);
+
+ private:
+	static constexpr int8_t kNoState = -1;
+	static constexpr int8_t kStartState = 0;
+
+	// Next state by state and category, or kNoState
+	int8_t next_state_[kMaxStates][kCategoryCount];
+	// Maximum time since the previous word of each transition
+	int32_t max_gap_ms_[kMaxStates][kCategoryCount];
+	// Sequence completed by reaching a state, or nullptr
+	const char* sequence_name_[kMaxStates];
+	// Whether longer sequences continue from a state
+	bool has_next_[kMaxStates];
+	int state_count_;
+
+	int state_;
+	int32_t first_word_time_;
+	int32_t last_word_time_;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef COMPILED_MODEL_H_
+#define COMPILED_MODEL_H_
+
+#include <stdint.h>
+
+// Inference function generated from the model at build time by
+// host/model_compiler (COMPILED_MODEL in CMakeLists.txt). The operators are
+// called one after the other with their shapes, quantization parameters and
+// weights compiled in, without interpreter, tensor arena or flatbuffer.
+
+// Quantization of the input features
+extern const float g_compiled_model_input_scale;
+extern const int32_t g_compiled_model_input_zero_point;
+// Input features and output scores in bytes
+extern const int g_compiled_model_input_size;
+extern const int g_compiled_model_output_size;
+// Static buffers for the intermediate tensors and the kernel scratch data
+extern const int g_compiled_model_buffer_size;
+
+// Runs the model on the int8 input features and writes the int8 scores, returns
+// false if a kernel failed
+bool CompiledModelInvoke(const int8_t* input, int8_t* output);
+
+#endif
@@ -31,4 +31,208 @@ const int32_t g_rec_minimum_count = 3;                 // default: 3
 // further recognitions for a set time after one has been triggered, which can
 // help reduce spurious recognitions.
 
+// Voice activity gate parameters
+const bool g_vad_enabled = true;                 // default: true
+const uint16_t g_vad_channel_threshold = 300;    // default: 300
+const int32_t g_vad_min_active_channels = 4;     // default: 4
+const int32_t g_vad_report_interval_ms = 10000;  // default: 10000
+
+// The voice activity gate skips model inference while the spectrogram window
+// holds no speech-like slices and feeds "silence" results to the recognizer
+// instead. A slice counts as speech-like if at least the minimum number of
+// frontend channels exceed the channel threshold (noise reduced log energy in
+// the 0 to 670 range of the frontend output). The inference duty cycle is
+// printed every report interval; set the interval to 0 to disable the report.
+
+// Frontend state store parameters
+const bool g_frontend_state_store_enabled = true;           // default: true
+const uint32_t g_frontend_state_sector_count = 2;           // default: 2
+const int32_t g_frontend_state_min_uptime_ms = 30000;       // default: 30000
+const int32_t g_frontend_state_store_interval_ms = 300000;  // default: 300000
+
+// The converged noise estimates of the feature frontend are stored in the last
+// sectors of the flash and restored at boot, so the recognition works right
+// away instead of after several seconds of noise estimate convergence.
+// Snapshots are taken during silence, the first once the minimum uptime has
+// passed, the next ones at most once per store interval. Each 4 KB sector holds
+// 16 snapshots and is erased once per wrap-around of the sector ring, so more
+// sectors spread the wear further; the link fails if the firmware image reaches
+// the sectors. Capture is paused while a sector is erased.
+
+// Feature provider catch-up parameters
+enum FeatureCatchUpPolicy { kCatchUpAll, kCatchUpBounded, kCatchUpNewest };
+const FeatureCatchUpPolicy g_feature_catch_up_policy = kCatchUpNewest;  // default: kCatchUpAll
+const int32_t g_feature_max_slices_per_call = 4;                       // default: 49
+const int32_t g_feature_report_interval_ms = 10000;                    // default: 10000
+
+// When the main loop stalls, for example on a blocking printf, several feature
+// slices become due at once. kCatchUpAll computes all of them (up to the 49
+// slices of the window) in the next call, which causes a latency spike that can
+// delay the following call as well. kCatchUpBounded computes at most the
+// maximum number of oldest missing slices per call and catches up on the rest
+// in later calls, so the window lags behind until the backlog is cleared.
+// kCatchUpNewest computes the newest slices and fills the skipped older ones
+// with silence. The capture ring of the audio provider holds the audio of the
+// slices a call may compute (kAudioCaptureRingBlockCount in
+// src/audio_provider.h): about 1 s of audio, 32 KB, with kCatchUpAll and
+// kCatchUpBounded, and 1.6 KB plus 640 bytes per slice with kCatchUpNewest.
+// Dropped and late slices and a histogram of the feature generation time per
+// loop are printed every report interval; set the interval to 0 to disable the
+// report.
+
+// Profiler parameters
+const int32_t g_profiler_report_interval_ms = 1000;  // default: 1000
+
+// With MICRO_PROFILER set to 2 in CMakeLists.txt, a binary frame with minimum,
+// mean, maximum and 99th percentile ticks per operator over the latest 128
+// invocations is sent every report interval.
+
+// Dual-core pipeline parameters
+const int32_t g_pipeline_report_interval_ms = 10000;  // default: 10000
+
+// With DUAL_CORE_PIPELINE set to 1 in CMakeLists.txt, core 1 captures audio and
+// generates the feature slices, which it passes through a lock-free queue to
+// core 0 running the model and the recognizer. The share of time each core was
+// busy, the maximum queue fill level, the slices lost in the full queue or
+// dropped and delayed by the catch-up policy, and the longest time and histogram
+// of the feature task on core 1 are printed every report interval; set the
+// interval to 0 to disable the report.
+
+// Two-stage cascade parameters
+const uint8_t g_cascade_gate_threshold = 128;        // default: 128
+const int32_t g_cascade_hold_ms = 500;               // default: 500
+const int32_t g_cascade_report_interval_ms = 10000;  // default: 10000
+
+// With CASCADE_GATE set to 1 in CMakeLists.txt, the 2 word model runs on every
+// spectrogram window as speech gate, and the recognition model only while the
+// speech score of the gate (255 minus its silence score) reaches the threshold
+// and for the hold time after, which lets a word pass through the whole window.
+// Lower thresholds miss fewer words but run the recognition model more often.
+// The share of windows running the recognition model, the mean invoke time of
+// both models and the CPU load of the inference, compared with running the
+// recognition model on every window, are printed every report interval; set the
+// interval to 0 to disable the report. With the current models the cascade is a
+// net CPU loss: the gate model takes almost as long as the recognition model,
+// which still runs on most windows of speech (see README.md).
+
+// Early-commit parameters
+struct EarlyCommitThreshold {
+	const char* label;
+	uint8_t threshold;
+};
+const bool g_early_commit_enabled = false;      // default: false
+const int32_t g_early_commit_window_ms = 100;   // default: 100
+const uint8_t g_early_commit_threshold = 230;   // default: 230
+const int32_t g_early_commit_confirm_ms = 750;  // default: 750
+const EarlyCommitThreshold g_early_commit_thresholds[] = {{"yes", 230}, {"no", 230}};
+
+// The recognizer averages the scores over the window duration of the recognizer
+// parameters before it detects a keyword, which delays the detection by several
+// hundred milliseconds after the end of the word. With early commit enabled a
+// keyword is reported as soon as its average score over the early commit window
+// reaches its threshold (0 ms uses the score of the latest inference alone). The
+// thresholds list overrides the default threshold per keyword; keywords that
+// are confused easily need higher thresholds. The averaging window of the
+// recognizer then confirms the keyword if it detects it within the confirmation
+// time, or retracts it if it detects another keyword or none. The host tool
+// latency_replay measures the latency of both paths on recorded audio.
+
+// Posterior trace parameters
+const bool g_trace_output_enabled = false;  // default: false
+
+// With trace output enabled, the scores fed to the recognizer are sent after
+// every inference as binary frame with the time of the spectrogram window
+// (src/posterior_trace.h), between the text output. The frames are stored as
+// posterior trace by scripts/record_posterior_trace.py, which passes the text
+// through, and replayed with different recognizer parameters by the host tool
+// recognizer_tuning, so the parameters can be tuned without reflashing.
+
+// Command sequence parameters
+struct CommandSequence {
+	const char* name;
+	const char* words[4];
+	int32_t max_gap_ms[3];
+};
+const bool g_command_sequences_enabled = false;  // default: false
+const CommandSequence g_command_sequences[] = {
+    {"on left", {"on", "left"}, {1500}},
+    {"on right", {"on", "right"}, {1500}},
+    {"stop go", {"stop", "go"}, {1500}},
+};
+
+// Command sequences are phrases of up to 4 keywords, each detected within the
+// maximum gap after the previous one. They are matched on the detections of the
+// recognizer and reported with the times of their first and last word, in
+// addition to the single keywords. Sequences using keywords the model does not
+// recognize are skipped with a message at boot.
+
+// Log ring parameters
+const bool g_binary_log_enabled = false;  // default: false
+
+// All log output, the detections, the audio timings and the output of
+// TF_LITE_REPORT_ERROR, passes a per-core ring that the main loop sends while
+// the USB serial port has room (src/log_ring.h), so logging never stalls
+// capture or inference, and output logged before a host connects waits in the
+// ring. The detections and the periodic reports are stored as records of
+// message ID and raw arguments, and formatted into text by the log task. With
+// binary logging enabled they are sent as binary records instead and are not
+// formatted on the device at all; the output has to be read with
+// scripts/decode_log.py then. Only the one-off boot and error messages of
+// TF_LITE_REPORT_ERROR are still formatted by their caller. When the ring is
+// full, new records are dropped and the number of drops is logged.
+
+// Task scheduler parameters
+const bool g_idle_sleep_enabled = true;           // default: true
+const bool g_idle_clock_gating_enabled = false;   // default: false
+const int32_t g_log_task_period_ms = 10;          // default: 10
+const int32_t g_task_report_interval_ms = 10000;  // default: 10000
+
+// Each core runs its work as tasks of a cooperative scheduler
+// (src/task_scheduler.h): feature generation, released by the capture interrupt
+// at every slice stride, inference, released by new slices, and the log ring
+// drain, released every log task period. With idle sleep enabled a core without
+// a released task sleeps in WFE until the next interrupt or release instead of
+// polling, otherwise it polls as before. Idle clock gating additionally stops
+// the clocks of the unused peripherals while both cores sleep. Every report
+// interval, runs, deadline misses and longest response time of each task, and
+// the share of time each core slept, are logged; 0 disables the report.
+
+// Clock scaling parameters
+const bool g_clock_scaling_enabled = false;        // default: false
+const uint32_t g_boost_clock_khz = 200000;         // default: 200000
+const int32_t g_boost_voltage_mv = 1150;           // default: 1150
+const uint32_t g_idle_clock_divider = 3;           // default: 3
+const int32_t g_idle_voltage_mv = 1000;            // default: 1000
+const uint32_t g_voltage_settle_us = 1000;         // default: 1000
+const int32_t g_clock_core_ua_per_mhz = 150;       // default: 150
+const int32_t g_clock_report_interval_ms = 10000;  // default: 10000
+
+// With clock scaling enabled the model, and the gate model of the cascade, runs
+// at the boost clock and voltage, and everything else at the idle point, the
+// boost clock divided by the idle clock divider (src/clock_scaling.h). The PDM
+// clock divider of the microphone is retuned together with every switch, so
+// capture continues at its sample rate. Raising the voltage waits for the
+// regulator to settle, as the pico-sdk does after a voltage change, before
+// every window with speech; a too low idle clock shows as deadline misses in
+// the task report. Every report interval the invoke time and the energy per
+// inference of each operating point, the settle time included, are logged,
+// estimated with the core current per MHz at 1.10 V, which should be calibrated
+// with a current measurement. Overclocking and undervolting depend on the
+// individual chip and the flash, which runs at half of clk_sys, so scaling is
+// disabled by default.
+
+// USB microphone parameters
+const int32_t g_usb_stream_lag_ms = 2;           // default: 2
+const int32_t g_usb_report_interval_ms = 10000;  // default: 10000
+
+// With the USB_MICROPHONE build option the board is also a USB microphone
+// (src/usb/usb_composite.h). The stream stays the lag behind the latest
+// captured block, as margin for the jitter between capture interrupt and USB
+// frames, which moves the lag by one block either way; the lag must be from
+// 2 ms to 2 ms less than the capture ring holds (kAudioCaptureRingBlockCount
+// in src/audio_provider.h, 130 ms with the catch-up parameters above), and the
+// audio reaches the host one lag later than the recognition. Every report
+// interval the streamed, duplicated and skipped blocks and the resyncs are
+// logged; 0 disables the report.
+
 #endif
\ No newline at end of file
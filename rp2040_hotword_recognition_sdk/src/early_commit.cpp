@@ -0,0 +1,97 @@
+#include "early_commit.h"
+
+#include <string.h>
+
+namespace {
+// Threshold no average score reaches
+constexpr int16_t kNeverCommit = 256;
+
+// Index of a label returned by RecognizeCommands, which points into kCategoryLabels
+int CategoryIndex(const char* label) {
+	for (int i = 0; i < kCategoryCount; i++) {
+		if (label == kCategoryLabels[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+}  // namespace
+
+EarlyCommitRecognizer::EarlyCommitRecognizer(tflite::ErrorReporter* error_reporter, int32_t window_duration_ms,
+                                             uint8_t threshold, int32_t confirm_ms, int32_t suppression_ms)
+    : window_duration_ms_(window_duration_ms),
+      confirm_ms_(confirm_ms),
+      suppression_ms_(suppression_ms),
+      previous_results_(error_reporter),
+      pending_index_(-1),
+      pending_time_(0),
+      pending_score_(0),
+      last_index_(-1),
+      last_time_(0) {
+	for (int i = 0; i < kCategoryCount; i++) {
+		thresholds_[i] = ((i == kSilenceIndex) || (i == kUnknownIndex)) ? kNeverCommit : threshold;
+	}
+}
+
+void EarlyCommitRecognizer::SetThreshold(const char* label, uint8_t threshold) {
+	for (int i = 0; i < kCategoryCount; i++) {
+		if ((i != kSilenceIndex) && (i != kUnknownIndex) && (strcmp(label, kCategoryLabels[i]) == 0)) {
+			thresholds_[i] = threshold;
+		}
+	}
+}
+
+EarlyCommitRecognizer::Event EarlyCommitRecognizer::Process(const int8_t* latest_scores, int32_t current_time,
+                                                            const char* found_command, bool is_new_command,
+                                                            const char** command, uint8_t* score) {
+	previous_results_.push_back({current_time, latest_scores});
+	while (previous_results_.front().time_ < current_time - window_duration_ms_) {
+		previous_results_.pop_front();
+	}
+
+	// The long window confirms or retracts the pending commit
+	const int found_index = is_new_command ? CategoryIndex(found_command) : -1;
+	Event event = kNoEvent;
+	if (pending_index_ >= 0) {
+		if (found_index == pending_index_) {
+			event = kConfirmed;
+		} else if ((found_index > kUnknownIndex) || (current_time - pending_time_ > confirm_ms_)) {
+			event = kRetracted;
+		}
+	}
+	if (found_index >= 0) {
+		last_index_ = found_index;
+		last_time_ = current_time;
+	}
+	if (event != kNoEvent) {
+		*command = kCategoryLabels[pending_index_];
+		*score = pending_score_;
+		pending_index_ = -1;
+		return event;
+	}
+	if (pending_index_ >= 0) {
+		return kNoEvent;
+	}
+
+	// Commit the top keyword of the short window if it reaches its threshold
+	const int32_t* sums = previous_results_.sums();
+	int top_index = 0;
+	for (int i = 1; i < kCategoryCount; i++) {
+		if (sums[i] > sums[top_index]) {
+			top_index = i;
+		}
+	}
+	const int32_t average = sums[top_index] / previous_results_.size();
+	if ((average < thresholds_[top_index]) ||
+	    ((top_index == last_index_) && (current_time - last_time_ <= suppression_ms_))) {
+		return kNoEvent;
+	}
+	pending_index_ = top_index;
+	pending_time_ = current_time;
+	pending_score_ = static_cast<uint8_t>(average);
+	last_index_ = top_index;
+	last_time_ = current_time;
+	*command = kCategoryLabels[top_index];
+	*score = pending_score_;
+	return kCommitted;
+}
@@ -0,0 +1,54 @@
+#ifndef EARLY_COMMIT_H_
+#define EARLY_COMMIT_H_
+
+#include <stdint.h>
+
+#include "micro_features/micro_model_settings.h"
+#include "recognize_commands.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+// Early-commit path next to RecognizeCommands: a keyword is committed as soon as
+// its average score over a short window reaches the threshold of the keyword,
+// instead of after the long averaging window of RecognizeCommands. The long
+// window then confirms the commit by detecting the same keyword within the
+// confirmation time, or retracts it when it detects another keyword or the
+// confirmation time passes.
+class EarlyCommitRecognizer {
+ public:
+	enum Event { kNoEvent, kCommitted, kConfirmed, kRetracted };
+
+	// A window duration of 0 commits on the instantaneous scores. Commits of a
+	// keyword are suppressed for suppression_ms after it was committed or
+	// detected by the long window.
+	EarlyCommitRecognizer(tflite::ErrorReporter* error_reporter, int32_t window_duration_ms, uint8_t threshold,
+	                      int32_t confirm_ms, int32_t suppression_ms);
+
+	// Sets the threshold of the keyword with the given label, unknown labels are
+	// ignored. Silence and unknown are never committed.
+	void SetThreshold(const char* label, uint8_t threshold);
+
+	// Takes the scores of the window at current_time and the result of the long
+	// window recognizer for them. Returns the event of this window with the label
+	// of its keyword in command and the short window average at the commit in
+	// score.
+	Event Process(const int8_t* latest_scores, int32_t current_time, const char* found_command, bool is_new_command,
+	              const char** command, uint8_t* score);
+
+ private:
+	int32_t window_duration_ms_;
+	int32_t confirm_ms_;
+	int32_t suppression_ms_;
+	// Threshold per category, above 255 for categories never committed
+	int16_t thresholds_[kCategoryCount];
+	PreviousResultsQueue previous_results_;
+
+	// Committed keyword waiting for the long window, or -1
+	int pending_index_;
+	int32_t pending_time_;
+	uint8_t pending_score_;
+	// Latest keyword committed or detected by the long window, or -1
+	int last_index_;
+	int32_t last_time_;
+};
+
+#endif
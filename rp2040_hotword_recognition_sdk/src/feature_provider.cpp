@@ -15,17 +15,25 @@ limitations under the License.
 
 #include "feature_provider.h"
 #include "audio_provider.h"
+#include "config.h"
 #include "micro_features/micro_features_generator.h"
 #include "micro_features/micro_model_settings.h"
 
 FeatureProvider::FeatureProvider(int feature_size, int8_t* feature_data)
     : feature_size_(feature_size),
       feature_data_(feature_data),
+      speech_slice_count_(0),
+      backlog_slice_count_(0),
+      dropped_slice_count_(0),
+      late_slice_count_(0),
       is_first_run_(true) {
   // Initialize the feature data to default values.
   for (int n = 0; n < feature_size_; ++n) {
     feature_data_[n] = 0;
   }
+  for (int n = 0; n < kFeatureSliceCount; ++n) {
+    slice_is_speech_[n] = false;
+  }
 }
 
 FeatureProvider::~FeatureProvider() {}
@@ -45,23 +53,53 @@ TfLiteStatus FeatureProvider::PopulateFeatureData(
   const int last_step = (last_time_in_ms / kFeatureSliceStrideMs);
   const int current_step = (time_in_ms / kFeatureSliceStrideMs);
 
-  int slices_needed = current_step - last_step;
+  int slices_due = current_step - last_step;
   // If this is the first call, make sure we don't use any cached information.
+  const bool is_first_run = is_first_run_;
   if (is_first_run_) {
     TfLiteStatus init_status = InitializeMicroFeatures(error_reporter);
     if (init_status != kTfLiteOk) {
       return init_status;
     }
     is_first_run_ = false;
-    slices_needed = kFeatureSliceCount;
+    slices_due = kFeatureSliceCount;
+    backlog_slice_count_ = 0;
   }
-  if (slices_needed > kFeatureSliceCount) {
-    slices_needed = kFeatureSliceCount;
+  // Slices deferred by earlier calls are due as well. Slices older than the
+  // window are not needed anymore, starting with the deferred ones.
+  slices_due += backlog_slice_count_;
+  int late_slices = backlog_slice_count_;
+  if (slices_due > kFeatureSliceCount) {
+    const int overflow = slices_due - kFeatureSliceCount;
+    dropped_slice_count_ += overflow;
+    late_slices = (late_slices > overflow) ? (late_slices - overflow) : 0;
+    slices_due = kFeatureSliceCount;
   }
+
+  // How far the window moves, and how many of the new slices at its end are
+  // computed. The remaining new slices are filled with silence. The whole
+  // window is computed on the first run, that is no stall to recover from.
+  int slices_needed = slices_due;
+  int slices_to_compute = slices_due;
+  if (!is_first_run && (slices_due > g_feature_max_slices_per_call)) {
+    if (g_feature_catch_up_policy == kCatchUpBounded) {
+      slices_needed = g_feature_max_slices_per_call;
+      slices_to_compute = g_feature_max_slices_per_call;
+    } else if (g_feature_catch_up_policy == kCatchUpNewest) {
+      slices_to_compute = g_feature_max_slices_per_call;
+      dropped_slice_count_ += slices_due - slices_to_compute;
+    }
+  }
+  late_slice_count_ +=
+      (late_slices < slices_to_compute) ? late_slices : slices_to_compute;
+  backlog_slice_count_ = slices_due - slices_needed;
+  // The window ends before the deferred slices
+  const int window_end_step = current_step - backlog_slice_count_;
   *how_many_new_slices = slices_needed;
 
   const int slices_to_keep = kFeatureSliceCount - slices_needed;
   const int slices_to_drop = kFeatureSliceCount - slices_to_keep;
+  const int first_computed_slice = kFeatureSliceCount - slices_to_compute;
   // If we can avoid recalculating some slices, just move the existing data
   // up in the spectrogram, to perform something like this:
   // last time = 80ms          current time = 120ms
@@ -85,6 +123,7 @@ TfLiteStatus FeatureProvider::PopulateFeatureData(
       for (int i = 0; i < kFeatureSliceSize; ++i) {
         dest_slice_data[i] = src_slice_data[i];
       }
+      slice_is_speech_[dest_slice] = slice_is_speech_[src_slice];
     }
   }
   // Any slices that need to be filled in with feature data have their
@@ -92,7 +131,18 @@ TfLiteStatus FeatureProvider::PopulateFeatureData(
   if (slices_needed > 0) {
     for (int new_slice = slices_to_keep; new_slice < kFeatureSliceCount;
          ++new_slice) {
-      const int new_step = (current_step - kFeatureSliceCount + 1) + new_slice;
+      if (new_slice < first_computed_slice) {
+        int8_t* new_slice_data =
+            feature_data_ + (new_slice * kFeatureSliceSize);
+        const int8_t silence_value = GetMicroFeaturesSilenceValue();
+        for (int i = 0; i < kFeatureSliceSize; ++i) {
+          new_slice_data[i] = silence_value;
+        }
+        slice_is_speech_[new_slice] = false;
+        continue;
+      }
+      const int new_step =
+          (window_end_step - kFeatureSliceCount + 1) + new_slice;
       const int32_t slice_start_ms = (new_step * kFeatureSliceStrideMs);
       int16_t* audio_samples = nullptr;
       int audio_samples_size = 0;
@@ -114,7 +164,26 @@ TfLiteStatus FeatureProvider::PopulateFeatureData(
       if (generate_status != kTfLiteOk) {
         return generate_status;
       }
+      slice_is_speech_[new_slice] =
+          GetMicroFeaturesActiveChannels() >= g_vad_min_active_channels;
+    }
+  }
+  speech_slice_count_ = 0;
+  for (int n = 0; n < kFeatureSliceCount; ++n) {
+    if (slice_is_speech_[n]) {
+      ++speech_slice_count_;
     }
   }
   return kTfLiteOk;
 }
+
+int FeatureLatencyBucket(uint32_t latency_us) {
+  static const uint32_t kBucketLimitsUs[kFeatureLatencyBucketCount - 1] = {
+      1000, 2000, 5000, 10000, 20000, 50000, 100000};
+  int bucket = 0;
+  while ((bucket < kFeatureLatencyBucketCount - 1) &&
+         (latency_us >= kBucketLimitsUs[bucket])) {
+    bucket++;
+  }
+  return bucket;
+}
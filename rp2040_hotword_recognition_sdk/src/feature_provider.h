@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_PROVIDER_H_
 
 #include "tensorflow/lite/c/common.h"
+#include "micro_features/micro_model_settings.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 
 // Binds itself to an area of memory intended to hold the input features for an
@@ -36,17 +37,51 @@ class FeatureProvider {
   ~FeatureProvider();
 
   // Fills the feature data with information from audio inputs, and returns how
-  // many feature slices were updated.
+  // many feature slices were updated. If several slices became due since the
+  // last call, g_feature_catch_up_policy decides how many of them are computed
+  // in this call.
   TfLiteStatus PopulateFeatureData(tflite::ErrorReporter* error_reporter,
                                    int32_t last_time_in_ms, int32_t time_in_ms,
                                    int* how_many_new_slices);
 
+  // Returns how many slices in the current spectrogram window were classified
+  // as speech-like by the frontend voice activity measure.
+  int speech_slice_count() const { return speech_slice_count_; }
+
+  // Returns whether the given slice of the current window was classified as
+  // speech-like.
+  bool slice_is_speech(int slice) const { return slice_is_speech_[slice]; }
+
+  // Returns how many due slices were never computed, because they were skipped
+  // by the catch-up policy or fell out of the window before being computed.
+  int32_t dropped_slice_count() const { return dropped_slice_count_; }
+
+  // Returns how many slices were computed in a later call than the one in which
+  // they became due.
+  int32_t late_slice_count() const { return late_slice_count_; }
+
  private:
   int feature_size_;
   int8_t* feature_data_;
+  // Voice activity flag of every slice, kept in the same order as the slices
+  // in feature_data_.
+  bool slice_is_speech_[kFeatureSliceCount];
+  int speech_slice_count_;
+  // Slices that are due but deferred to later calls by kCatchUpBounded.
+  int backlog_slice_count_;
+  int32_t dropped_slice_count_;
+  int32_t late_slice_count_;
   // Make sure we don't try to use cached information if this is the first call
   // into the provider.
   bool is_first_run_;
 };
 
+// The durations of PopulateFeatureData() calls are reported as histogram with
+// buckets up to 1, 2, 5, 10, 20, 50 and 100 ms and one above, as in the formats
+// of kLogFeatureTimes and kLogFeatureTimesLong.
+constexpr int kFeatureLatencyBucketCount = 8;
+
+// Returns the histogram bucket of a call that took latency_us.
+int FeatureLatencyBucket(uint32_t latency_us);
+
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_PROVIDER_H_
@@ -0,0 +1,110 @@
+#include "fork_join.h"
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "hardware/irq.h"
+#include "hardware/structs/sio.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+
+namespace {
+// Value pushed into the FIFO of core 1 to wake it up, the job is in the globals
+constexpr uint32_t kDoorbell = 0x4a4f4221;
+// Time after which core 0 rings again if core 1 did not start the job
+constexpr uint32_t kDoorbellRetryUs = 50;
+
+bool fork_join_enabled = true;
+std::atomic<bool> worker_ready(false);
+
+// Posted by core 0 before it increments posted_sequence
+ForkJoinFunction job_function = nullptr;
+void* job_arg = nullptr;
+// Job counters, each written by one core only, as the Cortex-M0+ has no atomic
+// read-modify-write
+std::atomic<uint32_t> posted_sequence(0);
+std::atomic<uint32_t> started_sequence(0);
+std::atomic<uint32_t> finished_sequence(0);
+
+// Runs the second part of the posted job on core 1, ignoring repeated doorbells
+void RunPostedJob() {
+	const uint32_t sequence = posted_sequence.load(std::memory_order_acquire);
+	if (sequence == started_sequence.load(std::memory_order_relaxed)) {
+		return;
+	}
+	started_sequence.store(sequence, std::memory_order_relaxed);
+	job_function(job_arg, 1);
+	finished_sequence.store(sequence, std::memory_order_release);
+}
+
+// Waits in RAM so core 0 can write flash without locking this core out
+void __not_in_flash_func(ForkJoinWorkerMain)() {
+	worker_ready.store(true, std::memory_order_release);
+	while (true) {
+		while (!(sio_hw->fifo_st & SIO_FIFO_ST_VLD_BITS)) {
+			__wfe();
+		}
+		while (sio_hw->fifo_st & SIO_FIFO_ST_VLD_BITS) {
+			(void)sio_hw->fifo_rd;
+		}
+		RunPostedJob();
+	}
+}
+
+void ForkJoinFifoIrqHandler() {
+	multicore_fifo_drain();
+	multicore_fifo_clear_irq();
+	RunPostedJob();
+}
+
+void RingDoorbell() {
+	// A full FIFO already holds a doorbell
+	multicore_fifo_push_timeout_us(kDoorbell, 0);
+}
+
+}  // namespace
+
+void LaunchForkJoinWorker() { multicore_launch_core1(ForkJoinWorkerMain); }
+
+void InitForkJoinWorkerInterrupt() {
+	multicore_fifo_drain();
+	multicore_fifo_clear_irq();
+	irq_set_exclusive_handler(SIO_IRQ_PROC1, ForkJoinFifoIrqHandler);
+	irq_set_priority(SIO_IRQ_PROC1, PICO_LOWEST_IRQ_PRIORITY);
+	irq_set_enabled(SIO_IRQ_PROC1, true);
+	worker_ready.store(true, std::memory_order_release);
+}
+
+bool IsForkJoinWorkerReady() { return worker_ready.load(std::memory_order_acquire); }
+
+void ForkJoin(ForkJoinFunction function, void* arg) {
+	if (!fork_join_enabled || !worker_ready.load(std::memory_order_acquire)) {
+		for (int part = 0; part < kForkJoinPartCount; part++) {
+			function(arg, part);
+		}
+		return;
+	}
+
+	job_function = function;
+	job_arg = arg;
+	const uint32_t sequence = posted_sequence.load(std::memory_order_relaxed) + 1;
+	posted_sequence.store(sequence, std::memory_order_release);
+	RingDoorbell();
+	uint32_t rung_us = time_us_32();
+
+	function(arg, 0);
+
+	while (finished_sequence.load(std::memory_order_acquire) != sequence) {
+		// The flash lockout handshake on core 1 discards FIFO words other than its own
+		if ((started_sequence.load(std::memory_order_relaxed) != sequence) &&
+		    (time_us_32() - rung_us > kDoorbellRetryUs)) {
+			RingDoorbell();
+			rung_us = time_us_32();
+		}
+		tight_loop_contents();
+	}
+}
+
+void SetForkJoinEnabled(bool enabled) { fork_join_enabled = enabled; }
@@ -0,0 +1,35 @@
+#ifndef FORK_JOIN_H_
+#define FORK_JOIN_H_
+
+// Fork/join of kernel work across both cores (PARALLEL_KERNELS in
+// CMakeLists.txt). Core 0 posts a job to core 1 and rings it through the SIO
+// FIFO, runs its own part and then waits for core 1 to finish the other part.
+// The job itself is passed through shared memory, so a doorbell swallowed by
+// the flash lockout handshake of the frontend state store is simply rung again.
+
+// Function computing one part of a job, part is 0 on core 0 and 1 on core 1
+typedef void (*ForkJoinFunction)(void* arg, int part);
+
+constexpr int kForkJoinPartCount = 2;
+
+// Runs core 1 as dedicated worker, used when core 1 has nothing else to do
+// (single-core pipeline). The worker waits in RAM, so core 0 may write flash.
+void LaunchForkJoinWorker();
+
+// Serves jobs from the SIO FIFO interrupt of core 1 at the lowest priority,
+// preempting the loop of core 1 but not its audio interrupts (dual-core
+// pipeline). Call on core 1.
+void InitForkJoinWorkerInterrupt();
+
+// True once core 1 serves jobs
+bool IsForkJoinWorkerReady();
+
+// Runs function(arg, 0) on core 0 and function(arg, 1) on core 1 and returns
+// when both finished. Without worker, or while disabled, both parts run on the
+// calling core one after the other.
+void ForkJoin(ForkJoinFunction function, void* arg);
+
+// Enables splitting jobs across the cores (default)
+void SetForkJoinEnabled(bool enabled);
+
+#endif
@@ -0,0 +1,135 @@
+#include "frontend_core.h"
+
+#include <atomic>
+
+#include "audio_provider.h"
+#include "config.h"
+#include "feature_provider.h"
+#include "fork_join.h"
+#include "frontend_state_store.h"
+#include "micro_features/micro_model_settings.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "task_scheduler.h"
+
+namespace {
+tflite::ErrorReporter* frontend_error_reporter = nullptr;
+SliceQueue* frontend_slice_queue = nullptr;
+void (*frontend_slices_ready)() = nullptr;
+// Spectrogram window of the FeatureProvider on core 1, its new slices are
+// copied into the queue
+int8_t frontend_feature_buffer[kFeatureElementCount];
+FeatureProvider* frontend_feature_provider = nullptr;
+int32_t frontend_previous_time = 0;
+
+// Scheduler of core 1, the feature task is released by the capture interrupt
+TaskScheduler frontend_scheduler;
+int feature_task = -1;
+
+// Written by core 1 only
+std::atomic<uint32_t> busy_us(0);
+std::atomic<int32_t> lost_slice_count(0);
+std::atomic<int32_t> dropped_slice_count(0);
+std::atomic<int32_t> late_slice_count(0);
+std::atomic<int32_t> latency_histogram[kFeatureLatencyBucketCount];
+std::atomic<uint32_t> max_latency_us(0);
+// Set by core 0 after it read the longest time, cleared by core 1 on the restart
+std::atomic<bool> is_max_latency_read(false);
+
+// Counts the time of a call of PopulateFeatureData() with new slices
+void RecordFeatureLatency(uint32_t latency_us) {
+	std::atomic<int32_t>& bucket = latency_histogram[FeatureLatencyBucket(latency_us)];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	// A time recorded between the read and the restart is lost to the report
+	uint32_t max_us = 0;
+	if (is_max_latency_read.load(std::memory_order_acquire)) {
+		is_max_latency_read.store(false, std::memory_order_relaxed);
+	} else {
+		max_us = max_latency_us.load(std::memory_order_relaxed);
+	}
+	max_latency_us.store((latency_us > max_us) ? latency_us : max_us, std::memory_order_relaxed);
+}
+
+// Computes the new slices of the captured audio and publishes them
+void FeatureTask() {
+	FeatureProvider& feature_provider = *frontend_feature_provider;
+	const int32_t current_time = LatestAudioTimestamp();
+	int how_many_new_slices = 0;
+	const uint32_t start_us = time_us_32();
+	TfLiteStatus feature_status = feature_provider.PopulateFeatureData(frontend_error_reporter, frontend_previous_time,
+	                                                                   current_time, &how_many_new_slices);
+	if (feature_status != kTfLiteOk) {
+		TF_LITE_REPORT_ERROR(frontend_error_reporter, "Feature generation failed");
+		return;
+	}
+	frontend_previous_time = current_time;
+	if (how_many_new_slices == 0) {
+		return;
+	}
+	RecordFeatureLatency(time_us_32() - start_us);
+
+	for (int slice = kFeatureSliceCount - how_many_new_slices; slice < kFeatureSliceCount; slice++) {
+		if (!frontend_slice_queue->Push(frontend_feature_buffer + slice * kFeatureSliceSize,
+		                                feature_provider.slice_is_speech(slice), current_time)) {
+			lost_slice_count.store(lost_slice_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	}
+	frontend_slices_ready();
+	busy_us.store(busy_us.load(std::memory_order_relaxed) + (time_us_32() - start_us), std::memory_order_relaxed);
+	dropped_slice_count.store(feature_provider.dropped_slice_count(), std::memory_order_relaxed);
+	late_slice_count.store(feature_provider.late_slice_count(), std::memory_order_relaxed);
+
+	// Persist the converged frontend noise estimates while nobody is talking.
+	// The flash write pauses core 0 (see StoreFrontendStateIfDue()).
+	if (feature_provider.speech_slice_count() == 0) {
+		StoreFrontendStateIfDue(frontend_error_reporter, current_time);
+	}
+}
+
+void SignalFeatureTask() { frontend_scheduler.Signal(feature_task); }
+
+void FrontendCoreMain() {
+	static FeatureProvider feature_provider(kFeatureElementCount, frontend_feature_buffer);
+	frontend_feature_provider = &feature_provider;
+#if PARALLEL_KERNELS
+	// Compute the kernel parts of core 1 in between, the interrupt also ends the
+	// idle sleep
+	InitForkJoinWorkerInterrupt();
+#endif
+	if (g_idle_clock_gating_enabled) {
+		EnableIdleClockGating();
+	}
+	feature_task = frontend_scheduler.AddTask("features", FeatureTask, 0, kFeatureSliceStrideMs * 1000);
+	frontend_scheduler.SetReportInterval(g_task_report_interval_ms);
+	// The microphone interrupt runs on this core from now on
+	SetAudioSliceHandler(SignalFeatureTask);
+	if (StartAudioCapture(frontend_error_reporter) != kTfLiteOk) {
+		return;
+	}
+	while (true) {
+		frontend_scheduler.RunOnce();
+	}
+}
+
+}  // namespace
+
+void LaunchFrontendCore(tflite::ErrorReporter* error_reporter, SliceQueue* slice_queue, void (*slices_ready)()) {
+	frontend_error_reporter = error_reporter;
+	frontend_slice_queue = slice_queue;
+	frontend_slices_ready = slices_ready;
+	multicore_launch_core1(FrontendCoreMain);
+	// Let core 1 park this core in RAM while it erases and programs the flash
+	multicore_lockout_victim_init();
+}
+
+void GetFrontendCoreStats(FrontendCoreStats* stats) {
+	stats->busy_us = busy_us.load(std::memory_order_relaxed);
+	stats->lost_slice_count = lost_slice_count.load(std::memory_order_relaxed);
+	stats->dropped_slice_count = dropped_slice_count.load(std::memory_order_relaxed);
+	stats->late_slice_count = late_slice_count.load(std::memory_order_relaxed);
+	for (int i = 0; i < kFeatureLatencyBucketCount; i++) {
+		stats->latency_histogram[i] = latency_histogram[i].load(std::memory_order_relaxed);
+	}
+	stats->max_latency_us = max_latency_us.load(std::memory_order_relaxed);
+	is_max_latency_read.store(true, std::memory_order_release);
+}
@@ -0,0 +1,45 @@
+#ifndef FRONTEND_CORE_H_
+#define FRONTEND_CORE_H_
+
+#include <stdint.h>
+
+#include "feature_provider.h"
+#include "slice_queue.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+// Frontend stage of the dual-core pipeline (DUAL_CORE_PIPELINE in
+// CMakeLists.txt). Core 1 owns the audio capture, including the microphone
+// interrupt, the FeatureProvider with its catch-up policy and the frontend state
+// store, and publishes every new feature slice into the slice queue. Core 0
+// only runs the model and the recognizer on the slices it takes from the queue.
+// With PARALLEL_KERNELS, core 1 also computes its part of the kernels from an
+// interrupt (src/fork_join.h). Core 1 computes the features in a task of its own
+// scheduler (src/task_scheduler.h), released by the capture interrupt at every
+// slice stride, and sleeps in between.
+
+// Counters of the frontend stage since boot, safe to read from core 0
+struct FrontendCoreStats {
+	// Time spent generating features
+	uint32_t busy_us;
+	// Slices rejected by the full slice queue
+	int32_t lost_slice_count;
+	// Catch-up counters of the FeatureProvider
+	int32_t dropped_slice_count;
+	int32_t late_slice_count;
+	// Feature generation time of the calls with new slices, in the buckets of
+	// FeatureLatencyBucket(), and the longest since the previous call of
+	// GetFrontendCoreStats()
+	int32_t latency_histogram[kFeatureLatencyBucketCount];
+	uint32_t max_latency_us;
+};
+
+// Launches the frontend loop on core 1, publishing into the given queue, and
+// calling slices_ready on core 1 after new slices were pushed. Call once from
+// core 0, which is prepared to be paused while core 1 writes flash, after the
+// input quantization of the features was set.
+void LaunchFrontendCore(tflite::ErrorReporter* error_reporter, SliceQueue* slice_queue, void (*slices_ready)());
+
+// Call from core 0 only, it restarts the longest feature generation time
+void GetFrontendCoreStats(FrontendCoreStats* stats);
+
+#endif
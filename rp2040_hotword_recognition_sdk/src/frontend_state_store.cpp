@@ -0,0 +1,149 @@
+#include "frontend_state_store.h"
+
+// Project
+#include "config.h"
+#include "micro_features/micro_features_generator.h"
+#include "micro_features/micro_model_settings.h"
+// Pico-sdk
+#include <stddef.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+#if DUAL_CORE_PIPELINE
+#include "pico/multicore.h"
+#endif
+
+namespace {
+
+constexpr uint32_t kRecordMagic = 0x4e525354;  // "NRST"
+constexpr uint32_t kPagesPerSector = FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE;
+constexpr uint32_t kRecordCount = g_frontend_state_sector_count * kPagesPerSector;
+constexpr uint32_t kRegionOffset = PICO_FLASH_SIZE_BYTES - (g_frontend_state_sector_count * FLASH_SECTOR_SIZE);
+
+// A snapshot occupies one flash page
+struct FrontendStateRecord {
+	uint32_t magic;
+	uint32_t sequence;
+	uint32_t channel_count;
+	uint32_t estimates[kFeatureChannelCount];
+	uint32_t checksum;
+};
+static_assert(sizeof(FrontendStateRecord) <= FLASH_PAGE_SIZE, "Frontend state record exceeds a flash page");
+
+// Exports the start address of the store as an absolute symbol, for the check
+// of src/frontend_state_store.ld that the firmware image ends below it
+__attribute__((used)) void DefineStoreStartSymbol() {
+	asm(".global __frontend_state_store_start\n"
+	    ".set __frontend_state_store_start, %c0" ::"i"(XIP_BASE + kRegionOffset));
+}
+
+bool g_is_store_scanned = false;
+// Index of the page to write the next record to, and its sequence number
+uint32_t g_next_record_index = 0;
+uint32_t g_next_sequence = 0;
+bool g_has_stored = false;
+int32_t g_last_store_time = 0;
+
+uint32_t RecordChecksum(const FrontendStateRecord* record) {
+	// FNV-1a over everything but the checksum itself
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(record);
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < offsetof(FrontendStateRecord, checksum); i++) {
+		hash = (hash ^ data[i]) * 16777619u;
+	}
+	return hash;
+}
+
+const FrontendStateRecord* RecordAt(uint32_t index) {
+	return reinterpret_cast<const FrontendStateRecord*>(XIP_BASE + kRegionOffset + index * FLASH_PAGE_SIZE);
+}
+
+bool IsValidRecord(const FrontendStateRecord* record) {
+	return (record->magic == kRecordMagic) && (record->channel_count == kFeatureChannelCount) &&
+	       (record->checksum == RecordChecksum(record));
+}
+
+// Finds the newest valid record by its sequence number and the page following it
+const FrontendStateRecord* ScanStore() {
+	const FrontendStateRecord* newest = nullptr;
+	uint32_t newest_index = 0;
+	for (uint32_t i = 0; i < kRecordCount; i++) {
+		const FrontendStateRecord* record = RecordAt(i);
+		if (IsValidRecord(record) && ((newest == nullptr) || (int32_t)(record->sequence - newest->sequence) > 0)) {
+			newest = record;
+			newest_index = i;
+		}
+	}
+	if (newest != nullptr) {
+		g_next_record_index = (newest_index + 1) % kRecordCount;
+		g_next_sequence = newest->sequence + 1;
+	}
+	g_is_store_scanned = true;
+	return newest;
+}
+
+}  // namespace
+
+bool LoadMicroFeaturesNoiseEstimates(uint32_t* estimates, int channel_count) {
+	if (!g_frontend_state_store_enabled || (channel_count != kFeatureChannelCount)) {
+		return false;
+	}
+	const FrontendStateRecord* record = ScanStore();
+	if (record == nullptr) {
+		return false;
+	}
+	memcpy(estimates, record->estimates, sizeof(record->estimates));
+	return true;
+}
+
+TfLiteStatus StoreFrontendStateIfDue(tflite::ErrorReporter* error_reporter, int32_t current_time_ms) {
+	// With USB_MICROPHONE a sector erase, which masks interrupts for tens of
+	// milliseconds, would stall the stream and overrun the capture ring. Stored
+	// estimates still load.
+	// The first snapshot is due at the minimum uptime, the next ones an interval
+	// after the one before
+	if (USB_MICROPHONE || !g_frontend_state_store_enabled || (current_time_ms < g_frontend_state_min_uptime_ms) ||
+	    (g_has_stored && (current_time_ms - g_last_store_time < g_frontend_state_store_interval_ms))) {
+		return kTfLiteOk;
+	}
+	g_has_stored = true;
+	g_last_store_time = current_time_ms;
+	if (!g_is_store_scanned) {
+		ScanStore();
+	}
+
+	// Flash is programmed a full page at a time; unused bytes stay erased
+	static uint8_t page[FLASH_PAGE_SIZE];
+	memset(page, 0xff, sizeof(page));
+	FrontendStateRecord* record = reinterpret_cast<FrontendStateRecord*>(page);
+	record->magic = kRecordMagic;
+	record->sequence = g_next_sequence;
+	record->channel_count = kFeatureChannelCount;
+	GetMicroFeaturesNoiseEstimates(record->estimates);
+	record->checksum = RecordChecksum(record);
+
+	const uint32_t offset = kRegionOffset + g_next_record_index * FLASH_PAGE_SIZE;
+#if DUAL_CORE_PIPELINE
+	// The other core executes from flash as well, park it in RAM meanwhile
+	multicore_lockout_start_blocking();
+#endif
+	const uint32_t interrupts = save_and_disable_interrupts();
+	// Erase a sector just before its first page is reused
+	if ((g_next_record_index % kPagesPerSector) == 0) {
+		flash_range_erase(offset, FLASH_SECTOR_SIZE);
+	}
+	flash_range_program(offset, page, FLASH_PAGE_SIZE);
+	restore_interrupts(interrupts);
+#if DUAL_CORE_PIPELINE
+	multicore_lockout_end_blocking();
+#endif
+
+	if (!IsValidRecord(RecordAt(g_next_record_index))) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Storing frontend state failed");
+		return kTfLiteError;
+	}
+	g_next_record_index = (g_next_record_index + 1) % kRecordCount;
+	g_next_sequence++;
+	return kTfLiteOk;
+}
@@ -0,0 +1,22 @@
+#ifndef FRONTEND_STATE_STORE_H_
+#define FRONTEND_STATE_STORE_H_
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+// Persists the adaptive noise estimates of the feature frontend in a reserved
+// region at the end of the flash, so that InitializeMicroFeatures() can restore
+// converged estimates after a reboot (see LoadMicroFeaturesNoiseEstimates()).
+// Each snapshot is appended as a record in its own flash page. The sectors of
+// the region are used as a ring and only erased when the ring wraps around,
+// which spreads the erase cycles over all pages of the region.
+
+// Stores a snapshot of the current noise estimates if the store interval has
+// passed since the last one and the frontend has been running long enough to
+// converge. Call regularly from the main loop, preferably while no speech is
+// present. Interrupts are disabled while the flash is written, and in the
+// dual-core pipeline the other core is paused. Nothing is stored in the
+// USB_MICROPHONE build, which has to serve the USB frames without gaps.
+TfLiteStatus StoreFrontendStateIfDue(tflite::ErrorReporter* error_reporter, int32_t current_time_ms);
+
+#endif
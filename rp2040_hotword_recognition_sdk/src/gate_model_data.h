@@ -0,0 +1,11 @@
+#ifndef GATE_MODEL_DATA_H_
+#define GATE_MODEL_DATA_H_
+
+// Yes/no model running as gate of the two-stage cascade (CASCADE_GATE in
+// CMakeLists.txt), generated from src/micro_speech_model_data_yesno.cpp with
+// renamed symbols, so it links next to the recognition model
+
+extern const unsigned int g_gate_model_data_size;
+extern const unsigned char g_gate_model_data[];
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LOG_MESSAGES_H_
+#define LOG_MESSAGES_H_
+
+// Messages of the log ring (src/log_ring.h) as LOG_MESSAGE(id, format) list.
+// The ID of a message is its position in the list, so the format strings stay
+// on the device and the log ring only carries IDs and arguments.
+// scripts/decode_log.py reads the formats from this file: append new messages
+// at the end, so the IDs of older firmware builds keep their meaning.
+// Arguments are int32 values (%d, %u, %x) or static strings (%s).
+#define LOG_MESSAGES(LOG_MESSAGE)                                                          \
+	LOG_MESSAGE(kLogText, "%s")                                                            \
+	LOG_MESSAGE(kLogDropped, "Log ring: %d records dropped on core %d")                    \
+	LOG_MESSAGE(kLogHeard, "Heard %s (%d) @%dms")                                          \
+	LOG_MESSAGE(kLogHeardEarly, "Heard %s (%d) @%dms early")                               \
+	LOG_MESSAGE(kLogConfirmed, "Confirmed %s @%dms")                                       \
+	LOG_MESSAGE(kLogRetracted, "Retracted %s @%dms")                                       \
+	LOG_MESSAGE(kLogHeardSequence, "Heard sequence %s @%dms-%dms")                         \
+	LOG_MESSAGE(kLogAudioTimings,                                                          \
+	            "rec time: %d us, rec interval: %d us, write time: %d us, "                \
+	            "write interval: %d us, audio @%dms")                                      \
+	LOG_MESSAGE(kLogBootTime, "Boot: setup done @%dms, first window @%dms after reset")    \
+	LOG_MESSAGE(kLogTaskStats, "Tasks core %d: %s %d runs, %d missed, max %d us")          \
+	LOG_MESSAGE(kLogTaskSleep, "Tasks core %d: %d%% asleep")                               \
+	LOG_MESSAGE(kLogClockPoint, "Clock %s: %d MHz @%d mV, %d inferences, %d us and ~%d uJ per inference") \
+	LOG_MESSAGE(kLogUsbStream,                                                             \
+	            "USB microphone: %d blocks, %d duplicated, %d skipped, %d resyncs")        \
+	LOG_MESSAGE(kLogFeatureTimes,                                                          \
+	            "Feature time histogram: <1ms: %d <2ms: %d <5ms: %d <10ms: %d")            \
+	LOG_MESSAGE(kLogFeatureTimesLong,                                                      \
+	            "Feature time histogram: <20ms: %d <50ms: %d <100ms: %d more: %d")         \
+	LOG_MESSAGE(kLogFramesDropped, "Log ring: %d binary frames dropped")                   \
+	LOG_MESSAGE(kLogFeatureSlices,                                                         \
+	            "Feature slices: %d dropped, %d late, max %d us per loop")                 \
+	LOG_MESSAGE(kLogInferenceTicks, "Inference took %d ticks")                             \
+	LOG_MESSAGE(kLogDutyCycle, "Inference duty cycle: %d%% (%d of %d)")                    \
+	LOG_MESSAGE(kLogCascade,                                                               \
+	            "Cascade: model on %d of %d windows, %d us gate, %d us model, "            \
+	            "CPU load %d%% (%d%% always running the model)")                           \
+	LOG_MESSAGE(kLogPipelineLoad,                                                          \
+	            "Pipeline: frontend busy %d%%, inference busy %d%%, "                      \
+	            "queue max %d of %d slices")                                               \
+	LOG_MESSAGE(kLogPipelineSlices,                                                        \
+	            "Pipeline: slices %d lost, %d dropped, %d late, "                          \
+	            "max %d us per feature task")                                              \
+	LOG_MESSAGE(kLogFirstInference, "Boot: first inference @%dms after reset")
+
+#define LOG_MESSAGE_ID(id, format) id,
+enum LogMessageId { LOG_MESSAGES(LOG_MESSAGE_ID) kLogMessageCount };
+#undef LOG_MESSAGE_ID
+
+// Format strings by LogMessageId
+extern const char* const kLogFormats[kLogMessageCount];
+
+#endif
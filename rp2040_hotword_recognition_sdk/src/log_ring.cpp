@@ -0,0 +1,342 @@
+#include "log_ring.h"
+
+#include <string.h>
+
+#include <atomic>
+
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+#define LOG_MESSAGE_FORMAT(id, format) format,
+const char* const kLogFormats[kLogMessageCount] = {LOG_MESSAGES(LOG_MESSAGE_FORMAT)};
+#undef LOG_MESSAGE_FORMAT
+
+namespace {
+constexpr uint8_t kSync[2] = {0x00, 0xA7};
+constexpr uint8_t kFrameVersion = 1;
+constexpr int kHeaderSize = 4;
+constexpr int kCoreCount = 2;
+// Records per core, a power of two
+constexpr uint32_t kRingCapacity = 128;
+// Text bytes per kLogText record and longest logged text
+constexpr int kTextBytesPerRecord = sizeof(LogRecord::args);
+constexpr int kMaxTextLength = 256;
+
+struct LogRing {
+	LogRecord records[kRingCapacity];
+	// Free running indices, the slot is the index modulo kRingCapacity. The owning
+	// core writes the tail and the drop count, the draining core the head.
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	std::atomic<uint32_t> dropped_count;
+	// Drops reported by the draining core
+	uint32_t reported_dropped_count;
+};
+
+// Binary frames of other protocols, each stored as uint16 size and its bytes.
+// Producer is the queueing core, consumer the draining one.
+constexpr uint32_t kFrameQueueCapacity = 1024;  // bytes, a power of two
+struct FrameQueue {
+	uint8_t bytes[kFrameQueueCapacity];
+	// Free running byte indices, as the ones of LogRing
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	std::atomic<uint32_t> dropped_count;
+	uint32_t reported_dropped_count;
+};
+
+LogRing rings[kCoreCount];
+FrameQueue frame_queue;
+uint8_t frame[kLogMaxFrameSize];
+static_assert(kLogMaxFrameSize >= kLogMaxTextLength, "Text lines are formatted into the frame buffer");
+// Core whose ring is drained first, alternating so both get their turn
+int first_drain_core = 0;
+
+uint16_t Fletcher16(const uint8_t* data, int size) {
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	for (int i = 0; i < size; i++) {
+		sum1 = (sum1 + data[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return static_cast<uint16_t>((sum2 << 8) | sum1);
+}
+
+void WriteUint32(uint32_t value, uint8_t* buffer) {
+	for (int i = 0; i < 4; i++) {
+		buffer[i] = (value >> (8 * i)) & 0xff;
+	}
+}
+
+// Formats the message of the record into a text line of at most
+// kLogMaxTextLength bytes, without terminating zero, and returns its length.
+// Each conversion of the format is passed its argument with the type of the
+// record, an int32 value or a string.
+int FormatRecord(const LogRecord& record, char* buffer) {
+	constexpr int kMaxLength = kLogMaxTextLength - 1;
+	const char* format = kLogFormats[record.id];
+	int length = 0;
+	int arg = 0;
+	while ((*format != '\0') && (length < kMaxLength)) {
+		if (*format != '%') {
+			buffer[length++] = *format++;
+			continue;
+		}
+		// Conversion specification up to its conversion character
+		const char* start = format++;
+		while ((*format != '\0') && (strchr("diuxXs%", *format) == nullptr)) {
+			format++;
+		}
+		char spec[8];
+		const int spec_length = format - start + 1;
+		if ((*format == '\0') || (spec_length >= static_cast<int>(sizeof(spec)))) {
+			break;
+		}
+		memcpy(spec, start, spec_length);
+		spec[spec_length] = '\0';
+		const char conversion = *format++;
+		// snprintf() writes the terminating zero into the last byte of the room
+		const int room = kMaxLength + 1 - length;
+		int written = 0;
+		if (conversion == '%') {
+			written = snprintf(buffer + length, room, "%%");
+		} else if (arg >= record.arg_count) {
+			written = 0;
+		} else if (record.string_args & (1 << arg)) {
+			written = snprintf(buffer + length, room, spec, reinterpret_cast<const char*>(record.args[arg++]));
+		} else {
+			written = snprintf(buffer + length, room, spec, static_cast<int32_t>(record.args[arg++]));
+		}
+		if (written > 0) {
+			length += (written < room) ? written : (room - 1);
+		}
+	}
+	buffer[length] = '\n';
+	return length + 1;
+}
+
+// Writes the frame of the record, or its text without binary logging, to buffer
+// and returns its size
+int WriteFrame(int core, const LogRecord& record, uint8_t* buffer) {
+	if (!g_binary_log_enabled) {
+		if (record.id == kLogText) {
+			memcpy(buffer, record.args, record.arg_count);
+			return record.arg_count;
+		}
+		return FormatRecord(record, reinterpret_cast<char*>(buffer));
+	}
+	buffer[0] = kSync[0];
+	buffer[1] = kSync[1];
+	buffer[2] = kFrameVersion;
+	uint8_t* payload = buffer + kHeaderSize;
+	payload[0] = core;
+	payload[1] = record.id & 0xff;
+	payload[2] = record.id >> 8;
+	payload[3] = record.arg_count;
+	payload[4] = record.string_args;
+	WriteUint32(record.time_us, payload + 5);
+	int size = 9;
+	if (record.id == kLogText) {
+		memcpy(payload + size, record.args, record.arg_count);
+		size += record.arg_count;
+	} else {
+		for (int i = 0; i < record.arg_count; i++) {
+			if (record.string_args & (1 << i)) {
+				const char* text = reinterpret_cast<const char*>(record.args[i]);
+				int length = 0;
+				while ((length < kLogMaxStringLength) && (text[length] != '\0')) {
+					length++;
+				}
+				payload[size] = length;
+				memcpy(payload + size + 1, text, length);
+				size += 1 + length;
+			} else {
+				WriteUint32(record.args[i], payload + size);
+				size += 4;
+			}
+		}
+	}
+	buffer[3] = size;
+	const uint16_t checksum = Fletcher16(payload, size);
+	payload[size] = checksum & 0xff;
+	payload[size + 1] = checksum >> 8;
+	return kHeaderSize + size + 2;
+}
+
+// Writes bytes the USB CDC transmit buffer has room for
+void WriteBytes(const uint8_t* bytes, int size) {
+#if USB_MICROPHONE
+	// The CDC port of the composite device, the handler of TinyUSB drains the ring
+	tud_cdc_write(bytes, size);
+#else
+	// Bypass the newline translation of stdio
+	for (int i = 0; i < size; i++) {
+		putchar_raw(bytes[i]);
+	}
+#endif
+}
+
+// Sends the frame or text of the record if the USB CDC transmit buffer has room
+// for it
+bool SendFrame(int core, const LogRecord& record) {
+	const int frame_size = WriteFrame(core, record, frame);
+	if (tud_cdc_write_available() < static_cast<uint32_t>(frame_size)) {
+		return false;
+	}
+	WriteBytes(frame, frame_size);
+	return true;
+}
+
+// Sends the records of one ring and then its drops. Returns false when the
+// transmit buffer is full.
+bool DrainRing(int core) {
+	LogRing& ring = rings[core];
+	uint32_t head = ring.head.load(std::memory_order_relaxed);
+	while (head != ring.tail.load(std::memory_order_acquire)) {
+		if (!SendFrame(core, ring.records[head % kRingCapacity])) {
+			return false;
+		}
+		head++;
+		ring.head.store(head, std::memory_order_release);
+	}
+	const uint32_t dropped_count = ring.dropped_count.load(std::memory_order_relaxed);
+	if (dropped_count != ring.reported_dropped_count) {
+		LogRecord record;
+		record.id = kLogDropped;
+		record.arg_count = 2;
+		record.string_args = 0;
+		record.time_us = time_us_32();
+		record.args[0] = dropped_count - ring.reported_dropped_count;
+		record.args[1] = core;
+		if (!SendFrame(core, record)) {
+			return false;
+		}
+		ring.reported_dropped_count = dropped_count;
+	}
+	return true;
+}
+
+// Sends the queued frames and then their drops. Returns false when the transmit
+// buffer is full.
+bool DrainFrameQueue() {
+	FrameQueue& queue = frame_queue;
+	uint32_t head = queue.head.load(std::memory_order_relaxed);
+	while (head != queue.tail.load(std::memory_order_acquire)) {
+		const int size = queue.bytes[head % kFrameQueueCapacity] | (queue.bytes[(head + 1) % kFrameQueueCapacity] << 8);
+		if (tud_cdc_write_available() < static_cast<uint32_t>(size)) {
+			return false;
+		}
+		// The frame may wrap around the end of the queue
+		const uint32_t start = (head + 2) % kFrameQueueCapacity;
+		const int first_size = (start + size <= kFrameQueueCapacity) ? size : (kFrameQueueCapacity - start);
+		WriteBytes(queue.bytes + start, first_size);
+		WriteBytes(queue.bytes, size - first_size);
+		head += 2 + size;
+		queue.head.store(head, std::memory_order_release);
+	}
+	const uint32_t dropped_count = queue.dropped_count.load(std::memory_order_relaxed);
+	if (dropped_count != queue.reported_dropped_count) {
+		LogRecord record;
+		record.id = kLogFramesDropped;
+		record.arg_count = 1;
+		record.string_args = 0;
+		record.time_us = time_us_32();
+		record.args[0] = dropped_count - queue.reported_dropped_count;
+		if (!SendFrame(get_core_num(), record)) {
+			return false;
+		}
+		queue.reported_dropped_count = dropped_count;
+	}
+	return true;
+}
+
+// Producer: checks for room for count records at the tail, otherwise counts them
+// as dropped. Called with interrupts masked.
+bool HasRoom(LogRing* ring, uint32_t tail, int count) {
+	if (tail + count - ring->head.load(std::memory_order_acquire) > kRingCapacity) {
+		ring->dropped_count.store(ring->dropped_count.load(std::memory_order_relaxed) + count,
+		                          std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+}  // namespace
+
+bool PushLogRecord(LogRecord* record) {
+	record->time_us = time_us_32();
+	LogRing& ring = rings[get_core_num()];
+	// Only handlers on this core can interleave with the producer
+	const uint32_t interrupts = save_and_disable_interrupts();
+	const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+	const bool has_room = HasRoom(&ring, tail, 1);
+	if (has_room) {
+		ring.records[tail % kRingCapacity] = *record;
+		ring.tail.store(tail + 1, std::memory_order_release);
+	}
+	restore_interrupts(interrupts);
+	return has_room;
+}
+
+bool QueueLogFrame(const uint8_t* data, int size) {
+	FrameQueue& queue = frame_queue;
+	const uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+	if ((size <= 0) || (tail + 2 + size - queue.head.load(std::memory_order_acquire) > kFrameQueueCapacity)) {
+		queue.dropped_count.store(queue.dropped_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return false;
+	}
+	queue.bytes[tail % kFrameQueueCapacity] = size & 0xff;
+	queue.bytes[(tail + 1) % kFrameQueueCapacity] = size >> 8;
+	for (int i = 0; i < size; i++) {
+		queue.bytes[(tail + 2 + i) % kFrameQueueCapacity] = data[i];
+	}
+	queue.tail.store(tail + 2 + size, std::memory_order_release);
+	return true;
+}
+
+void LogText(const char* text) {
+	int length = strlen(text);
+	if (length > kMaxTextLength) {
+		length = kMaxTextLength;
+	}
+	const int count = (length + kTextBytesPerRecord - 1) / kTextBytesPerRecord;
+	if (count == 0) {
+		return;
+	}
+	const uint32_t time_us = time_us_32();
+	LogRing& ring = rings[get_core_num()];
+	// The records of the text stay together, even if a handler logs in between
+	const uint32_t interrupts = save_and_disable_interrupts();
+	const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+	if (HasRoom(&ring, tail, count)) {
+		for (int i = 0; i < count; i++) {
+			LogRecord& record = ring.records[(tail + i) % kRingCapacity];
+			const int offset = i * kTextBytesPerRecord;
+			record.id = kLogText;
+			record.arg_count = (length - offset < kTextBytesPerRecord) ? (length - offset) : kTextBytesPerRecord;
+			record.string_args = 0;
+			record.time_us = time_us;
+			memcpy(record.args, text + offset, record.arg_count);
+		}
+		ring.tail.store(tail + count, std::memory_order_release);
+	}
+	restore_interrupts(interrupts);
+}
+
+void DrainLogRing() {
+	if (!tud_cdc_connected()) {
+		return;
+	}
+	first_drain_core = (first_drain_core + 1) % kCoreCount;
+	bool has_room = true;
+	for (int i = 0; has_room && (i < kCoreCount); i++) {
+		has_room = DrainRing((first_drain_core + i) % kCoreCount);
+	}
+	if (has_room) {
+		DrainFrameQueue();
+	}
+#if USB_MICROPHONE
+	// The USB stdio flushes on its own
+	tud_cdc_write_flush();
+#endif
+}
@@ -0,0 +1,107 @@
+#ifndef LOG_RING_H_
+#define LOG_RING_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "log_messages.h"
+
+// Deferred logging. Log() stores the message ID of src/log_messages.h, the
+// time and up to kLogMaxArgs raw arguments as fixed-size record in a ring,
+// without formatting and without waiting for the USB serial port, so it is
+// cheap enough for the recognition path, core 1 and interrupt handlers.
+// DrainLogRing(), called from the main loop, sends the records as binary frames
+// while the USB CDC transmit buffer has room, and scripts/decode_log.py turns
+// them back into text on the host. A full ring drops new records and counts
+// them, it never blocks.
+//
+// Each core has its own ring. The Cortex-M0+ has no atomic read-modify-write
+// instructions, so a ring shared by both cores would need a lock; with one ring
+// per core the producer is always the owning core, and interrupts are only
+// masked for the copy of the record, against handlers on the same core. The
+// consumer is the core draining the rings, as in src/slice_queue.h.
+//
+// With g_binary_log_enabled false, DrainLogRing() formats the records into text
+// lines instead of frames, so the callers of Log() never format either way. The
+// output waits in the ring until a host opens the serial port, so the firmware
+// does not wait for one at boot.
+//
+// Frame layout, multi-byte values little endian:
+//   0x00 0xA7                      sync, never part of text output
+//   uint8 version, uint8 payload_size
+//   uint8 core, uint16 id, uint8 arg_count, uint8 string_args, uint32 time_us
+//   arg_count arguments: int32 value, or if bit i of string_args is set
+//                        uint8 length and the string bytes
+//                        (kLogText: arg_count bytes of text instead)
+//   uint16 Fletcher-16 checksum of the payload
+constexpr int kLogMaxArgs = 6;
+constexpr int kLogMaxStringLength = 32;
+constexpr int kLogMaxFrameSize = 4 + 9 + kLogMaxArgs * (1 + kLogMaxStringLength) + 2;
+// Longest text line of a message formatted by DrainLogRing()
+constexpr int kLogMaxTextLength = 128;
+
+// 32 bytes on the RP2040
+struct LogRecord {
+	uint16_t id;
+	// Number of arguments, or of text bytes for kLogText
+	uint8_t arg_count;
+	// Bit i set if args[i] points to a static string
+	uint8_t string_args;
+	uint32_t time_us;
+	// Int32 values or string pointers
+	uintptr_t args[kLogMaxArgs];
+};
+
+// Appends the record to the ring of the calling core. Returns false and counts
+// it as dropped if the ring is full.
+bool PushLogRecord(LogRecord* record);
+
+// Logs text that was formatted already, like the output of TF_LITE_REPORT_ERROR
+// passed to the debug log callback, as one block of kLogText records. Text
+// longer than 256 bytes is cut.
+void LogText(const char* text);
+
+// Queues a binary frame of another protocol, like the frames of the statistics
+// profiler and the posterior trace, which DrainLogRing() sends unchanged after
+// the records. Returns false and counts it as dropped if the 1 KB queue is full.
+// Call from one core only, and not from interrupt handlers.
+bool QueueLogFrame(const uint8_t* data, int size);
+
+// Sends the records of both rings and the queued frames that fit into the USB
+// CDC transmit buffer. Records stay in the ring while no host is connected.
+void DrainLogRing();
+
+namespace log_ring_internal {
+inline void SetArg(LogRecord* record, int index, const char* value) {
+	record->args[index] = reinterpret_cast<uintptr_t>(value);
+	record->string_args |= 1 << index;
+}
+
+inline void SetArg(LogRecord* record, int index, int32_t value) {
+	record->args[index] = static_cast<uint32_t>(value);
+}
+
+inline void SetArgs(LogRecord*, int) {}
+
+template <typename T, typename... Args>
+inline void SetArgs(LogRecord* record, int index, T value, Args... args) {
+	SetArg(record, index, value);
+	SetArgs(record, index + 1, args...);
+}
+}  // namespace log_ring_internal
+
+// Logs the message with its arguments: ints, or strings that stay valid until
+// the record is drained, like labels and string literals
+template <typename... Args>
+inline void Log(LogMessageId id, Args... args) {
+	static_assert(sizeof...(Args) <= kLogMaxArgs, "Too many log arguments");
+	LogRecord record;
+	record.id = id;
+	record.arg_count = sizeof...(Args);
+	record.string_args = 0;
+	log_ring_internal::SetArgs(&record, 0, args...);
+	PushLogRecord(&record);
+}
+
+#endif
@@ -19,14 +19,34 @@ limitations under the License.
 #include "config.h"
 #include "main_functions.h"
 #include "audio_provider.h"
+#include "cascade_gate.h"
+#include "clock_scaling.h"
+#include "command_sequence.h"
 #include "command_responder.h"
+#include "compiled_model.h"
+#include "early_commit.h"
 #include "feature_provider.h"
+#include "fork_join.h"
+#include "frontend_core.h"
+#include "frontend_state_store.h"
+#include "gate_model_data.h"
+#include "log_ring.h"
+#include "micro_features/micro_features_generator.h"
 #include "micro_features/micro_model_settings.h"
 #include "micro_speech_model_data.h"
+#include "model_arena_size.h"
+#include "parallel_kernels.h"
+#include "posterior_trace.h"
 #include "recognize_commands.h"
+#include "slice_queue.h"
+#include "stats_profiler.h"
+#include "streaming_depthwise_conv.h"
+#include "task_scheduler.h"
+#include "usb/usb_composite.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/micro_profiler.h"
 #include "tensorflow/lite/micro/system_setup.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 // Pico-sdk
@@ -34,7 +54,7 @@ limitations under the License.
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/pdm_microphone.h"
-#include "tusb.h"
+#include "hardware/structs/xip_ctrl.h"
 // Tensorflow logging
 #include "tensorflow/lite/micro/cortex_m_generic/debug_log_callback.h"
 
@@ -46,32 +66,302 @@ tflite::MicroInterpreter* interpreter = nullptr;
 TfLiteTensor* model_input = nullptr;
 FeatureProvider* feature_provider = nullptr;
 RecognizeCommands* recognizer = nullptr;
+EarlyCommitRecognizer* early_commit = nullptr;
+CommandSequenceRecognizer* sequence_recognizer = nullptr;
+tflite::MicroProfiler* profiler = nullptr;
+StatsProfiler* stats_profiler = nullptr;
 int32_t previous_time = 0;
 
+// raspberry pico PICO_DEFAULT_LED_PIN: 25
+// arduino rp2040 nano PICO_DEFAULT_LED_PIN: 6
+constexpr uint kLedPin = 6;
+// Boot time, reported with the first window and the first inference, which the
+// voice activity gate or the cascade can postpone until somebody speaks
+uint32_t setup_done_us = 0;
+bool first_window_done = false;
+bool first_inference_done = false;
+
+// Scheduler of core 0, running the recognition on new slices and draining the
+// log ring
+TaskScheduler scheduler;
+int recognition_task = -1;
+void RecognitionTask();
+void SignalRecognitionTask() { scheduler.Signal(recognition_task); }
+
+void LogTask() {
+#if USB_MICROPHONE
+	// The TinyUSB handler drains the ring into the CDC port
+	ScheduleUsbTask();
+#else
+	DrainLogRing();
+#endif
+}
+
+#if COMPILED_MODEL
+// Input features and output scores of the compiled model, which keeps its
+// intermediate tensors in static buffers
+int8_t compiled_model_input[kFeatureElementCount];
+int8_t compiled_model_scores[kCategoryCount];
+#else
 // Create an area of memory to use for input, output, and intermediate arrays.
-// The size of this will depend on the model you're using, and may need to be
-// determined by experimentation.
-constexpr int kTensorArenaSize = 10 * 1024;
-uint8_t tensor_arena[kTensorArenaSize];
+// The size is measured for the used model at build time (model_arena_size.h).
+constexpr int kTensorArenaSize = kModelArenaSize;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+#endif
 int8_t feature_buffer[kFeatureElementCount];
 int8_t* model_input_buffer = nullptr;
+
+// Scores fed to the recognizer while the voice activity gate skips inference
+int8_t silence_scores[kCategoryCount];
+// Inference duty cycle statistics of the voice activity gate
+int32_t vad_report_time = 0;
+int32_t vad_inference_count = 0;
+int32_t vad_skipped_count = 0;
+#if CASCADE_GATE
+// Gate model of the two-stage cascade, allocated after the recognition model in
+// the same arena. Both run one after the other, so they share the activations.
+tflite::MicroInterpreter* gate_interpreter = nullptr;
+CascadeGate* cascade_gate = nullptr;
+// Windows and invoke time of both stages per report
+int32_t cascade_report_time = 0;
+int32_t cascade_gate_count = 0;
+int32_t cascade_model_count = 0;
+uint32_t cascade_gate_us = 0;
+uint32_t cascade_model_us = 0;
+#endif
+#if DUAL_CORE_PIPELINE
+// Feature slices published by core 1 and the voice activity flags of the
+// slices in feature_buffer
+SliceQueue slice_queue;
+bool window_slice_is_speech[kFeatureSliceCount] = {false};
+int window_speech_slice_count = 0;
+// Busy time of the inference stage and slice queue fill level per report
+int32_t pipeline_report_time = 0;
+uint32_t pipeline_report_us = 0;
+uint32_t pipeline_frontend_busy_us = 0;
+uint32_t inference_busy_us = 0;
+int queue_max_depth = 0;
+// Counts of the feature time histogram of core 1 at the previous report
+int32_t pipeline_latency_histogram[kFeatureLatencyBucketCount] = {0};
+#else
+// Feature generation time per loop, counted in the buckets of
+// FeatureLatencyBucket()
+int32_t feature_latency_histogram[kFeatureLatencyBucketCount] = {0};
+uint32_t feature_latency_max_us = 0;
+int32_t feature_report_time = 0;
+#endif
+// Binary frames of the statistics profiler
+int32_t profiler_report_time = 0;
+uint8_t profiler_frame[StatsProfiler::kMaxFrameSize];
+// Binary frame of the posterior trace
+uint8_t trace_frame[kPosteriorTraceFrameSize];
+
+#if !COMPILED_MODEL
+// Reads the quantization of the model input from the flatbuffer, so the features
+// can be quantized before the interpreter is built
+bool GetModelInputQuantization(const tflite::Model* model, float* scale, int32_t* zero_point) {
+	const tflite::SubGraph* subgraph = model->subgraphs()->Get(0);
+	const tflite::Tensor* input = subgraph->tensors()->Get(subgraph->inputs()->Get(0));
+	const tflite::QuantizationParameters* quantization = input->quantization();
+	if ((quantization == nullptr) || (quantization->scale() == nullptr) || (quantization->scale()->size() != 1) ||
+	    (quantization->zero_point() == nullptr) || (quantization->zero_point()->size() != 1)) {
+		return false;
+	}
+	*scale = quantization->scale()->Get(0);
+	*zero_point = static_cast<int32_t>(quantization->zero_point()->Get(0));
+	return true;
+}
+#endif
+
+// Logs the counts of the buckets of FeatureLatencyBucket()
+void LogFeatureLatencyHistogram(const int32_t* histogram) {
+	static_assert(kFeatureLatencyBucketCount == 8, "The log messages have four buckets each");
+	Log(kLogFeatureTimes, histogram[0], histogram[1], histogram[2], histogram[3]);
+	Log(kLogFeatureTimesLong, histogram[4], histogram[5], histogram[6], histogram[7]);
+}
+
+#if DUAL_CORE_PIPELINE
+// Moves the slices published by core 1 into the spectrogram window and returns
+// their number. Sets current_time to the time of the newest slice.
+int TakeQueuedSlices(int32_t* current_time) {
+	const int queued = slice_queue.size();
+	if (queued > queue_max_depth) {
+		queue_max_depth = queued;
+	}
+	int count = 0;
+	for (; count < (int)SliceQueue::kCapacity; count++) {
+		const SliceQueue::Slice* slice = slice_queue.Front();
+		if (slice == nullptr) {
+			break;
+		}
+		memmove(feature_buffer, feature_buffer + kFeatureSliceSize, (kFeatureSliceCount - 1) * kFeatureSliceSize);
+		memcpy(feature_buffer + (kFeatureSliceCount - 1) * kFeatureSliceSize, slice->features, kFeatureSliceSize);
+		memmove(window_slice_is_speech, window_slice_is_speech + 1, (kFeatureSliceCount - 1) * sizeof(bool));
+		window_slice_is_speech[kFeatureSliceCount - 1] = slice->is_speech;
+		*current_time = slice->time_ms;
+		slice_queue.Pop();
+	}
+	window_speech_slice_count = 0;
+	for (int i = 0; i < kFeatureSliceCount; i++) {
+		window_speech_slice_count += window_slice_is_speech[i] ? 1 : 0;
+	}
+	return count;
+}
+
+// Reports the share of time each pipeline stage was busy, the maximum slice
+// queue fill level and the slices lost on the way since the last report
+void ReportPipelineIfDue(int32_t current_time) {
+	if ((g_pipeline_report_interval_ms <= 0) || (current_time - pipeline_report_time < g_pipeline_report_interval_ms)) {
+		return;
+	}
+	FrontendCoreStats stats;
+	GetFrontendCoreStats(&stats);
+	const uint32_t now_us = time_us_32();
+	const uint64_t interval_us = now_us - pipeline_report_us;
+	Log(kLogPipelineLoad, (int32_t)((100 * (uint64_t)(stats.busy_us - pipeline_frontend_busy_us)) / interval_us),
+	    (int32_t)((100 * (uint64_t)inference_busy_us) / interval_us), (int32_t)queue_max_depth,
+	    (int32_t)SliceQueue::kCapacity);
+	Log(kLogPipelineSlices, (int32_t)stats.lost_slice_count, (int32_t)stats.dropped_slice_count,
+	    (int32_t)stats.late_slice_count, (int32_t)stats.max_latency_us);
+	// Core 1 counts since boot, the report shows the calls since the last one
+	int32_t histogram[kFeatureLatencyBucketCount];
+	for (int i = 0; i < kFeatureLatencyBucketCount; i++) {
+		histogram[i] = stats.latency_histogram[i] - pipeline_latency_histogram[i];
+		pipeline_latency_histogram[i] = stats.latency_histogram[i];
+	}
+	LogFeatureLatencyHistogram(histogram);
+	pipeline_report_time = current_time;
+	pipeline_report_us = now_us;
+	pipeline_frontend_busy_us = stats.busy_us;
+	inference_busy_us = 0;
+	queue_max_depth = 0;
+}
+#endif
+
+// Runs the model on model_input_buffer, returns false if it failed
+bool InvokeModel() {
+#if COMPILED_MODEL
+	return CompiledModelInvoke(model_input_buffer, compiled_model_scores);
+#else
+	return interpreter->Invoke() == kTfLiteOk;
+#endif
+}
+
+// Returns the output scores of the last inference
+const int8_t* ModelScores() {
+#if COMPILED_MODEL
+	return compiled_model_scores;
+#else
+	return interpreter->output(0)->data.int8;
+#endif
+}
+
+#if CASCADE_GATE
+// Runs the gate model on the spectrogram window and returns whether the
+// recognition model runs on it
+bool CascadeGateOpen(int32_t current_time) {
+	cascade_gate->ConvertFeatures(feature_buffer, gate_interpreter->input(0)->data.int8, kFeatureElementCount);
+	const uint32_t start_us = time_us_32();
+	if (gate_interpreter->Invoke() != kTfLiteOk) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Gate model invoke failed");
+		return true;
+	}
+	cascade_gate_us += time_us_32() - start_us;
+	cascade_gate_count++;
+	return cascade_gate->Update(gate_interpreter->output(0)->data.int8, current_time);
+}
+
+// Reports the share of gate windows the recognition model ran on and the CPU
+// load of both stages, against the load of running the recognition model on
+// every gate window
+void ReportCascadeIfDue(int32_t current_time) {
+	const int32_t interval_ms = current_time - cascade_report_time;
+	if ((g_cascade_report_interval_ms <= 0) || (interval_ms < g_cascade_report_interval_ms)) {
+		return;
+	}
+	if ((cascade_gate_count > 0) && (cascade_model_count > 0)) {
+		const uint32_t model_mean_us = cascade_model_us / cascade_model_count;
+		const uint64_t interval_us = (uint64_t)interval_ms * 1000;
+		Log(kLogCascade, (int32_t)cascade_model_count, (int32_t)cascade_gate_count,
+		    (int32_t)(cascade_gate_us / cascade_gate_count), (int32_t)model_mean_us,
+		    (int32_t)((100 * (uint64_t)(cascade_gate_us + cascade_model_us)) / interval_us),
+		    (int32_t)((100 * (uint64_t)model_mean_us * cascade_gate_count) / interval_us));
+	}
+	cascade_report_time = current_time;
+	cascade_gate_count = 0;
+	cascade_model_count = 0;
+	cascade_gate_us = 0;
+	cascade_model_us = 0;
+}
+#endif
+
+#if BOOT_BENCHMARKS
+// Reports the mean invoke time on random inputs, with a warm XIP cache and with
+// the cache flushed before every invocation, where code evicted by the frontend
+// has to be fetched from flash again
+void ReportInvokeTime() {
+	constexpr int kInvocationCount = 20;
+	uint32_t random = 1;
+	uint32_t invoke_us[2] = {0, 0};
+	for (int flush_cache = 0; flush_cache < 2; flush_cache++) {
+		for (int i = 0; i < kInvocationCount; i++) {
+			for (int j = 0; j < kFeatureElementCount; j++) {
+				random = random * 1103515245 + 12345;
+				model_input_buffer[j] = static_cast<int8_t>(random >> 24);
+			}
+			if (flush_cache) {
+				// Reading the register waits for the flush to complete
+				xip_ctrl_hw->flush = 1;
+				(void)xip_ctrl_hw->flush;
+			}
+			const uint32_t start_us = time_us_32();
+			InvokeModel();
+			invoke_us[flush_cache] += time_us_32() - start_us;
+		}
+	}
+	TF_LITE_REPORT_ERROR(error_reporter,
+	                     "Invoke time: %d us, %d us with flushed XIP cache (%s, model data in %s, hot code in %s)",
+	                     (int)(invoke_us[0] / kInvocationCount), (int)(invoke_us[1] / kInvocationCount),
+	                     COMPILED_MODEL ? "compiled model" : "interpreter", MODEL_DATA_IN_RAM ? "RAM" : "flash",
+	                     HOT_CODE_IN_RAM ? "RAM" : "flash");
+
+	// Invoke time and estimated energy per inference at each clock operating point
+	if (g_clock_scaling_enabled) {
+		for (int point = 0; point < kClockOperatingPointCount; point++) {
+			SetClockOperatingPoint(static_cast<ClockOperatingPoint>(point));
+			for (int i = 0; i < kInvocationCount; i++) {
+				const uint32_t start_us = time_us_32();
+				InvokeModel();
+				RecordClockInference(time_us_32() - start_us);
+			}
+		}
+		SetClockOperatingPoint(kClockIdle);
+		ReportClockScaling();
+	}
+}
+#endif
 }  // namespace
 
-// Custom log function
-void debug_log_printf(const char* s) { printf(s); }
+// Custom log function, deferred to the log ring
+void debug_log_to_ring(const char* s) { LogText(s); }
 
 // The name of this function is important for Arduino compatibility.
 void setup() {
+	// Set the system clock before the peripherals derive their dividers from it
+	InitClockScaling();
 	// Initialize pico-sdk stdio
 	stdio_init_all();
-	// Init pico-sdk leds
-	// raspberry pico PICO_DEFAULT_LED_PIN: 25
-	// arduino rp2040 nano PICO_DEFAULT_LED_PIN: 6
-	const uint LED_PIN = 6;
-	gpio_init(LED_PIN);
-	gpio_set_dir(LED_PIN, GPIO_OUT);
-	// Custom log function
-	RegisterDebugLogCallback(debug_log_printf);
+#if USB_MICROPHONE
+	// The composite device takes the place of the USB stdio
+	InitUsbComposite();
+#endif
+	// Init pico-sdk leds, lit until the first inference
+	gpio_init(kLedPin);
+	gpio_set_dir(kLedPin, GPIO_OUT);
+	gpio_put(kLedPin, 1);
+	// Custom log function. The output waits in the log ring until a host opens
+	// the serial port, recognition does not wait for one.
+	RegisterDebugLogCallback(debug_log_to_ring);
 
 	tflite::InitializeTarget();
 
@@ -81,6 +371,25 @@ void setup() {
 	static tflite::MicroErrorReporter micro_error_reporter;
 	error_reporter = &micro_error_reporter;
 
+	// The recognition task is released by new slices, from the capture interrupt
+	// or from core 1 with the dual-core pipeline, and may take a slice stride
+	recognition_task = scheduler.AddTask("recognition", RecognitionTask, 0, kFeatureSliceStrideMs * 1000);
+	scheduler.AddTask("log", LogTask, g_log_task_period_ms * 1000, g_log_task_period_ms * 1000);
+	scheduler.SetReportInterval(g_task_report_interval_ms);
+	if (g_idle_clock_gating_enabled) {
+		EnableIdleClockGating();
+	}
+
+#if COMPILED_MODEL
+	// The model is compiled into CompiledModelInvoke(), check that it was built
+	// for the same features and categories
+	if ((g_compiled_model_input_size != kFeatureElementCount) || (g_compiled_model_output_size != kCategoryCount)) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Compiled model does not match the feature settings");
+		return;
+	}
+	model_input_buffer = compiled_model_input;
+	SetMicroFeaturesInputQuantization(g_compiled_model_input_scale, g_compiled_model_input_zero_point);
+#else
 	// Map the model into a usable data structure. This doesn't involve any
 	// copying or parsing, it's a very lightweight operation.
 	model = tflite::GetModel(g_micro_speech_model_data);
@@ -91,7 +400,31 @@ void setup() {
 		                     model->version(), TFLITE_SCHEMA_VERSION);
 		return;
 	}
+	float input_scale = 0.0f;
+	int32_t input_zero_point = 0;
+	if (!GetModelInputQuantization(model, &input_scale, &input_zero_point)) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Model input is not quantized per tensor");
+		return;
+	}
+	SetMicroFeaturesInputQuantization(input_scale, input_zero_point);
+#endif
 
+	// Start the audio capture first, so the microphone warms up, and with the
+	// dual-core pipeline the frontend initializes and fills the spectrogram
+	// window, while the model and the tensor arena are prepared. The features
+	// are quantized for the model input from the first slice on, and core 1 only
+	// reads the quantization from now on.
+#if DUAL_CORE_PIPELINE
+	// Capture and feature generation run on core 1 from now on
+	LaunchFrontendCore(error_reporter, &slice_queue, SignalRecognitionTask);
+#else
+	SetAudioSliceHandler(SignalRecognitionTask);
+	if (StartAudioCapture(error_reporter) != kTfLiteOk) {
+		return;
+	}
+#endif
+
+#if !COMPILED_MODEL
 	// Pull in only the operation implementations we need.
 	// This relies on a complete list of all the ops needed by this graph.
 	// An easier approach is to just use the AllOpsResolver, but this will
@@ -100,7 +433,15 @@ void setup() {
 	//
 	// tflite::AllOpsResolver resolver;
 	// NOLINTNEXTLINE(runtime-global-variables)
+#if PARALLEL_KERNELS
+	// The convolution and the fully connected layer run on both cores
+	static ParallelOpResolver<4> micro_op_resolver(error_reporter, STREAMING_INFERENCE);
+#elif STREAMING_INFERENCE
+	// The convolution only computes the rows over new feature slices
+	static StreamingOpResolver<4> micro_op_resolver(error_reporter);
+#else
 	static tflite::MicroMutableOpResolver<4> micro_op_resolver(error_reporter);
+#endif
 	if (micro_op_resolver.AddDepthwiseConv2D() != kTfLiteOk) {
 		return;
 	}
@@ -114,9 +455,27 @@ void setup() {
 		return;
 	}
 
+#if MICRO_PROFILER == 1
+	// Record the ticks of every operator invocation
+	static tflite::MicroProfiler static_profiler;
+	profiler = &static_profiler;
+#elif MICRO_PROFILER == 2
+	// Keep statistics of the operator ticks
+	static StatsProfiler static_profiler;
+	stats_profiler = &static_profiler;
+	profiler = &static_profiler;
+#endif
+
 	// Build an interpreter to run the model with.
+#if CASCADE_GATE
+	// The gate model is allocated from the same arena (model_arena_size.h covers both)
+	tflite::MicroAllocator* allocator = tflite::MicroAllocator::Create(tensor_arena, kTensorArenaSize, error_reporter);
+	static tflite::MicroInterpreter static_interpreter(model, micro_op_resolver, allocator, error_reporter, nullptr,
+	                                                   profiler);
+#else
 	static tflite::MicroInterpreter static_interpreter(model, micro_op_resolver, tensor_arena, kTensorArenaSize,
-	                                                   error_reporter);
+	                                                   error_reporter, nullptr, profiler);
+#endif
 	interpreter = &static_interpreter;
 
 	// Allocate memory from the tensor_arena for the model's tensors.
@@ -135,32 +494,122 @@ void setup() {
 	}
 	model_input_buffer = model_input->data.int8;
 
+	// The recognizer is fed the raw output scores, so check their layout once here.
+	TfLiteTensor* model_output = interpreter->output(0);
+	if ((model_output->dims->size != 2) || (model_output->dims->data[0] != 1) ||
+	    (model_output->dims->data[1] != kCategoryCount) || (model_output->type != kTfLiteInt8)) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Bad output tensor parameters in model");
+		return;
+	}
+
+#if CASCADE_GATE
+	const tflite::Model* gate_model = tflite::GetModel(g_gate_model_data);
+	if (gate_model->version() != TFLITE_SCHEMA_VERSION) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Gate model is schema version %d not equal to supported version %d.",
+		                     gate_model->version(), TFLITE_SCHEMA_VERSION);
+		return;
+	}
+	static tflite::MicroInterpreter static_gate_interpreter(gate_model, micro_op_resolver, allocator, error_reporter);
+	gate_interpreter = &static_gate_interpreter;
+	if (gate_interpreter->AllocateTensors() != kTfLiteOk) {
+		TF_LITE_REPORT_ERROR(error_reporter, "AllocateTensors() failed for the gate model");
+		return;
+	}
+	// The gate model reads the same spectrogram window and scores silence first
+	TfLiteTensor* gate_input = gate_interpreter->input(0);
+	TfLiteTensor* gate_output = gate_interpreter->output(0);
+	if ((gate_input->bytes != kFeatureElementCount) || (gate_input->type != kTfLiteInt8) ||
+	    (gate_output->type != kTfLiteInt8)) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Bad tensor parameters in gate model");
+		return;
+	}
+	static CascadeGate static_cascade_gate(g_cascade_gate_threshold, g_cascade_hold_ms);
+	cascade_gate = &static_cascade_gate;
+	cascade_gate->SetInputQuantization(model_input->params.scale, model_input->params.zero_point,
+	                                   gate_input->params.scale, gate_input->params.zero_point);
+#endif
+#endif
+
+#if !DUAL_CORE_PIPELINE
 	// Prepare to access the audio spectrograms from a microphone or other source
 	// that will provide the inputs to the neural network.
 	// NOLINTNEXTLINE(runtime-global-variables)
 	static FeatureProvider static_feature_provider(kFeatureElementCount, feature_buffer);
 	feature_provider = &static_feature_provider;
+#endif
 
 	static RecognizeCommands static_recognizer(error_reporter, g_rec_average_window_duration_ms,
 	                                           g_rec_detection_threshold, g_rec_suppression_ms, g_rec_minimum_count);
 	recognizer = &static_recognizer;
+	if (g_command_sequences_enabled) {
+		static CommandSequenceRecognizer static_sequence_recognizer;
+		for (const CommandSequence& sequence : g_command_sequences) {
+			if (!static_sequence_recognizer.AddSequence(sequence.name, sequence.words, sequence.max_gap_ms)) {
+				TF_LITE_REPORT_ERROR(error_reporter, "Command sequence %s skipped", sequence.name);
+			}
+		}
+		sequence_recognizer = &static_sequence_recognizer;
+	}
+	if (g_early_commit_enabled) {
+		static EarlyCommitRecognizer static_early_commit(error_reporter, g_early_commit_window_ms,
+		                                                 g_early_commit_threshold, g_early_commit_confirm_ms,
+		                                                 g_rec_suppression_ms);
+		for (const EarlyCommitThreshold& threshold : g_early_commit_thresholds) {
+			static_early_commit.SetThreshold(threshold.label, threshold.threshold);
+		}
+		early_commit = &static_early_commit;
+	}
+
+	for (int i = 0; i < kCategoryCount; i++) {
+		silence_scores[i] = (i == kSilenceIndex) ? 127 : -128;
+	}
 
 	previous_time = 0;
+	TF_LITE_REPORT_ERROR(error_reporter, "Hotword recognition started");
 
-	// Wait for USB CDC serial connection
-	gpio_put(LED_PIN, 1);
-	while (!tud_cdc_connected()) {
+#if !DUAL_CORE_PIPELINE && PARALLEL_KERNELS
+	// Core 1 only computes its part of the kernels. Until it is ready the parts
+	// run one after the other on core 0.
+	LaunchForkJoinWorker();
+#endif
+#if BOOT_BENCHMARKS
+	// The benchmarks delay the first inference, the slices meanwhile queue up
+#if PARALLEL_KERNELS
+	while (!IsForkJoinWorkerReady()) {
 		tight_loop_contents();
 	}
-	gpio_put(LED_PIN, 0);
-	printf("Hotword recognition started\n");
+	ReportParallelKernelSpeedup(error_reporter, interpreter);
+#endif
+	ReportInvokeTime();
+#endif
+	setup_done_us = time_us_32();
 }
 
 // The name of this function is important for Arduino compatibility.
 void loop() {
+	// Run the released tasks, or sleep until the next one
+	scheduler.RunOnce();
+}
+
+namespace {
+// Runs the model and the recognizer on the new slices
+void RecognitionTask() {
+#if DUAL_CORE_PIPELINE
+	// Take the feature slices completed by core 1
+	int32_t current_time = previous_time;
+	const int how_many_new_slices = TakeQueuedSlices(&current_time);
+	const uint32_t inference_start_us = time_us_32();
+	previous_time = current_time;
+	ReportPipelineIfDue(current_time);
+	if (how_many_new_slices == 0) {
+		return;
+	}
+	const int speech_slice_count = window_speech_slice_count;
+#else
 	// Fetch the spectrogram for the current time.
 	const int32_t current_time = LatestAudioTimestamp();
 	int how_many_new_slices = 0;
+	const uint32_t feature_start_us = time_us_32();
 	TfLiteStatus feature_status =
 	    feature_provider->PopulateFeatureData(error_reporter, previous_time, current_time, &how_many_new_slices);
 	if (feature_status != kTfLiteOk) {
@@ -168,38 +617,167 @@ void loop() {
 		return;
 	}
 	previous_time = current_time;
+	if (how_many_new_slices > 0) {
+		const uint32_t feature_latency_us = time_us_32() - feature_start_us;
+		feature_latency_histogram[FeatureLatencyBucket(feature_latency_us)]++;
+		if (feature_latency_us > feature_latency_max_us) {
+			feature_latency_max_us = feature_latency_us;
+		}
+	}
+
+	// Report the feature slices lost or delayed by loop stalls and the
+	// feature generation time per loop
+	if ((g_feature_report_interval_ms > 0) && (current_time - feature_report_time >= g_feature_report_interval_ms)) {
+		Log(kLogFeatureSlices, (int32_t)feature_provider->dropped_slice_count(),
+		    (int32_t)feature_provider->late_slice_count(), (int32_t)feature_latency_max_us);
+		LogFeatureLatencyHistogram(feature_latency_histogram);
+		for (int i = 0; i < kFeatureLatencyBucketCount; i++) {
+			feature_latency_histogram[i] = 0;
+		}
+		feature_report_time = current_time;
+		feature_latency_max_us = 0;
+	}
 	// If no new audio samples have been received since last time, don't bother
 	// running the network model.
 	if (how_many_new_slices == 0) {
 		return;
 	}
+	const int speech_slice_count = feature_provider->speech_slice_count();
 
-	// Copy feature buffer to input tensor
-	for (int i = 0; i < kFeatureElementCount; i++) {
-		model_input_buffer[i] = feature_buffer[i];
+	// Persist the converged frontend noise estimates while nobody is talking
+	if (speech_slice_count == 0) {
+		StoreFrontendStateIfDue(error_reporter, current_time);
 	}
+#endif
 
-	// Run the model on the spectrogram input and make sure it succeeds.
-	TfLiteStatus invoke_status = interpreter->Invoke();
-	if (invoke_status != kTfLiteOk) {
-		TF_LITE_REPORT_ERROR(error_reporter, "Invoke failed");
-		return;
+	// Skip inference if the voice activity gate finds no speech-like slice in
+	// the spectrogram window, and let the recognizer average silence instead.
+	const bool run_inference = !g_vad_enabled || (speech_slice_count > 0);
+	// The inference, the gate model of the cascade included, runs at the boost
+	// clock
+	if (run_inference) {
+		SetClockOperatingPoint(kClockBoost);
+	}
+#if CASCADE_GATE
+	// The gate model runs on every window with speech, the recognition model only
+	// while the gate fires
+	const bool run_model = run_inference && CascadeGateOpen(current_time);
+	ReportCascadeIfDue(current_time);
+#else
+	const bool run_model = run_inference;
+#endif
+	const int8_t* scores = silence_scores;
+	if (run_model) {
+		// Copy feature buffer to input tensor
+		for (int i = 0; i < kFeatureElementCount; i++) {
+			model_input_buffer[i] = feature_buffer[i];
+		}
+
+		// Run the model on the spectrogram input and make sure it succeeds.
+		const uint32_t model_start_us = time_us_32();
+		const bool invoke_ok = InvokeModel();
+		const uint32_t model_us = time_us_32() - model_start_us;
+		RecordClockInference(model_us);
+		SetClockOperatingPoint(kClockIdle);
+		if (!invoke_ok) {
+			TF_LITE_REPORT_ERROR(error_reporter, "Invoke failed");
+			return;
+		}
+		if (!first_inference_done) {
+			Log(kLogFirstInference, (int32_t)(time_us_32() / 1000));
+			first_inference_done = true;
+		}
+#if CASCADE_GATE
+		cascade_model_us += model_us;
+		cascade_model_count++;
+#endif
+
+		// Print the ticks of every operator of this inference
+		if ((profiler != nullptr) && (stats_profiler == nullptr)) {
+			profiler->Log();
+			Log(kLogInferenceTicks, (int32_t)profiler->GetTotalTicks());
+			profiler->ClearEvents();
+		}
+
+		// Obtain a pointer to the output scores
+		scores = ModelScores();
+		vad_inference_count++;
+	} else {
+		SetClockOperatingPoint(kClockIdle);
+		vad_skipped_count++;
+	}
+	ReportClockScalingIfDue(current_time);
+
+	// Send the operator statistics through the log task, which does not wait for
+	// the host
+	if ((stats_profiler != nullptr) && (current_time - profiler_report_time >= g_profiler_report_interval_ms)) {
+		const int frame_size = stats_profiler->WriteFrame(profiler_frame, sizeof(profiler_frame));
+		QueueLogFrame(profiler_frame, frame_size);
+		profiler_report_time = current_time;
+	}
+
+	// Send the scores fed to the recognizer for offline tuning (host/recognizer_tuning.cpp)
+	if (g_trace_output_enabled) {
+		const int frame_size = WritePosteriorTraceFrame(current_time, scores, trace_frame);
+		QueueLogFrame(trace_frame, frame_size);
+	}
+
+	// Report the inference duty cycle of the voice activity gate
+	if (g_vad_enabled && (g_vad_report_interval_ms > 0) &&
+	    (current_time - vad_report_time >= g_vad_report_interval_ms)) {
+		const int32_t total_count = vad_inference_count + vad_skipped_count;
+		Log(kLogDutyCycle, (int32_t)((100 * vad_inference_count) / total_count), (int32_t)vad_inference_count,
+		    total_count);
+		vad_report_time = current_time;
+		vad_inference_count = 0;
+		vad_skipped_count = 0;
+	}
+
+	// Report the time from reset, when the timer starts, to the first scores
+	if (!first_window_done) {
+		gpio_put(kLedPin, 0);
+		Log(kLogBootTime, (int32_t)(setup_done_us / 1000), (int32_t)(time_us_32() / 1000));
+		first_window_done = true;
 	}
 
-	// Obtain a pointer to the output tensor
-	TfLiteTensor* output = interpreter->output(0);
 	// Determine whether a command was recognized based on the output of inference
 	const char* found_command = nullptr;
 	uint8_t score = 0;
 	bool is_new_command = false;
 	TfLiteStatus process_status =
-	    recognizer->ProcessLatestResults(output, current_time, &found_command, &score, &is_new_command);
+	    recognizer->ProcessLatestScores(scores, current_time, &found_command, &score, &is_new_command);
 	if (process_status != kTfLiteOk) {
-		TF_LITE_REPORT_ERROR(error_reporter, "RecognizeCommands::ProcessLatestResults() failed");
+		TF_LITE_REPORT_ERROR(error_reporter, "RecognizeCommands::ProcessLatestScores() failed");
 		return;
 	}
+	// Match the detections of the averaging window against the command sequences
+	const char* sequence = nullptr;
+	int32_t sequence_start_time = 0;
+	int32_t sequence_end_time = 0;
+	const bool is_sequence_end = (sequence_recognizer != nullptr) &&
+	                             sequence_recognizer->Process(current_time, found_command, is_new_command, &sequence,
+	                                                          &sequence_start_time, &sequence_end_time);
+	// Report keywords as soon as the short window commits them, the averaging
+	// window only confirms or retracts them
+	if (early_commit != nullptr) {
+		const char* early_command = nullptr;
+		uint8_t early_score = 0;
+		const EarlyCommitRecognizer::Event event = early_commit->Process(scores, current_time, found_command,
+		                                                                 is_new_command, &early_command, &early_score);
+		RespondToEarlyCommit(error_reporter, current_time, early_command, early_score, event);
+		if (event == EarlyCommitRecognizer::kConfirmed) {
+			is_new_command = false;
+		}
+	}
 	// Do something based on the recognized command. The default implementation
 	// just prints to the error console, but you should replace this with your
 	// own function for a real application.
 	RespondToCommand(error_reporter, current_time, found_command, score, is_new_command);
+	if (is_sequence_end) {
+		RespondToCommandSequence(error_reporter, sequence, sequence_start_time, sequence_end_time);
+	}
+#if DUAL_CORE_PIPELINE
+	inference_busy_us += time_us_32() - inference_start_us;
+#endif
 }
+}  // namespace
@@ -20,12 +20,27 @@ limitations under the License.
 
 #include "tensorflow/lite/experimental/microfrontend/lib/frontend.h"
 #include "tensorflow/lite/experimental/microfrontend/lib/frontend_util.h"
+#include "config.h"
 #include "micro_features/micro_model_settings.h"
 
 namespace {
 
 FrontendState g_micro_features_state;
+bool g_is_initialized = false;
 bool g_is_first_time = true;
+int g_last_active_channels = 0;
+
+#if MFCC_COEFFICIENTS > 0
+// DCT-II basis in Q15, scaled by sqrt(2 / kFeatureChannelCount) like
+// tf.signal.mfccs_from_log_mel_spectrograms(). Must match the table used by
+// scripts/training/micro_mfcc.py.
+int16_t g_dct_table[kFeatureSliceSize][kFeatureChannelCount];
+// Maps a Q15 coefficient in frontend units to the model input, see
+// SetMicroFeaturesInputQuantization().
+constexpr int kMfccMultiplierShift = 40;
+int64_t g_mfcc_multiplier = 0;
+int32_t g_mfcc_zero_point = 0;
+#endif
 
 }  // namespace
 
@@ -35,7 +50,7 @@ TfLiteStatus InitializeMicroFeatures(tflite::ErrorReporter* error_reporter) {
   // config.window.size_ms = kFeatureSliceDurationMs;
   // config.window.step_size_ms = kFeatureSliceStrideMs;
   // config.noise_reduction.smoothing_bits = 10;
-  // config.filterbank.num_channels = kFeatureSliceSize;
+  // config.filterbank.num_channels = kFeatureChannelCount;
   // config.filterbank.lower_band_limit = 125.0;
   // config.filterbank.upper_band_limit = 7500.0;
   // config.noise_reduction.smoothing_bits = 10;
@@ -54,7 +69,7 @@ TfLiteStatus InitializeMicroFeatures(tflite::ErrorReporter* error_reporter) {
   // https://github.com/tensorflow/tensorflow/blob/master/tensorflow/lite/experimental/microfrontend/ops/audio_microfrontend_op.cc
   config.window.size_ms = kFeatureSliceDurationMs;
   config.window.step_size_ms = kFeatureSliceStrideMs;
-  config.filterbank.num_channels = kFeatureSliceSize;
+  config.filterbank.num_channels = kFeatureChannelCount;
   config.filterbank.lower_band_limit = 125.0;
   config.filterbank.upper_band_limit = 7500.0;
   config.noise_reduction.smoothing_bits = 10;
@@ -68,23 +83,77 @@ TfLiteStatus InitializeMicroFeatures(tflite::ErrorReporter* error_reporter) {
   config.log_scale.enable_log = 1;
   config.log_scale.scale_shift = 6;
 
+  // Release the buffers of a previous initialization before starting over
+  if (g_is_initialized) {
+    FrontendFreeStateContents(&g_micro_features_state);
+    g_is_initialized = false;
+  }
   if (!FrontendPopulateState(&config, &g_micro_features_state,
                              kAudioSampleFrequency)) {
     TF_LITE_REPORT_ERROR(error_reporter, "FrontendPopulateState() failed");
     return kTfLiteError;
   }
+  g_is_initialized = true;
   g_is_first_time = true;
+
+#if MFCC_COEFFICIENTS > 0
+  const double pi = 3.14159265358979323846;
+  const double norm = sqrt(2.0 / kFeatureChannelCount);
+  for (int k = 0; k < kFeatureSliceSize; ++k) {
+    for (int n = 0; n < kFeatureChannelCount; ++n) {
+      const double basis =
+          norm * cos(pi * k * (n + 0.5) / kFeatureChannelCount);
+      g_dct_table[k][n] = static_cast<int16_t>(floor(basis * 32768.0 + 0.5));
+    }
+  }
+#endif
+
+  // Warm start from the noise estimates persisted by a previous run, if any,
+  // instead of waiting seconds for them to converge again. PCAN uses the same
+  // estimates, so this restores all adaptive state of the frontend.
+  uint32_t estimates[kFeatureChannelCount];
+  if (LoadMicroFeaturesNoiseEstimates(estimates, kFeatureChannelCount)) {
+    SetMicroFeaturesNoiseEstimates(estimates);
+    TF_LITE_REPORT_ERROR(error_reporter, "Restored frontend noise estimates");
+  }
   return kTfLiteOk;
 }
 
-// This is not exposed in any header, and is only used for testing, to ensure
-// that the state is correctly set up before generating results.
 void SetMicroFeaturesNoiseEstimates(const uint32_t* estimate_presets) {
   for (int i = 0; i < g_micro_features_state.filterbank.num_channels; ++i) {
     g_micro_features_state.noise_reduction.estimate[i] = estimate_presets[i];
   }
 }
 
+void SetMicroFeaturesInputQuantization(float scale, int32_t zero_point) {
+#if MFCC_COEFFICIENTS > 0
+  // Training divides the frontend output by 25.6 (see GenerateMicroFeatures()),
+  // so a Q15 coefficient in frontend units becomes:
+  // input = coefficient / (32768 * 25.6 * scale) + zero_point
+  const double multiplier =
+      static_cast<double>(1LL << kMfccMultiplierShift) /
+      (32768.0 * 25.6 * scale);
+  g_mfcc_multiplier = static_cast<int64_t>(multiplier + 0.5);
+  g_mfcc_zero_point = zero_point;
+#endif
+}
+
+int8_t GetMicroFeaturesSilenceValue() {
+#if MFCC_COEFFICIENTS > 0
+  return g_mfcc_zero_point;
+#else
+  // A zero frontend output maps to the lowest input value, see
+  // GenerateMicroFeatures().
+  return -128;
+#endif
+}
+
+void GetMicroFeaturesNoiseEstimates(uint32_t* estimates) {
+  for (int i = 0; i < g_micro_features_state.filterbank.num_channels; ++i) {
+    estimates[i] = g_micro_features_state.noise_reduction.estimate[i];
+  }
+}
+
 TfLiteStatus GenerateMicroFeatures(tflite::ErrorReporter* error_reporter,
                                    const int16_t* input, int input_size,
                                    int output_size, int8_t* output,
@@ -99,6 +168,41 @@ TfLiteStatus GenerateMicroFeatures(tflite::ErrorReporter* error_reporter,
   FrontendOutput frontend_output = FrontendProcessSamples(
       &g_micro_features_state, frontend_input, input_size, num_samples_read);
 
+  // The frontend output is the log of the channel energy after the noise
+  // reduction estimate has been subtracted and PCAN has normalized it against
+  // that estimate, so stationary background noise ends up close to zero. A
+  // channel is counted as active if it still rises clearly above that floor.
+  g_last_active_channels = 0;
+  for (size_t i = 0; i < frontend_output.size; ++i) {
+    if (frontend_output.values[i] > g_vad_channel_threshold) {
+      ++g_last_active_channels;
+    }
+  }
+
+#if MFCC_COEFFICIENTS > 0
+  if (frontend_output.size == kFeatureChannelCount) {
+    for (int k = 0; k < kFeatureSliceSize; ++k) {
+      // At most 40 * 670 * 7327, which fits into 32 bits
+      int32_t coefficient = 0;
+      for (int n = 0; n < kFeatureChannelCount; ++n) {
+        coefficient += frontend_output.values[n] * g_dct_table[k][n];
+      }
+      const int64_t scaled =
+          static_cast<int64_t>(coefficient) * g_mfcc_multiplier;
+      const int64_t rounding = 1LL << (kMfccMultiplierShift - 1);
+      int32_t value = static_cast<int32_t>(
+          (scaled + rounding) >> kMfccMultiplierShift);
+      value += g_mfcc_zero_point;
+      if (value < -128) {
+        value = -128;
+      }
+      if (value > 127) {
+        value = 127;
+      }
+      output[k] = value;
+    }
+  }
+#else
   for (size_t i = 0; i < frontend_output.size; ++i) {
     // These scaling values are derived from those used in input_data.py in the
     // training pipeline.
@@ -129,6 +233,9 @@ TfLiteStatus GenerateMicroFeatures(tflite::ErrorReporter* error_reporter,
     }
     output[i] = value;
   }
+#endif
 
   return kTfLiteOk;
 }
+
+int GetMicroFeaturesActiveChannels() { return g_last_active_channels; }
@@ -29,4 +29,29 @@ TfLiteStatus GenerateMicroFeatures(tflite::ErrorReporter* error_reporter,
                                    int output_size, int8_t* output,
                                    size_t* num_samples_read);
 
+// Sets the quantization of the model input tensor. Only used with
+// MFCC_COEFFICIENTS, the log-mel features use the fixed mapping of the
+// reference model. Call before the features are generated, it is not
+// synchronized with core 1 of the dual-core pipeline.
+void SetMicroFeaturesInputQuantization(float scale, int32_t zero_point);
+
+// Returns the model input value of a feature slice without any signal left
+// after noise reduction, used to fill slices that are skipped.
+int8_t GetMicroFeaturesSilenceValue();
+
+// Sets and gets the per-channel noise estimates of the frontend, which are
+// shared by the noise reduction and PCAN stages. Both arrays hold
+// kFeatureChannelCount values.
+void SetMicroFeaturesNoiseEstimates(const uint32_t* estimate_presets);
+void GetMicroFeaturesNoiseEstimates(uint32_t* estimates);
+
+// Loads noise estimates persisted by a previous run. Called by
+// InitializeMicroFeatures() and implemented per platform. Returns false if
+// there are no valid estimates for channel_count channels.
+bool LoadMicroFeaturesNoiseEstimates(uint32_t* estimates, int channel_count);
+
+// Returns how many channels of the most recently generated slice rose above the
+// noise floor tracked by the frontend. Used as a cheap voice activity measure.
+int GetMicroFeaturesActiveChannels();
+
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_MICRO_FEATURES_MICRO_FEATURES_GENERATOR_H_
@@ -27,7 +27,18 @@ constexpr int kAudioSampleFrequency = 16000;
 
 // The following values are derived from values used during model training.
 // If you change the way you preprocess the input, update all these constants.
-constexpr int kFeatureSliceSize = 40;
+// The frontend computes kFeatureChannelCount mel filterbank channels per slice.
+// With MFCC_COEFFICIENTS set, a DCT compresses them into that many cepstral
+// coefficients, which the model then consumes instead of the channels.
+#ifndef MFCC_COEFFICIENTS
+#define MFCC_COEFFICIENTS 0
+#endif
+constexpr int kFeatureChannelCount = 40;
+#if MFCC_COEFFICIENTS > 0
+constexpr int kFeatureSliceSize = MFCC_COEFFICIENTS;
+#else
+constexpr int kFeatureSliceSize = kFeatureChannelCount;
+#endif
 constexpr int kFeatureSliceCount = 49;
 constexpr int kFeatureElementCount = (kFeatureSliceSize * kFeatureSliceCount);
 constexpr int kFeatureSliceStrideMs = 20;
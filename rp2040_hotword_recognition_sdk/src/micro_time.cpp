@@ -0,0 +1,16 @@
+// Tensorflow Lite Micro time source for the RP2040, replacing
+// tensorflow/lite/micro/cortex_m_generic/micro_time.cpp. The Cortex-M0+ has no
+// DWT cycle counter, so the ticks are read from the 1 MHz system timer instead.
+
+#include "tensorflow/lite/micro/micro_time.h"
+// Pico-sdk
+#include "hardware/timer.h"
+
+namespace tflite {
+
+int32_t ticks_per_second() { return 1000000; }
+
+// Wraps around after about 71 minutes, tick differences stay valid
+int32_t GetCurrentTimeTicks() { return static_cast<int32_t>(time_us_32()); }
+
+}  // namespace tflite
@@ -0,0 +1,437 @@
+#include "parallel_kernels.h"
+
+#include <algorithm>
+
+#include "CMSIS/NN/Include/arm_nnfunctions.h"
+#include "fork_join.h"
+#include "streaming_depthwise_conv.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/depthwise_conv.h"
+#include "tensorflow/lite/micro/kernels/fully_connected.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_time.h"
+
+namespace {
+
+// Timed layers, the included models have one of each
+enum ParallelLayer { kDepthwiseConvLayer, kFullyConnectedLayer, kParallelLayerCount };
+const char* const kParallelLayerNames[kParallelLayerCount] = {"DEPTHWISE_CONV_2D", "FULLY_CONNECTED"};
+TfLiteStatus (*layer_invokes[kParallelLayerCount])(TfLiteContext*, TfLiteNode*) = {nullptr, nullptr};
+uint32_t layer_ticks[kParallelLayerCount] = {0};
+
+template <int tLayer>
+TfLiteStatus TimedInvoke(TfLiteContext* context, TfLiteNode* node) {
+	const int32_t start = tflite::GetCurrentTimeTicks();
+	const TfLiteStatus status = layer_invokes[tLayer](context, node);
+	layer_ticks[tLayer] += tflite::GetCurrentTimeTicks() - start;
+	return status;
+}
+
+// Requests one CMSIS-NN scratch buffer per core, indices are -1 if not needed
+TfLiteStatus RequestScratchBuffers(TfLiteContext* context, int32_t buf_size, int* buffer_indices) {
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		buffer_indices[part] = -1;
+		if (buf_size > 0) {
+			TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(context, buf_size, &buffer_indices[part]));
+		}
+	}
+	return kTfLiteOk;
+}
+
+// Returns the first of the items assigned to the given core
+int PartBegin(int item_count, int part) { return (item_count * part) / kForkJoinPartCount; }
+
+//
+// Depthwise convolution
+//
+
+struct DepthwiseConvOpData {
+	tflite::OpDataConv reference_op_data;
+	int buffer_indices[kForkJoinPartCount];
+};
+
+void* DepthwiseConvInit(TfLiteContext* context, const char* buffer, size_t length) {
+	TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+	return context->AllocatePersistentBuffer(context, sizeof(DepthwiseConvOpData));
+}
+
+TfLiteStatus DepthwiseConvPrepare(TfLiteContext* context, TfLiteNode* node) {
+	TFLITE_DCHECK(node->user_data != nullptr);
+	TFLITE_DCHECK(node->builtin_data != nullptr);
+
+	DepthwiseConvOpData* data = static_cast<DepthwiseConvOpData*>(node->user_data);
+	const auto& params = *(static_cast<const TfLiteDepthwiseConvParams*>(node->builtin_data));
+	tflite::MicroContext* micro_context = tflite::GetMicroContext(context);
+
+	TfLiteTensor* input = micro_context->AllocateTempInputTensor(node, tflite::kDepthwiseConvInputTensor);
+	TF_LITE_ENSURE(context, input != nullptr);
+	TfLiteTensor* filter = micro_context->AllocateTempInputTensor(node, tflite::kDepthwiseConvWeightsTensor);
+	TF_LITE_ENSURE(context, filter != nullptr);
+	TfLiteTensor* output = micro_context->AllocateTempOutputTensor(node, tflite::kDepthwiseConvOutputTensor);
+	TF_LITE_ENSURE(context, output != nullptr);
+	// The row split assumes undilated int8 rows of a single batch
+	TF_LITE_ENSURE_EQ(context, input->type, kTfLiteInt8);
+	TF_LITE_ENSURE_EQ(context, params.dilation_height_factor, 1);
+	TF_LITE_ENSURE_EQ(context, tflite::SizeOfDimension(input, 0), 1);
+
+	const int input_height = tflite::SizeOfDimension(input, 1);
+	const int input_width = tflite::SizeOfDimension(input, 2);
+	const int filter_height = tflite::SizeOfDimension(filter, 1);
+	const int filter_width = tflite::SizeOfDimension(filter, 2);
+	const int output_height = tflite::SizeOfDimension(output, 1);
+	const int output_width = tflite::SizeOfDimension(output, 2);
+	const int output_depth = tflite::SizeOfDimension(output, 3);
+
+	const int num_channels = filter->dims->data[tflite::kDepthwiseConvQuantizedDimension];
+	data->reference_op_data.per_channel_output_multiplier =
+	    static_cast<int32_t*>(context->AllocatePersistentBuffer(context, num_channels * sizeof(int32_t)));
+	data->reference_op_data.per_channel_output_shift =
+	    static_cast<int32_t*>(context->AllocatePersistentBuffer(context, num_channels * sizeof(int32_t)));
+	TF_LITE_ENSURE_STATUS(tflite::CalculateOpDataDepthwiseConv(context, node, params, input_width, input_height,
+	                                                           filter_width, filter_height, output_width,
+	                                                           output_height, input->type, &data->reference_op_data));
+
+	cmsis_nn_dims input_dims = {1, input_height, input_width, tflite::SizeOfDimension(input, 3)};
+	cmsis_nn_dims filter_dims = {1, filter_height, filter_width, output_depth};
+	cmsis_nn_dims output_dims = {1, output_height, output_width, output_depth};
+	cmsis_nn_dw_conv_params dw_conv_params;
+	dw_conv_params.padding.h = data->reference_op_data.padding.height;
+	dw_conv_params.padding.w = data->reference_op_data.padding.width;
+	dw_conv_params.dilation.h = params.dilation_height_factor;
+	dw_conv_params.dilation.w = params.dilation_width_factor;
+	TF_LITE_ENSURE_STATUS(RequestScratchBuffers(
+	    context, arm_depthwise_conv_wrapper_s8_get_buffer_size(&dw_conv_params, &input_dims, &filter_dims, &output_dims),
+	    data->buffer_indices));
+
+	micro_context->DeallocateTempTfLiteTensor(output);
+	micro_context->DeallocateTempTfLiteTensor(input);
+	micro_context->DeallocateTempTfLiteTensor(filter);
+	return kTfLiteOk;
+}
+
+struct DepthwiseConvJob {
+	const cmsis_nn_dw_conv_params* dw_conv_params;
+	const cmsis_nn_per_channel_quant_params* quant_params;
+	const cmsis_nn_dims* input_dims;
+	const cmsis_nn_dims* filter_dims;
+	const cmsis_nn_dims* bias_dims;
+	const cmsis_nn_dims* output_dims;
+	const int8_t* input_data;
+	const int8_t* filter_data;
+	const int32_t* bias_data;
+	int8_t* output_data;
+	cmsis_nn_context contexts[kForkJoinPartCount];
+	arm_status status[kForkJoinPartCount];
+};
+
+// Computes the output rows of one core from the input rows they read, clipped
+// to the input and padded above by the rows cut off
+void ComputeDepthwiseConvPart(void* arg, int part) {
+	DepthwiseConvJob& job = *static_cast<DepthwiseConvJob*>(arg);
+	const int output_begin = PartBegin(job.output_dims->h, part);
+	const int output_end = PartBegin(job.output_dims->h, part + 1);
+	job.status[part] = ARM_MATH_SUCCESS;
+	if (output_begin == output_end) {
+		return;
+	}
+	const int stride = job.dw_conv_params->stride.h;
+	const int first_input_row = output_begin * stride - job.dw_conv_params->padding.h;
+	const int input_start = std::max(first_input_row, 0);
+	const int input_end = std::min((output_end - 1) * stride - job.dw_conv_params->padding.h + job.filter_dims->h,
+	                               job.input_dims->h);
+	const int input_row_size = job.input_dims->w * job.input_dims->c;
+	const int output_row_size = job.output_dims->w * job.output_dims->c;
+
+	cmsis_nn_dw_conv_params dw_conv_params = *job.dw_conv_params;
+	dw_conv_params.padding.h = input_start - first_input_row;
+	cmsis_nn_dims input_dims = *job.input_dims;
+	input_dims.h = input_end - input_start;
+	cmsis_nn_dims output_dims = *job.output_dims;
+	output_dims.h = output_end - output_begin;
+	job.status[part] = arm_depthwise_conv_wrapper_s8(
+	    &job.contexts[part], &dw_conv_params, job.quant_params, &input_dims, job.input_data + input_start * input_row_size,
+	    job.filter_dims, job.filter_data, job.bias_dims, job.bias_data, &output_dims,
+	    job.output_data + output_begin * output_row_size);
+}
+
+TfLiteStatus DepthwiseConvEval(TfLiteContext* context, TfLiteNode* node) {
+	TFLITE_DCHECK(node->user_data != nullptr);
+	TFLITE_DCHECK(node->builtin_data != nullptr);
+
+	const auto& params = *(static_cast<const TfLiteDepthwiseConvParams*>(node->builtin_data));
+	const DepthwiseConvOpData& data = *(static_cast<const DepthwiseConvOpData*>(node->user_data));
+	TfLiteEvalTensor* output = tflite::micro::GetEvalOutput(context, node, tflite::kDepthwiseConvOutputTensor);
+	const TfLiteEvalTensor* input = tflite::micro::GetEvalInput(context, node, tflite::kDepthwiseConvInputTensor);
+	const TfLiteEvalTensor* filter = tflite::micro::GetEvalInput(context, node, tflite::kDepthwiseConvWeightsTensor);
+	const TfLiteEvalTensor* bias =
+	    (tflite::NumInputs(node) == 3) ? tflite::micro::GetEvalInput(context, node, tflite::kDepthwiseConvBiasTensor)
+	                                   : nullptr;
+
+	const tflite::RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+	const tflite::RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+	const tflite::RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+
+	cmsis_nn_dw_conv_params dw_conv_params;
+	dw_conv_params.dilation.h = params.dilation_height_factor;
+	dw_conv_params.dilation.w = params.dilation_width_factor;
+	dw_conv_params.input_offset = -data.reference_op_data.input_zero_point;
+	dw_conv_params.output_offset = data.reference_op_data.output_zero_point;
+	dw_conv_params.stride.h = params.stride_height;
+	dw_conv_params.stride.w = params.stride_width;
+	dw_conv_params.padding.h = data.reference_op_data.padding.height;
+	dw_conv_params.padding.w = data.reference_op_data.padding.width;
+	dw_conv_params.activation.min = data.reference_op_data.output_activation_min;
+	dw_conv_params.activation.max = data.reference_op_data.output_activation_max;
+	dw_conv_params.ch_mult = params.depth_multiplier;
+
+	cmsis_nn_per_channel_quant_params quant_params;
+	quant_params.multiplier = data.reference_op_data.per_channel_output_multiplier;
+	quant_params.shift = data.reference_op_data.per_channel_output_shift;
+
+	const cmsis_nn_dims input_dims = {1, input_shape.Dims(1), input_shape.Dims(2), input_shape.Dims(3)};
+	const cmsis_nn_dims filter_dims = {filter_shape.Dims(0), filter_shape.Dims(1), filter_shape.Dims(2),
+	                                   output_shape.Dims(3)};
+	const cmsis_nn_dims bias_dims = {1, 1, 1, output_shape.Dims(3)};
+	const cmsis_nn_dims output_dims = {1, output_shape.Dims(1), output_shape.Dims(2), output_shape.Dims(3)};
+
+	DepthwiseConvJob job;
+	job.dw_conv_params = &dw_conv_params;
+	job.quant_params = &quant_params;
+	job.input_dims = &input_dims;
+	job.filter_dims = &filter_dims;
+	job.bias_dims = &bias_dims;
+	job.output_dims = &output_dims;
+	job.input_data = tflite::micro::GetTensorData<int8_t>(input);
+	job.filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+	job.bias_data = tflite::micro::GetTensorData<int32_t>(bias);
+	job.output_data = tflite::micro::GetTensorData<int8_t>(output);
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		job.contexts[part].buf =
+		    (data.buffer_indices[part] > -1) ? context->GetScratchBuffer(context, data.buffer_indices[part]) : nullptr;
+		job.contexts[part].size = 0;
+	}
+	ForkJoin(ComputeDepthwiseConvPart, &job);
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		TF_LITE_ENSURE_EQ(context, job.status[part], ARM_MATH_SUCCESS);
+	}
+	return kTfLiteOk;
+}
+
+//
+// Fully connected
+//
+
+struct FullyConnectedOpData {
+	tflite::OpDataFullyConnected reference_op_data;
+	int buffer_indices[kForkJoinPartCount];
+};
+
+void* FullyConnectedInit(TfLiteContext* context, const char* buffer, size_t length) {
+	TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+	return context->AllocatePersistentBuffer(context, sizeof(FullyConnectedOpData));
+}
+
+TfLiteStatus FullyConnectedPrepare(TfLiteContext* context, TfLiteNode* node) {
+	TFLITE_DCHECK(node->user_data != nullptr);
+	TFLITE_DCHECK(node->builtin_data != nullptr);
+
+	FullyConnectedOpData* data = static_cast<FullyConnectedOpData*>(node->user_data);
+	const auto* params = static_cast<const TfLiteFullyConnectedParams*>(node->builtin_data);
+	tflite::MicroContext* micro_context = tflite::GetMicroContext(context);
+
+	TfLiteTensor* input = micro_context->AllocateTempInputTensor(node, tflite::kFullyConnectedInputTensor);
+	TF_LITE_ENSURE(context, input != nullptr);
+	TfLiteTensor* filter = micro_context->AllocateTempInputTensor(node, tflite::kFullyConnectedWeightsTensor);
+	TF_LITE_ENSURE(context, filter != nullptr);
+	TfLiteTensor* bias = micro_context->AllocateTempInputTensor(node, tflite::kFullyConnectedBiasTensor);
+	TfLiteTensor* output = micro_context->AllocateTempOutputTensor(node, tflite::kFullyConnectedOutputTensor);
+	TF_LITE_ENSURE(context, output != nullptr);
+	TF_LITE_ENSURE_EQ(context, input->type, kTfLiteInt8);
+	TF_LITE_ENSURE_TYPES_EQ(context, input->type, output->type);
+	TF_LITE_ENSURE_TYPES_EQ(context, input->type, filter->type);
+
+	TF_LITE_ENSURE_STATUS(tflite::CalculateOpDataFullyConnected(context, params->activation, input->type, input,
+	                                                            filter, bias, output, &data->reference_op_data));
+
+	const tflite::RuntimeShape filter_shape = tflite::GetTensorShape(filter);
+	const tflite::RuntimeShape output_shape = tflite::GetTensorShape(output);
+	cmsis_nn_dims filter_dims = {filter_shape.Dims(filter_shape.DimensionsCount() - 1), 1, 1,
+	                             output_shape.Dims(output_shape.DimensionsCount() - 1)};
+	TF_LITE_ENSURE_STATUS(
+	    RequestScratchBuffers(context, arm_fully_connected_s8_get_buffer_size(&filter_dims), data->buffer_indices));
+
+	micro_context->DeallocateTempTfLiteTensor(output);
+	micro_context->DeallocateTempTfLiteTensor(input);
+	micro_context->DeallocateTempTfLiteTensor(filter);
+	if (bias != nullptr) {
+		micro_context->DeallocateTempTfLiteTensor(bias);
+	}
+	return kTfLiteOk;
+}
+
+struct FullyConnectedJob {
+	const cmsis_nn_fc_params* fc_params;
+	const cmsis_nn_per_tensor_quant_params* quant_params;
+	int batches;
+	int accum_depth;
+	int output_depth;
+	const int8_t* input_data;
+	const int8_t* filter_data;
+	const int32_t* bias_data;
+	int8_t* output_data;
+	cmsis_nn_context contexts[kForkJoinPartCount];
+	arm_status status[kForkJoinPartCount];
+};
+
+// Computes the output units of one core, whose weights are consecutive rows of
+// the filter
+void ComputeFullyConnectedPart(void* arg, int part) {
+	FullyConnectedJob& job = *static_cast<FullyConnectedJob*>(arg);
+	const int unit_begin = PartBegin(job.output_depth, part);
+	const int unit_count = PartBegin(job.output_depth, part + 1) - unit_begin;
+	job.status[part] = ARM_MATH_SUCCESS;
+	if (unit_count == 0) {
+		return;
+	}
+	const cmsis_nn_dims input_dims = {1, 1, 1, job.accum_depth};
+	const cmsis_nn_dims filter_dims = {job.accum_depth, 1, 1, unit_count};
+	const cmsis_nn_dims bias_dims = {1, 1, 1, unit_count};
+	const cmsis_nn_dims output_dims = {1, 1, 1, unit_count};
+	const int32_t* bias_data = (job.bias_data != nullptr) ? job.bias_data + unit_begin : nullptr;
+	for (int batch = 0; (batch < job.batches) && (job.status[part] == ARM_MATH_SUCCESS); batch++) {
+		job.status[part] = arm_fully_connected_s8(
+		    &job.contexts[part], job.fc_params, job.quant_params, &input_dims, job.input_data + batch * job.accum_depth,
+		    &filter_dims, job.filter_data + unit_begin * job.accum_depth, &bias_dims, bias_data, &output_dims,
+		    job.output_data + batch * job.output_depth + unit_begin);
+	}
+}
+
+TfLiteStatus FullyConnectedEval(TfLiteContext* context, TfLiteNode* node) {
+	TFLITE_DCHECK(node->user_data != nullptr);
+
+	const FullyConnectedOpData& data = *(static_cast<const FullyConnectedOpData*>(node->user_data));
+	const TfLiteEvalTensor* input = tflite::micro::GetEvalInput(context, node, tflite::kFullyConnectedInputTensor);
+	const TfLiteEvalTensor* filter = tflite::micro::GetEvalInput(context, node, tflite::kFullyConnectedWeightsTensor);
+	const TfLiteEvalTensor* bias = tflite::micro::GetEvalInput(context, node, tflite::kFullyConnectedBiasTensor);
+	TfLiteEvalTensor* output = tflite::micro::GetEvalOutput(context, node, tflite::kFullyConnectedOutputTensor);
+
+	const tflite::RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+	const tflite::RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+	const int output_dim_count = output_shape.DimensionsCount();
+
+	cmsis_nn_fc_params fc_params;
+	fc_params.input_offset = -data.reference_op_data.input_zero_point;
+	fc_params.output_offset = data.reference_op_data.output_zero_point;
+	fc_params.filter_offset = 0;
+	fc_params.activation.min = data.reference_op_data.output_activation_min;
+	fc_params.activation.max = data.reference_op_data.output_activation_max;
+
+	cmsis_nn_per_tensor_quant_params quant_params;
+	quant_params.multiplier = data.reference_op_data.output_multiplier;
+	quant_params.shift = data.reference_op_data.output_shift;
+
+	FullyConnectedJob job;
+	job.fc_params = &fc_params;
+	job.quant_params = &quant_params;
+	job.batches = tflite::FlatSizeSkipDim(output_shape, output_dim_count - 1);
+	job.accum_depth = filter_shape.Dims(filter_shape.DimensionsCount() - 1);
+	job.output_depth = output_shape.Dims(output_dim_count - 1);
+	job.input_data = tflite::micro::GetTensorData<int8_t>(input);
+	job.filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+	job.bias_data = (bias != nullptr) ? tflite::micro::GetTensorData<int32_t>(bias) : nullptr;
+	job.output_data = tflite::micro::GetTensorData<int8_t>(output);
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		job.contexts[part].buf =
+		    (data.buffer_indices[part] > -1) ? context->GetScratchBuffer(context, data.buffer_indices[part]) : nullptr;
+		job.contexts[part].size = 0;
+	}
+	ForkJoin(ComputeFullyConnectedPart, &job);
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		TF_LITE_ENSURE_EQ(context, job.status[part], ARM_MATH_SUCCESS);
+	}
+	return kTfLiteOk;
+}
+
+void EmptyPart(void* arg, int part) {}
+
+}  // namespace
+
+TfLiteRegistration Register_PARALLEL_DEPTHWISE_CONV_2D(bool streaming) {
+	TfLiteRegistration registration;
+	if (streaming) {
+		registration = Register_STREAMING_DEPTHWISE_CONV_2D();
+	} else {
+		registration = {/*init=*/DepthwiseConvInit,
+		                /*free=*/nullptr,
+		                /*prepare=*/DepthwiseConvPrepare,
+		                /*invoke=*/DepthwiseConvEval,
+		                /*profiling_string=*/nullptr,
+		                /*builtin_code=*/0,
+		                /*custom_name=*/nullptr,
+		                /*version=*/0};
+	}
+	layer_invokes[kDepthwiseConvLayer] = registration.invoke;
+	registration.invoke = TimedInvoke<kDepthwiseConvLayer>;
+	return registration;
+}
+
+TfLiteRegistration Register_PARALLEL_FULLY_CONNECTED() {
+	layer_invokes[kFullyConnectedLayer] = FullyConnectedEval;
+	return {/*init=*/FullyConnectedInit,
+	        /*free=*/nullptr,
+	        /*prepare=*/FullyConnectedPrepare,
+	        /*invoke=*/TimedInvoke<kFullyConnectedLayer>,
+	        /*profiling_string=*/nullptr,
+	        /*builtin_code=*/0,
+	        /*custom_name=*/nullptr,
+	        /*version=*/0};
+}
+
+void ReportParallelKernelSpeedup(tflite::ErrorReporter* error_reporter, tflite::MicroInterpreter* interpreter) {
+	constexpr int kInvocationCount = 10;
+	constexpr int kForkJoinCount = 1000;
+	TfLiteTensor* input = interpreter->input(0);
+	uint32_t random = 1;
+
+	// Layer ticks per invocation with both parts on core 0 and split across the cores
+	uint32_t single_core_ticks[kParallelLayerCount];
+	uint32_t dual_core_ticks[kParallelLayerCount];
+	for (int dual_core = 0; dual_core < 2; dual_core++) {
+		SetForkJoinEnabled(dual_core);
+		for (int layer = 0; layer < kParallelLayerCount; layer++) {
+			layer_ticks[layer] = 0;
+		}
+		for (int i = 0; i < kInvocationCount; i++) {
+			for (size_t j = 0; j < input->bytes; j++) {
+				random = random * 1103515245 + 12345;
+				input->data.int8[j] = static_cast<int8_t>(random >> 24);
+			}
+			if (interpreter->Invoke() != kTfLiteOk) {
+				TF_LITE_REPORT_ERROR(error_reporter, "Invoke failed");
+				SetForkJoinEnabled(true);
+				return;
+			}
+		}
+		for (int layer = 0; layer < kParallelLayerCount; layer++) {
+			(dual_core ? dual_core_ticks : single_core_ticks)[layer] = layer_ticks[layer] / kInvocationCount;
+		}
+	}
+
+	// Round trip of a job without work
+	const int32_t start = tflite::GetCurrentTimeTicks();
+	for (int i = 0; i < kForkJoinCount; i++) {
+		ForkJoin(EmptyPart, nullptr);
+	}
+	const int32_t fork_join_ticks = tflite::GetCurrentTimeTicks() - start;
+
+	for (int layer = 0; layer < kParallelLayerCount; layer++) {
+		TF_LITE_REPORT_ERROR(error_reporter, "Parallel %s: %d us on one core, %d us on two cores, speedup %d.%02d",
+		                     kParallelLayerNames[layer], (int)single_core_ticks[layer], (int)dual_core_ticks[layer],
+		                     (int)(single_core_ticks[layer] / std::max(dual_core_ticks[layer], (uint32_t)1)),
+		                     (int)((100 * single_core_ticks[layer] / std::max(dual_core_ticks[layer], (uint32_t)1)) %
+		                           100));
+	}
+	TF_LITE_REPORT_ERROR(error_reporter, "Fork/join overhead: %d ns%s", (int)(fork_join_ticks * 1000 / kForkJoinCount),
+	                     IsForkJoinWorkerReady() ? "" : " (no worker, parts run one after the other)");
+}
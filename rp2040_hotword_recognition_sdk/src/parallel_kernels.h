@@ -0,0 +1,62 @@
+#ifndef PARALLEL_KERNELS_H_
+#define PARALLEL_KERNELS_H_
+
+#include <stdint.h>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+
+// Int8 DEPTHWISE_CONV_2D kernel computing the upper half of the output rows on
+// core 0 and the lower half on core 1 (src/fork_join.h), each with the CMSIS-NN
+// routine over the input rows it needs. Results are identical to the CMSIS-NN
+// kernel. With streaming set, the streaming kernel is used instead, which
+// splits the rows it computes across the cores.
+TfLiteRegistration Register_PARALLEL_DEPTHWISE_CONV_2D(bool streaming = false);
+
+// Int8 FULLY_CONNECTED kernel computing the first half of the output units on
+// core 0 and the second half on core 1 with the CMSIS-NN routine, identical to
+// the CMSIS-NN kernel
+TfLiteRegistration Register_PARALLEL_FULLY_CONNECTED();
+
+// Runs the interpreter on random inputs with the kernels on one core and on
+// both cores and reports the time of each parallel layer and the fork/join
+// overhead. The streaming convolution computes the whole window for random
+// inputs, so its speedup is the one of a window that did not slide.
+void ReportParallelKernelSpeedup(tflite::ErrorReporter* error_reporter, tflite::MicroInterpreter* interpreter);
+
+// MicroMutableOpResolver running DEPTHWISE_CONV_2D and FULLY_CONNECTED through
+// the parallel kernels once they were added
+template <unsigned int tOpCount>
+class ParallelOpResolver : public tflite::MicroMutableOpResolver<tOpCount> {
+ public:
+	explicit ParallelOpResolver(tflite::ErrorReporter* error_reporter = nullptr, bool streaming = false)
+	    : tflite::MicroMutableOpResolver<tOpCount>(error_reporter),
+	      depthwise_conv_registration_(Register_PARALLEL_DEPTHWISE_CONV_2D(streaming)),
+	      fully_connected_registration_(Register_PARALLEL_FULLY_CONNECTED()) {
+		depthwise_conv_registration_.builtin_code = tflite::BuiltinOperator_DEPTHWISE_CONV_2D;
+		fully_connected_registration_.builtin_code = tflite::BuiltinOperator_FULLY_CONNECTED;
+	}
+
+	using tflite::MicroMutableOpResolver<tOpCount>::FindOp;
+	const TfLiteRegistration* FindOp(tflite::BuiltinOperator op) const override {
+		const TfLiteRegistration* registration = tflite::MicroMutableOpResolver<tOpCount>::FindOp(op);
+		if (registration == nullptr) {
+			return nullptr;
+		}
+		if (op == tflite::BuiltinOperator_DEPTHWISE_CONV_2D) {
+			return &depthwise_conv_registration_;
+		}
+		if (op == tflite::BuiltinOperator_FULLY_CONNECTED) {
+			return &fully_connected_registration_;
+		}
+		return registration;
+	}
+
+ private:
+	TfLiteRegistration depthwise_conv_registration_;
+	TfLiteRegistration fully_connected_registration_;
+};
+
+#endif
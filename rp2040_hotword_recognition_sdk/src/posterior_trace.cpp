@@ -0,0 +1,58 @@
+#include "posterior_trace.h"
+
+namespace {
+constexpr uint8_t kSync[2] = {0x00, 0xA6};
+constexpr uint8_t kFrameVersion = 1;
+constexpr int kHeaderSize = 4;
+constexpr int kPayloadSize = 4 + kCategoryCount;
+
+uint16_t Fletcher16(const uint8_t* data, int size) {
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	for (int i = 0; i < size; i++) {
+		sum1 = (sum1 + data[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return static_cast<uint16_t>((sum2 << 8) | sum1);
+}
+}  // namespace
+
+int WritePosteriorTraceFrame(int32_t time_ms, const int8_t* scores, uint8_t* buffer) {
+	buffer[0] = kSync[0];
+	buffer[1] = kSync[1];
+	buffer[2] = kFrameVersion;
+	buffer[3] = kCategoryCount;
+	uint8_t* payload = buffer + kHeaderSize;
+	const uint32_t time_bits = static_cast<uint32_t>(time_ms);
+	for (int i = 0; i < 4; i++) {
+		payload[i] = (time_bits >> (8 * i)) & 0xff;
+	}
+	for (int i = 0; i < kCategoryCount; i++) {
+		payload[4 + i] = static_cast<uint8_t>(scores[i]);
+	}
+	const uint16_t checksum = Fletcher16(payload, kPayloadSize);
+	payload[kPayloadSize] = checksum & 0xff;
+	payload[kPayloadSize + 1] = checksum >> 8;
+	return kPosteriorTraceFrameSize;
+}
+
+int ReadPosteriorTraceFrame(const uint8_t* data, int size, int32_t* time_ms, int8_t* scores) {
+	if ((size < kPosteriorTraceFrameSize) || (data[0] != kSync[0]) || (data[1] != kSync[1]) ||
+	    (data[2] != kFrameVersion) || (data[3] != kCategoryCount)) {
+		return 0;
+	}
+	const uint8_t* payload = data + kHeaderSize;
+	const uint16_t checksum = payload[kPayloadSize] | (payload[kPayloadSize + 1] << 8);
+	if (checksum != Fletcher16(payload, kPayloadSize)) {
+		return 0;
+	}
+	uint32_t time_bits = 0;
+	for (int i = 0; i < 4; i++) {
+		time_bits |= static_cast<uint32_t>(payload[i]) << (8 * i);
+	}
+	*time_ms = static_cast<int32_t>(time_bits);
+	for (int i = 0; i < kCategoryCount; i++) {
+		scores[i] = static_cast<int8_t>(payload[4 + i]);
+	}
+	return kPosteriorTraceFrameSize;
+}
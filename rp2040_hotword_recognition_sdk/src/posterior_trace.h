@@ -0,0 +1,28 @@
+#ifndef POSTERIOR_TRACE_H_
+#define POSTERIOR_TRACE_H_
+
+#include <stdint.h>
+
+#include "micro_features/micro_model_settings.h"
+
+// Binary frame holding the scores fed to the recognizer for one spectrogram
+// window. A posterior trace is a sequence of these frames: sent by the firmware
+// with g_trace_output_enabled (recorded by scripts/record_posterior_trace.py)
+// or written by the host tool trace_record, and replayed by recognizer_tuning.
+// Frame layout, multi-byte values little endian:
+//   0x00 0xA6                      sync, never part of text output
+//   uint8 version, uint8 category_count
+//   int32 time_ms                  time of the newest slice of the window
+//   category_count int8 scores
+//   uint16 Fletcher-16 checksum of time and scores
+constexpr int kPosteriorTraceFrameSize = 4 + 4 + kCategoryCount + 2;
+
+// Writes the frame of the scores to buffer, which holds at least
+// kPosteriorTraceFrameSize bytes, and returns its size
+int WritePosteriorTraceFrame(int32_t time_ms, const int8_t* scores, uint8_t* buffer);
+
+// Reads the frame at the start of data into time_ms and scores. Returns the
+// frame size, or 0 if data does not start with a valid frame of this model.
+int ReadPosteriorTraceFrame(const uint8_t* data, int size, int32_t* time_ms, int8_t* scores);
+
+#endif
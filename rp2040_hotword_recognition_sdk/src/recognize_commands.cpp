@@ -55,6 +55,13 @@ TfLiteStatus RecognizeCommands::ProcessLatestResults(
     return kTfLiteError;
   }
 
+  return ProcessLatestScores(latest_results->data.int8, current_time_ms,
+                             found_command, score, is_new_command);
+}
+
+TfLiteStatus RecognizeCommands::ProcessLatestScores(
+    const int8_t* latest_scores, const int32_t current_time_ms,
+    const char** found_command, uint8_t* score, bool* is_new_command) {
   if ((!previous_results_.empty()) &&
       (current_time_ms < previous_results_.front().time_)) {
     TF_LITE_REPORT_ERROR(
@@ -66,7 +73,7 @@ TfLiteStatus RecognizeCommands::ProcessLatestResults(
   }
 
   // Add the latest results to the head of the queue.
-  previous_results_.push_back({current_time_ms, latest_results->data.int8});
+  previous_results_.push_back({current_time_ms, latest_scores});
 
   // Prune any earlier results that are too old for the averaging window.
   const int64_t time_limit = current_time_ms - average_window_duration_ms_;
@@ -88,32 +95,24 @@ TfLiteStatus RecognizeCommands::ProcessLatestResults(
     return kTfLiteOk;
   }
 
-  // Calculate the average score across all the results in the window.
-  int32_t average_scores[kCategoryCount];
-  for (int offset = 0; offset < previous_results_.size(); ++offset) {
-    PreviousResultsQueue::Result previous_result =
-        previous_results_.from_front(offset);
-    const int8_t* scores = previous_result.scores;
-    for (int i = 0; i < kCategoryCount; ++i) {
-      if (offset == 0) {
-        average_scores[i] = scores[i] + 128;
-      } else {
-        average_scores[i] += scores[i] + 128;
-      }
-    }
-  }
+  // Find the current highest scoring category by its average score across all
+  // the results in the window. The averages are rounded down, so the top
+  // average comes from the highest sum and the top category is the first one
+  // whose sum reaches it, which only takes one division (done by the hardware
+  // divider of the RP2040 through the pico-sdk).
+  const int32_t* sums = previous_results_.sums();
+  int32_t highest_sum = 0;
   for (int i = 0; i < kCategoryCount; ++i) {
-    average_scores[i] /= how_many_results;
+    if (sums[i] > highest_sum) {
+      highest_sum = sums[i];
+    }
   }
-
-  // Find the current highest scoring category.
+  const int32_t count = static_cast<int32_t>(how_many_results);
+  const int32_t current_top_score = highest_sum / count;
+  const int32_t top_score_sum = current_top_score * count;
   int current_top_index = 0;
-  int32_t current_top_score = 0;
-  for (int i = 0; i < kCategoryCount; ++i) {
-    if (average_scores[i] > current_top_score) {
-      current_top_score = average_scores[i];
-      current_top_index = i;
-    }
+  while (sums[current_top_index] < top_score_sum) {
+    ++current_top_index;
   }
   const char* current_top_label = kCategoryLabels[current_top_index];
 
@@ -27,17 +27,19 @@ limitations under the License.
 // short time period, so they can be averaged together to produce a more
 // accurate overall prediction. This doesn't use any dynamic memory allocation
 // so it's a better fit for microcontroller applications, but this does mean
-// there are hard limits on the number of results it can store.
+// there are hard limits on the number of results it can store. It keeps the
+// sum of the scores of each category over the stored results, so averaging
+// them doesn't need to iterate through the queue.
 class PreviousResultsQueue {
  public:
   PreviousResultsQueue(tflite::ErrorReporter* error_reporter)
-      : error_reporter_(error_reporter), front_index_(0), size_(0) {}
+      : error_reporter_(error_reporter), front_index_(0), size_(0), sums_() {}
 
   // Data structure that holds an inference result, and the time when it
   // was recorded.
   struct Result {
     Result() : time_(0), scores() {}
-    Result(int32_t time, int8_t* input_scores) : time_(time) {
+    Result(int32_t time, const int8_t* input_scores) : time_(time) {
       for (int i = 0; i < kCategoryCount; ++i) {
         scores[i] = input_scores[i];
       }
@@ -66,23 +68,32 @@ class PreviousResultsQueue {
     }
     size_ += 1;
     back() = entry;
+    for (int i = 0; i < kCategoryCount; ++i) {
+      sums_[i] += entry.scores[i] + 128;
+    }
   }
 
-  Result pop_front() {
+  void pop_front() {
     if (size() <= 0) {
       TF_LITE_REPORT_ERROR(error_reporter_,
                            "Couldn't pop_front result, none present!");
-      return Result();
+      return;
+    }
+    const int8_t* scores = front().scores;
+    for (int i = 0; i < kCategoryCount; ++i) {
+      sums_[i] -= scores[i] + 128;
     }
-    Result result = front();
     front_index_ += 1;
     if (front_index_ >= kMaxResults) {
       front_index_ = 0;
     }
     size_ -= 1;
-    return result;
   }
 
+  // Sum of the scores of each category over all stored results, with the
+  // scores shifted from int8_t to the range 0 to 255.
+  const int32_t* sums() const { return sums_; }
+
   // Most of the functions are duplicates of dequeue containers, but this
   // is a helper that makes it easy to iterate through the contents of the
   // queue.
@@ -106,6 +117,7 @@ class PreviousResultsQueue {
 
   int front_index_;
   int size_;
+  int32_t sums_[kCategoryCount];
 };
 
 // This class is designed to apply a very primitive decoding model on top of the
@@ -142,6 +154,14 @@ class RecognizeCommands {
                                     const char** found_command, uint8_t* score,
                                     bool* is_new_command);
 
+  // Same as ProcessLatestResults(), but takes the raw int8 scores of all
+  // kCategoryCount categories instead of an output tensor. This allows feeding
+  // results that didn't come from running the model, like synthetic silence.
+  TfLiteStatus ProcessLatestScores(const int8_t* latest_scores,
+                                   const int32_t current_time_ms,
+                                   const char** found_command, uint8_t* score,
+                                   bool* is_new_command);
+
  private:
   // Configuration
   tflite::ErrorReporter* error_reporter_;
@@ -0,0 +1,32 @@
+#include "slice_queue.h"
+
+#include <string.h>
+
+static_assert((SliceQueue::kCapacity & (SliceQueue::kCapacity - 1)) == 0, "Slice queue capacity must be a power of two");
+
+bool SliceQueue::Push(const int8_t* features, bool is_speech, int32_t time_ms) {
+	const uint32_t tail = tail_.load(std::memory_order_relaxed);
+	if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+		return false;
+	}
+	Slice& slice = slices_[tail % kCapacity];
+	memcpy(slice.features, features, kFeatureSliceSize);
+	slice.is_speech = is_speech;
+	slice.time_ms = time_ms;
+	// Publish the slot only after it is written
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+const SliceQueue::Slice* SliceQueue::Front() const {
+	const uint32_t head = head_.load(std::memory_order_relaxed);
+	if (head == tail_.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	return &slices_[head % kCapacity];
+}
+
+void SliceQueue::Pop() {
+	// Hand the slot back only after it is read
+	head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
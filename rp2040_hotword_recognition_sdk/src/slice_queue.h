@@ -0,0 +1,49 @@
+#ifndef SLICE_QUEUE_H_
+#define SLICE_QUEUE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "micro_features/micro_model_settings.h"
+
+// Lock-free queue of feature slices from one producer to one consumer, used to
+// pass the slices generated on core 1 to the inference on core 0. The producer
+// only writes the tail index and the consumer only the head index, each after
+// finishing with the slot, so neither side ever waits for the other. A full
+// queue rejects new slices.
+class SliceQueue {
+ public:
+	// Number of slots, a power of two
+	static constexpr uint32_t kCapacity = 64;
+
+	struct Slice {
+		int8_t features[kFeatureSliceSize];
+		// Frontend voice activity flag of the slice
+		bool is_speech;
+		// Audio timestamp of the feature generation call producing the slice
+		int32_t time_ms;
+	};
+
+	SliceQueue() : head_(0), tail_(0) {}
+
+	// Producer: copies a slice into the queue. Returns false if the queue is full.
+	bool Push(const int8_t* features, bool is_speech, int32_t time_ms);
+
+	// Consumer: returns the oldest slice, or nullptr if the queue is empty. The
+	// slice stays valid until Pop() is called.
+	const Slice* Front() const;
+	void Pop();
+
+	// Number of queued slices, exact for the consumer and a lower bound for the
+	// producer
+	uint32_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+ private:
+	Slice slices_[kCapacity];
+	// Free running indices, the slot is the index modulo kCapacity
+	std::atomic<uint32_t> head_;
+	std::atomic<uint32_t> tail_;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "stats_profiler.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "tensorflow/lite/micro/micro_time.h"
+
+namespace {
+
+constexpr uint8_t kFrameVersion = 1;
+
+uint8_t* WriteUint16(uint8_t* data, uint16_t value) {
+	data[0] = value & 0xff;
+	data[1] = value >> 8;
+	return data + 2;
+}
+
+uint8_t* WriteInt32(uint8_t* data, int32_t value) {
+	const uint32_t bits = static_cast<uint32_t>(value);
+	for (int i = 0; i < 4; i++) {
+		data[i] = (bits >> (8 * i)) & 0xff;
+	}
+	return data + 4;
+}
+
+}  // namespace
+
+uint32_t StatsProfiler::BeginEvent(const char* tag) {
+	// Events are handed out round robin, the interpreter never nests more than
+	// kMaxOpenEvents of them
+	const uint32_t event_handle = next_event_;
+	next_event_ = (next_event_ + 1) % kMaxOpenEvents;
+	open_events_[event_handle].tag_index = FindOrAddTag(tag);
+	open_events_[event_handle].start_ticks = tflite::GetCurrentTimeTicks();
+	return event_handle;
+}
+
+void StatsProfiler::EndEvent(uint32_t event_handle) {
+	const int32_t end_ticks = tflite::GetCurrentTimeTicks();
+	if (event_handle >= kMaxOpenEvents) {
+		return;
+	}
+	const OpenEvent& event = open_events_[event_handle];
+	if (event.tag_index < 0) {
+		return;
+	}
+	TagWindow& window = windows_[event.tag_index];
+	const int32_t ticks = end_ticks - event.start_ticks;
+	if (window.count == kWindowSize) {
+		window.sum -= window.ticks[window.next];
+	} else {
+		window.count++;
+	}
+	window.ticks[window.next] = ticks;
+	window.sum += ticks;
+	window.next = (window.next + 1) % kWindowSize;
+}
+
+int StatsProfiler::FindOrAddTag(const char* tag) {
+	// Tags are the static operator names, so comparing pointers usually suffices
+	for (int i = 0; i < tag_count_; i++) {
+		if ((windows_[i].tag == tag) || (strcmp(windows_[i].tag, tag) == 0)) {
+			return i;
+		}
+	}
+	if (tag_count_ == kMaxTags) {
+		return -1;
+	}
+	TagWindow& window = windows_[tag_count_];
+	window.tag = tag;
+	window.count = 0;
+	window.next = 0;
+	window.sum = 0;
+	return tag_count_++;
+}
+
+void StatsProfiler::ComputeStats(const TagWindow& window, TagStats* stats) const {
+	stats->tag = window.tag;
+	stats->count = window.count;
+	if (window.count == 0) {
+		stats->min_ticks = stats->mean_ticks = stats->max_ticks = stats->p99_ticks = 0;
+		return;
+	}
+	int32_t sorted[kWindowSize];
+	std::copy(window.ticks, window.ticks + window.count, sorted);
+	// Nearest rank percentile, the largest value for less than 100 events
+	const int p99_index = (99 * window.count + 99) / 100 - 1;
+	std::nth_element(sorted, sorted + p99_index, sorted + window.count);
+	stats->p99_ticks = sorted[p99_index];
+	stats->min_ticks = *std::min_element(window.ticks, window.ticks + window.count);
+	stats->max_ticks = *std::max_element(window.ticks, window.ticks + window.count);
+	stats->mean_ticks = static_cast<int32_t>(window.sum / window.count);
+}
+
+int StatsProfiler::GetStats(TagStats* stats, int max_count) const {
+	const int count = std::min(tag_count_, max_count);
+	for (int i = 0; i < count; i++) {
+		ComputeStats(windows_[i], &stats[i]);
+	}
+	return count;
+}
+
+int StatsProfiler::WriteFrame(uint8_t* buffer, int buffer_size) const {
+	int payload_size = 0;
+	for (int i = 0; i < tag_count_; i++) {
+		const int tag_length = std::min(static_cast<int>(strlen(windows_[i].tag)), kMaxFrameTagLength);
+		payload_size += 1 + tag_length + 2 + 4 * 4;
+	}
+	const int frame_size = 6 + payload_size + 2;
+	if (frame_size > buffer_size) {
+		return 0;
+	}
+
+	uint8_t* data = buffer;
+	*data++ = 0x00;
+	*data++ = 0xA5;
+	*data++ = kFrameVersion;
+	*data++ = static_cast<uint8_t>(tag_count_);
+	data = WriteUint16(data, static_cast<uint16_t>(payload_size));
+	uint8_t* payload = data;
+	for (int i = 0; i < tag_count_; i++) {
+		TagStats stats;
+		ComputeStats(windows_[i], &stats);
+		const int tag_length = std::min(static_cast<int>(strlen(stats.tag)), kMaxFrameTagLength);
+		*data++ = static_cast<uint8_t>(tag_length);
+		memcpy(data, stats.tag, tag_length);
+		data += tag_length;
+		data = WriteUint16(data, static_cast<uint16_t>(stats.count));
+		data = WriteInt32(data, stats.min_ticks);
+		data = WriteInt32(data, stats.mean_ticks);
+		data = WriteInt32(data, stats.max_ticks);
+		data = WriteInt32(data, stats.p99_ticks);
+	}
+
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+	for (int i = 0; i < payload_size; i++) {
+		sum1 = (sum1 + payload[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	WriteUint16(data, static_cast<uint16_t>((sum2 << 8) | sum1));
+	return frame_size;
+}
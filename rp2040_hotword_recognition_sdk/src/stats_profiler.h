@@ -0,0 +1,83 @@
+#ifndef STATS_PROFILER_H_
+#define STATS_PROFILER_H_
+
+#include <stdint.h>
+
+#include "tensorflow/lite/micro/micro_profiler.h"
+
+// Profiler keeping the ticks of the latest kWindowSize events of every tag
+// (operator name) instead of a log of all events. Recording an event only
+// stores its ticks in the ring of its tag; minimum, mean, maximum and 99th
+// percentile are computed when statistics are requested. The event log of the
+// MicroProfiler base class stays unused.
+class StatsProfiler : public tflite::MicroProfiler {
+ public:
+	// Statistics of the events of one tag in the current window, in ticks
+	struct TagStats {
+		const char* tag;
+		int32_t count;
+		int32_t min_ticks;
+		int32_t mean_ticks;
+		int32_t max_ticks;
+		int32_t p99_ticks;
+	};
+
+	// Maximum number of distinct tags, events of further tags are ignored
+	static constexpr int kMaxTags = 8;
+	// Number of latest events per tag the statistics are computed over
+	static constexpr int kWindowSize = 128;
+	// Tag names are truncated to this length in frames
+	static constexpr int kMaxFrameTagLength = 31;
+	// Upper bound of the size of a frame written by WriteFrame()
+	static constexpr int kMaxFrameSize = 6 + kMaxTags * (1 + kMaxFrameTagLength + 2 + 4 * 4) + 2;
+
+	StatsProfiler() = default;
+	~StatsProfiler() override = default;
+
+	uint32_t BeginEvent(const char* tag) override;
+	void EndEvent(uint32_t event_handle) override;
+
+	// Fills stats with the statistics of up to max_count tags in order of their
+	// first event. Returns the number of tags filled in.
+	int GetStats(TagStats* stats, int max_count) const;
+
+	// Writes the statistics of all tags as binary frame to buffer, decoded by
+	// scripts/decode_profiler_stats.py. Returns the frame size in bytes, or 0 if
+	// the buffer is too small.
+	// Frame layout, multi-byte values little endian:
+	//   0x00 0xA5                      sync, never part of text output
+	//   uint8 version, uint8 tag_count
+	//   uint16 payload_size
+	//   per tag: uint8 tag_length, tag_length name bytes, uint16 count,
+	//            int32 min, mean, max and p99 ticks
+	//   uint16 Fletcher-16 checksum of the payload
+	int WriteFrame(uint8_t* buffer, int buffer_size) const;
+
+ private:
+	static constexpr int kMaxOpenEvents = 4;
+
+	struct TagWindow {
+		const char* tag;
+		int32_t ticks[kWindowSize];
+		int32_t count;
+		int32_t next;
+		int64_t sum;
+	};
+
+	struct OpenEvent {
+		int tag_index;
+		int32_t start_ticks;
+	};
+
+	int FindOrAddTag(const char* tag);
+	void ComputeStats(const TagWindow& window, TagStats* stats) const;
+
+	TagWindow windows_[kMaxTags];
+	int tag_count_ = 0;
+	OpenEvent open_events_[kMaxOpenEvents];
+	uint32_t next_event_ = 0;
+
+	TF_LITE_REMOVE_VIRTUAL_DELETE;
+};
+
+#endif
@@ -0,0 +1,329 @@
+#include "streaming_depthwise_conv.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "CMSIS/NN/Include/arm_nnfunctions.h"
+#include "fork_join.h"
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/depthwise_conv.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+
+namespace {
+
+struct OpData {
+	tflite::OpDataConv reference_op_data;
+	// Indices to the CMSIS-NN scratch buffer of each core, -1 if not needed
+	int buffer_indices[kForkJoinPartCount];
+	// Output rows whose receptive field lies completely inside the input
+	int first_cached_row;
+	int last_cached_row;
+	int input_row_size;
+	int output_row_size;
+	// Copy of the previous input to find how far the window moved
+	int8_t* previous_input;
+	bool has_previous_input;
+	// Absolute slice position of the first input row
+	uint32_t window_position;
+	// Ring of output rows, each tagged with the absolute slice position of its
+	// first input row
+	int cache_row_count;
+	int8_t* cache_rows;
+	uint32_t* cache_positions;
+	// Output rows to compute in the current invocation
+	int* compute_rows;
+};
+
+int32_t computed_row_count = 0;
+int32_t cached_row_count = 0;
+
+void* Init(TfLiteContext* context, const char* buffer, size_t length) {
+	TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+	return context->AllocatePersistentBuffer(context, sizeof(OpData));
+}
+
+TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
+	TFLITE_DCHECK(node->user_data != nullptr);
+	TFLITE_DCHECK(node->builtin_data != nullptr);
+
+	OpData* data = static_cast<OpData*>(node->user_data);
+	const auto& params = *(static_cast<const TfLiteDepthwiseConvParams*>(node->builtin_data));
+	tflite::MicroContext* micro_context = tflite::GetMicroContext(context);
+
+	TfLiteTensor* input = micro_context->AllocateTempInputTensor(node, tflite::kDepthwiseConvInputTensor);
+	TF_LITE_ENSURE(context, input != nullptr);
+	TfLiteTensor* filter = micro_context->AllocateTempInputTensor(node, tflite::kDepthwiseConvWeightsTensor);
+	TF_LITE_ENSURE(context, filter != nullptr);
+	TfLiteTensor* output = micro_context->AllocateTempOutputTensor(node, tflite::kDepthwiseConvOutputTensor);
+	TF_LITE_ENSURE(context, output != nullptr);
+	// The row ranges below assume undilated int8 rows
+	TF_LITE_ENSURE_EQ(context, input->type, kTfLiteInt8);
+	TF_LITE_ENSURE_EQ(context, params.dilation_height_factor, 1);
+	TF_LITE_ENSURE_EQ(context, tflite::SizeOfDimension(input, 0), 1);
+
+	const int input_height = tflite::SizeOfDimension(input, 1);
+	const int input_width = tflite::SizeOfDimension(input, 2);
+	const int filter_height = tflite::SizeOfDimension(filter, 1);
+	const int filter_width = tflite::SizeOfDimension(filter, 2);
+	const int output_height = tflite::SizeOfDimension(output, 1);
+	const int output_width = tflite::SizeOfDimension(output, 2);
+	const int output_depth = tflite::SizeOfDimension(output, 3);
+
+	const int num_channels = filter->dims->data[tflite::kDepthwiseConvQuantizedDimension];
+	data->reference_op_data.per_channel_output_multiplier =
+	    static_cast<int32_t*>(context->AllocatePersistentBuffer(context, num_channels * sizeof(int32_t)));
+	data->reference_op_data.per_channel_output_shift =
+	    static_cast<int32_t*>(context->AllocatePersistentBuffer(context, num_channels * sizeof(int32_t)));
+	TF_LITE_ENSURE_STATUS(tflite::CalculateOpDataDepthwiseConv(context, node, params, input_width, input_height,
+	                                                           filter_width, filter_height, output_width,
+	                                                           output_height, input->type, &data->reference_op_data));
+
+	// Output row i reads the input rows from i * stride - padding on
+	const int stride = params.stride_height;
+	const int padding = data->reference_op_data.padding.height;
+	data->first_cached_row = (padding + stride - 1) / stride;
+	data->last_cached_row = std::min((input_height - filter_height + padding) / stride, output_height - 1);
+	data->input_row_size = input_width * tflite::SizeOfDimension(input, 3);
+	data->output_row_size = output_width * output_depth;
+	data->has_previous_input = false;
+	data->window_position = 0;
+	data->previous_input =
+	    static_cast<int8_t*>(context->AllocatePersistentBuffer(context, input_height * data->input_row_size));
+	TF_LITE_ENSURE(context, data->previous_input != nullptr);
+
+	// The rows of the current window plus those of the window one slice later
+	data->cache_row_count = std::max(data->last_cached_row - data->first_cached_row + 2, 0) * stride;
+	if (data->cache_row_count > 0) {
+		data->cache_rows = static_cast<int8_t*>(
+		    context->AllocatePersistentBuffer(context, data->cache_row_count * data->output_row_size));
+		data->cache_positions = static_cast<uint32_t*>(
+		    context->AllocatePersistentBuffer(context, data->cache_row_count * sizeof(uint32_t)));
+		TF_LITE_ENSURE(context, (data->cache_rows != nullptr) && (data->cache_positions != nullptr));
+	}
+
+	data->compute_rows = static_cast<int*>(context->AllocatePersistentBuffer(context, output_height * sizeof(int)));
+	TF_LITE_ENSURE(context, data->compute_rows != nullptr);
+
+	// Scratch buffers for computing one output row at a time on each core
+	cmsis_nn_dims input_dims = {1, filter_height, input_width, tflite::SizeOfDimension(input, 3)};
+	cmsis_nn_dims filter_dims = {1, filter_height, filter_width, output_depth};
+	cmsis_nn_dims output_dims = {1, 1, output_width, output_depth};
+	cmsis_nn_dw_conv_params dw_conv_params;
+	dw_conv_params.padding.h = 0;
+	dw_conv_params.padding.w = data->reference_op_data.padding.width;
+	dw_conv_params.dilation.h = params.dilation_height_factor;
+	dw_conv_params.dilation.w = params.dilation_width_factor;
+	const int32_t buf_size =
+	    arm_depthwise_conv_wrapper_s8_get_buffer_size(&dw_conv_params, &input_dims, &filter_dims, &output_dims);
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		data->buffer_indices[part] = -1;
+		if (buf_size > 0) {
+			TF_LITE_ENSURE_STATUS(context->RequestScratchBufferInArena(context, buf_size, &data->buffer_indices[part]));
+		}
+	}
+
+	micro_context->DeallocateTempTfLiteTensor(output);
+	micro_context->DeallocateTempTfLiteTensor(input);
+	micro_context->DeallocateTempTfLiteTensor(filter);
+	return kTfLiteOk;
+}
+
+// Returns the number of rows the input moved up since the previous invocation,
+// or the input height if it did not slide
+int FindWindowShift(const OpData& data, const int8_t* input, int input_height) {
+	if (!data.has_previous_input) {
+		return input_height;
+	}
+	for (int shift = 0; shift < input_height; shift++) {
+		if (memcmp(input, data.previous_input + shift * data.input_row_size,
+		           (input_height - shift) * data.input_row_size) == 0) {
+			return shift;
+		}
+	}
+	return input_height;
+}
+
+// Returns whether the output row is cached, and where the row is computed: its
+// cache slot if cached, else its place in the output
+bool GetRowData(const OpData& data, int row, int first_input_row, int8_t* output_data, int8_t** row_data) {
+	if ((row < data.first_cached_row) || (row > data.last_cached_row)) {
+		*row_data = output_data + row * data.output_row_size;
+		return false;
+	}
+	const uint32_t position = data.window_position + first_input_row;
+	*row_data = data.cache_rows + (position % data.cache_row_count) * data.output_row_size;
+	return true;
+}
+
+struct RowJob {
+	const OpData* data;
+	const cmsis_nn_dw_conv_params* dw_conv_params;
+	const cmsis_nn_per_channel_quant_params* quant_params;
+	const cmsis_nn_dims* input_dims;
+	const cmsis_nn_dims* filter_dims;
+	const cmsis_nn_dims* bias_dims;
+	const cmsis_nn_dims* output_dims;
+	int input_height;
+	const int8_t* input_data;
+	const int8_t* filter_data;
+	const int32_t* bias_data;
+	int8_t* output_data;
+	int row_count;
+	cmsis_nn_context contexts[kForkJoinPartCount];
+	arm_status status[kForkJoinPartCount];
+};
+
+// Computes every second row to compute on each core, each from its input rows
+// clipped to the window and padded above by the rows cut off
+void ComputeRowsPart(void* arg, int part) {
+	RowJob& job = *static_cast<RowJob*>(arg);
+	const OpData& data = *job.data;
+	cmsis_nn_dw_conv_params dw_conv_params = *job.dw_conv_params;
+	cmsis_nn_dims input_dims = *job.input_dims;
+	const int filter_height = job.filter_dims->h;
+	job.status[part] = ARM_MATH_SUCCESS;
+	for (int i = part; (i < job.row_count) && (job.status[part] == ARM_MATH_SUCCESS); i += kForkJoinPartCount) {
+		const int row = data.compute_rows[i];
+		const int first_input_row = row * dw_conv_params.stride.h - data.reference_op_data.padding.height;
+		int8_t* row_data;
+		GetRowData(data, row, first_input_row, job.output_data, &row_data);
+		const int input_start = std::max(first_input_row, 0);
+		const int input_end = std::min(first_input_row + filter_height, job.input_height);
+		input_dims.h = input_end - input_start;
+		dw_conv_params.padding.h = input_start - first_input_row;
+		job.status[part] = arm_depthwise_conv_wrapper_s8(
+		    &job.contexts[part], &dw_conv_params, job.quant_params, &input_dims,
+		    job.input_data + input_start * data.input_row_size, job.filter_dims, job.filter_data, job.bias_dims,
+		    job.bias_data, job.output_dims, row_data);
+	}
+}
+
+TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
+	TFLITE_DCHECK(node->user_data != nullptr);
+	TFLITE_DCHECK(node->builtin_data != nullptr);
+
+	const auto& params = *(static_cast<const TfLiteDepthwiseConvParams*>(node->builtin_data));
+	OpData& data = *(static_cast<OpData*>(node->user_data));
+	TfLiteEvalTensor* output = tflite::micro::GetEvalOutput(context, node, tflite::kDepthwiseConvOutputTensor);
+	const TfLiteEvalTensor* input = tflite::micro::GetEvalInput(context, node, tflite::kDepthwiseConvInputTensor);
+	const TfLiteEvalTensor* filter = tflite::micro::GetEvalInput(context, node, tflite::kDepthwiseConvWeightsTensor);
+	const TfLiteEvalTensor* bias =
+	    (tflite::NumInputs(node) == 3) ? tflite::micro::GetEvalInput(context, node, tflite::kDepthwiseConvBiasTensor)
+	                                   : nullptr;
+
+	const tflite::RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+	const tflite::RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+	const tflite::RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+	const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+	int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+	const int input_height = input_shape.Dims(1);
+	const int output_height = output_shape.Dims(1);
+	const int filter_height = filter_shape.Dims(1);
+
+	// Move the window, a window that did not slide invalidates all cached rows
+	const int shift = FindWindowShift(data, input_data, input_height);
+	data.window_position += shift;
+	if (shift == input_height) {
+		for (int i = 0; i < data.cache_row_count; i++) {
+			data.cache_positions[i] = data.window_position - 1;
+		}
+	}
+	memcpy(data.previous_input, input_data, input_height * data.input_row_size);
+	data.has_previous_input = true;
+
+	cmsis_nn_dw_conv_params dw_conv_params;
+	dw_conv_params.dilation.h = params.dilation_height_factor;
+	dw_conv_params.dilation.w = params.dilation_width_factor;
+	dw_conv_params.input_offset = -data.reference_op_data.input_zero_point;
+	dw_conv_params.output_offset = data.reference_op_data.output_zero_point;
+	dw_conv_params.stride.h = params.stride_height;
+	dw_conv_params.stride.w = params.stride_width;
+	dw_conv_params.padding.w = data.reference_op_data.padding.width;
+	dw_conv_params.activation.min = data.reference_op_data.output_activation_min;
+	dw_conv_params.activation.max = data.reference_op_data.output_activation_max;
+	dw_conv_params.ch_mult = params.depth_multiplier;
+
+	cmsis_nn_per_channel_quant_params quant_params;
+	quant_params.multiplier = data.reference_op_data.per_channel_output_multiplier;
+	quant_params.shift = data.reference_op_data.per_channel_output_shift;
+
+	cmsis_nn_dims input_dims = {1, 0, input_shape.Dims(2), input_shape.Dims(3)};
+	cmsis_nn_dims filter_dims = {filter_shape.Dims(0), filter_height, filter_shape.Dims(2), output_shape.Dims(3)};
+	cmsis_nn_dims bias_dims = {1, 1, 1, output_shape.Dims(3)};
+	cmsis_nn_dims output_dims = {1, 1, output_shape.Dims(2), output_shape.Dims(3)};
+
+	// Take the cached rows and list the others
+	int row_count = 0;
+	for (int row = 0; row < output_height; row++) {
+		const int first_input_row = row * params.stride_height - data.reference_op_data.padding.height;
+		int8_t* row_data;
+		if (GetRowData(data, row, first_input_row, output_data, &row_data)) {
+			const uint32_t position = data.window_position + first_input_row;
+			uint32_t& cache_position = data.cache_positions[position % data.cache_row_count];
+			if (cache_position == position) {
+				memcpy(output_data + row * data.output_row_size, row_data, data.output_row_size);
+				cached_row_count++;
+				continue;
+			}
+			cache_position = position;
+		}
+		data.compute_rows[row_count++] = row;
+	}
+
+	// Compute the listed rows on both cores
+	RowJob job;
+	job.data = &data;
+	job.dw_conv_params = &dw_conv_params;
+	job.quant_params = &quant_params;
+	job.input_dims = &input_dims;
+	job.filter_dims = &filter_dims;
+	job.bias_dims = &bias_dims;
+	job.output_dims = &output_dims;
+	job.input_height = input_height;
+	job.input_data = input_data;
+	job.filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+	job.bias_data = tflite::micro::GetTensorData<int32_t>(bias);
+	job.output_data = output_data;
+	job.row_count = row_count;
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		job.contexts[part].buf =
+		    (data.buffer_indices[part] > -1) ? context->GetScratchBuffer(context, data.buffer_indices[part]) : nullptr;
+		job.contexts[part].size = 0;
+	}
+	ForkJoin(ComputeRowsPart, &job);
+	for (int part = 0; part < kForkJoinPartCount; part++) {
+		TF_LITE_ENSURE_EQ(context, job.status[part], ARM_MATH_SUCCESS);
+	}
+
+	// Copy the computed cached rows into the output
+	for (int i = 0; i < row_count; i++) {
+		const int row = data.compute_rows[i];
+		int8_t* row_data;
+		if (GetRowData(data, row, row * params.stride_height - data.reference_op_data.padding.height, output_data,
+		               &row_data)) {
+			memcpy(output_data + row * data.output_row_size, row_data, data.output_row_size);
+		}
+	}
+	computed_row_count += row_count;
+	return kTfLiteOk;
+}
+
+}  // namespace
+
+TfLiteRegistration Register_STREAMING_DEPTHWISE_CONV_2D() {
+	return {/*init=*/Init,
+	        /*free=*/nullptr,
+	        /*prepare=*/Prepare,
+	        /*invoke=*/Eval,
+	        /*profiling_string=*/nullptr,
+	        /*builtin_code=*/0,
+	        /*custom_name=*/nullptr,
+	        /*version=*/0};
+}
+
+void GetStreamingConvRowCounts(int32_t* computed_rows, int32_t* cached_rows) {
+	*computed_rows = computed_row_count;
+	*cached_rows = cached_row_count;
+}
@@ -0,0 +1,50 @@
+#ifndef STREAMING_DEPTHWISE_CONV_H_
+#define STREAMING_DEPTHWISE_CONV_H_
+
+#include <stdint.h>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+
+// Int8 DEPTHWISE_CONV_2D kernel for inputs that slide along the height (time)
+// axis between invocations, like the spectrogram window of the feature
+// provider. The kernel keeps a copy of the previous input and finds the number
+// of slices the window moved by comparing it with the new input. Output rows
+// whose receptive field lies completely inside the window only depend on their
+// input slices, so they are cached by the absolute position of their first
+// slice and computed once; only rows touching the padding at the window edges
+// and rows over new slices are computed again. Results are identical to the
+// CMSIS-NN kernel, which computes the rows the same way. Inputs that did not
+// slide are computed completely. The rows to compute are split across both
+// cores (src/fork_join.h).
+TfLiteRegistration Register_STREAMING_DEPTHWISE_CONV_2D();
+
+// Returns the number of output rows computed and taken from the cache by all
+// streaming kernels since boot
+void GetStreamingConvRowCounts(int32_t* computed_rows, int32_t* cached_rows);
+
+// MicroMutableOpResolver running DEPTHWISE_CONV_2D through the streaming kernel
+// once it was added with AddDepthwiseConv2D()
+template <unsigned int tOpCount>
+class StreamingOpResolver : public tflite::MicroMutableOpResolver<tOpCount> {
+ public:
+	explicit StreamingOpResolver(tflite::ErrorReporter* error_reporter = nullptr)
+	    : tflite::MicroMutableOpResolver<tOpCount>(error_reporter),
+	      streaming_registration_(Register_STREAMING_DEPTHWISE_CONV_2D()) {
+		streaming_registration_.builtin_code = tflite::BuiltinOperator_DEPTHWISE_CONV_2D;
+	}
+
+	using tflite::MicroMutableOpResolver<tOpCount>::FindOp;
+	const TfLiteRegistration* FindOp(tflite::BuiltinOperator op) const override {
+		const TfLiteRegistration* registration = tflite::MicroMutableOpResolver<tOpCount>::FindOp(op);
+		if ((registration != nullptr) && (op == tflite::BuiltinOperator_DEPTHWISE_CONV_2D)) {
+			return &streaming_registration_;
+		}
+		return registration;
+	}
+
+ private:
+	TfLiteRegistration streaming_registration_;
+};
+
+#endif
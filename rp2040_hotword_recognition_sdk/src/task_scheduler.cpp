@@ -0,0 +1,182 @@
+#include "task_scheduler.h"
+
+#include "config.h"
+#include "hardware/structs/clocks.h"
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
+#include "log_ring.h"
+#include "pico/stdlib.h"
+
+namespace {
+// Wraparound safe comparison of 32-bit microsecond times
+bool IsReached(uint32_t now_us, uint32_t time_us) { return static_cast<int32_t>(now_us - time_us) >= 0; }
+}  // namespace
+
+int TaskScheduler::AddTask(const char* name, TaskFunction function, uint32_t period_us, uint32_t deadline_us) {
+	if (task_count_ >= kMaxTasks) {
+		return -1;
+	}
+	Task& task = tasks_[task_count_];
+	task.name = name;
+	task.function = function;
+	task.period_us = period_us;
+	task.deadline_us = deadline_us;
+	task.next_release_us = 0;
+	task.signal_us.store(0, std::memory_order_relaxed);
+	task.run_count = 0;
+	task.miss_count = 0;
+	task.max_response_us = 0;
+	task.signaled.store(false, std::memory_order_release);
+	return task_count_++;
+}
+
+void TaskScheduler::Signal(int task) {
+	if ((task < 0) || (task >= task_count_)) {
+		return;
+	}
+	Task& signaled_task = tasks_[task];
+	// A pending release keeps its earlier time
+	if (!signaled_task.signaled.load(std::memory_order_relaxed)) {
+		signaled_task.signal_us.store(time_us_32(), std::memory_order_relaxed);
+	}
+	signaled_task.signaled.store(true, std::memory_order_release);
+	// Wake the owning core if it sleeps in WFE. Interrupt handlers on the owning
+	// core wake it anyway.
+	__sev();
+}
+
+void TaskScheduler::RunOnce() {
+	uint32_t now_us = time_us_32();
+	if (!started_) {
+		Start(now_us);
+	}
+	ReportIfDue(now_us);
+
+	// Earliest deadline first among the released tasks
+	int next_task = -1;
+	uint32_t next_release_us = 0;
+	uint32_t next_deadline_us = 0;
+	for (int i = 0; i < task_count_; i++) {
+		const Task& task = tasks_[i];
+		uint32_t release_us = 0;
+		if (task.signaled.load(std::memory_order_acquire)) {
+			release_us = task.signal_us.load(std::memory_order_relaxed);
+		} else if ((task.period_us > 0) && IsReached(now_us, task.next_release_us)) {
+			release_us = task.next_release_us;
+		} else {
+			continue;
+		}
+		const uint32_t deadline_us = release_us + task.deadline_us;
+		if ((next_task < 0) || !IsReached(deadline_us, next_deadline_us)) {
+			next_task = i;
+			next_release_us = release_us;
+			next_deadline_us = deadline_us;
+		}
+	}
+	if (next_task < 0) {
+		Sleep(now_us);
+		return;
+	}
+	Run(next_task, next_release_us, now_us);
+}
+
+void TaskScheduler::Start(uint32_t now_us) {
+	// The time spent in setup() counts neither as response time nor as missed
+	// periods
+	for (int i = 0; i < task_count_; i++) {
+		Task& task = tasks_[i];
+		task.next_release_us = now_us + task.period_us;
+		if (task.signaled.load(std::memory_order_relaxed)) {
+			task.signal_us.store(now_us, std::memory_order_relaxed);
+		}
+	}
+	report_start_us_ = now_us;
+	started_ = true;
+}
+
+void TaskScheduler::Run(int index, uint32_t release_us, uint32_t now_us) {
+	Task& task = tasks_[index];
+	// Signals from here on release the task again. The store is ordered before the
+	// loads of the task, so the data of such a signal is either seen by this run or
+	// released with the next one.
+	task.signaled.store(false, std::memory_order_seq_cst);
+	if ((task.period_us > 0) && IsReached(now_us, task.next_release_us)) {
+		task.next_release_us += task.period_us;
+		// Periods that passed during an overrun are skipped
+		while (IsReached(now_us, task.next_release_us)) {
+			task.next_release_us += task.period_us;
+			task.miss_count++;
+		}
+	}
+
+	task.function();
+
+	const uint32_t response_us = time_us_32() - release_us;
+	task.run_count++;
+	if (response_us > task.deadline_us) {
+		task.miss_count++;
+	}
+	if (response_us > task.max_response_us) {
+		task.max_response_us = response_us;
+	}
+}
+
+void TaskScheduler::Sleep(uint32_t now_us) {
+	if (!g_idle_sleep_enabled) {
+		return;
+	}
+	uint32_t wake_us = now_us + kMaxSleepUs;
+	for (int i = 0; i < task_count_; i++) {
+		const Task& task = tasks_[i];
+		if ((task.period_us > 0) && !IsReached(task.next_release_us, wake_us)) {
+			wake_us = task.next_release_us;
+		}
+	}
+	if ((report_interval_us_ > 0) && !IsReached(report_start_us_ + report_interval_us_, wake_us)) {
+		wake_us = report_start_us_ + report_interval_us_;
+	}
+	if (IsReached(now_us, wake_us)) {
+		return;
+	}
+	// Returns on the alarm at wake_us, any interrupt of this core or an SEV. An
+	// event left over from earlier returns at once, the next call sleeps then.
+	best_effort_wfe_or_timeout(delayed_by_us(get_absolute_time(), wake_us - now_us));
+	sleep_us_ += time_us_32() - now_us;
+}
+
+void TaskScheduler::ReportIfDue(uint32_t now_us) {
+	if ((report_interval_us_ == 0) || !IsReached(now_us, report_start_us_ + report_interval_us_)) {
+		return;
+	}
+	const int32_t core = get_core_num();
+	for (int i = 0; i < task_count_; i++) {
+		Task& task = tasks_[i];
+		Log(kLogTaskStats, core, task.name, task.run_count, task.miss_count, (int32_t)task.max_response_us);
+		task.run_count = 0;
+		task.miss_count = 0;
+		task.max_response_us = 0;
+	}
+	// Interrupt handlers that ran during the sleep count as sleep time
+	const uint32_t elapsed_us = now_us - report_start_us_;
+	Log(kLogTaskSleep, core, (int32_t)((100ull * sleep_us_) / elapsed_us));
+	sleep_us_ = 0;
+	report_start_us_ = now_us;
+}
+
+void EnableIdleClockGating() {
+	// Peripherals this firmware does not use. The processors, bus fabric, SRAM,
+	// XIP, DMA, PIO0 of the microphone, timer, watchdog and USB keep their clocks.
+	// Both cores clear the same bits, so the read-modify-write needs no lock.
+	clocks_hw->sleep_en0 &=
+	    ~(CLOCKS_SLEEP_EN0_CLK_SYS_ADC_BITS | CLOCKS_SLEEP_EN0_CLK_ADC_ADC_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_I2C0_BITS |
+	      CLOCKS_SLEEP_EN0_CLK_SYS_I2C1_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_JTAG_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_PIO1_BITS |
+	      CLOCKS_SLEEP_EN0_CLK_SYS_PWM_BITS | CLOCKS_SLEEP_EN0_CLK_SYS_RTC_BITS | CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS);
+	clocks_hw->sleep_en1 &=
+	    ~(CLOCKS_SLEEP_EN1_CLK_SYS_SPI0_BITS | CLOCKS_SLEEP_EN1_CLK_PERI_SPI0_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_SPI1_BITS |
+	      CLOCKS_SLEEP_EN1_CLK_PERI_SPI1_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_UART0_BITS |
+	      CLOCKS_SLEEP_EN1_CLK_PERI_UART0_BITS | CLOCKS_SLEEP_EN1_CLK_SYS_UART1_BITS |
+	      CLOCKS_SLEEP_EN1_CLK_PERI_UART1_BITS);
+	// WFE and WFI of this core enter deep sleep. Once both cores sleep, only the
+	// clocks enabled in SLEEP_EN keep running.
+	scb_hw->scr |= M0PLUS_SCR_SLEEPDEEP_BITS;
+}
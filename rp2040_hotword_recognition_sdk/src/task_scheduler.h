@@ -0,0 +1,79 @@
+#ifndef TASK_SCHEDULER_H_
+#define TASK_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Cooperative run-to-completion scheduler of one core. Tasks are released
+// periodically or by Signal(), from the audio capture interrupt or the other
+// core, and each release has to complete within the deadline of its task.
+// RunOnce() runs the released task with the earliest deadline, or, with
+// g_idle_sleep_enabled, sleeps in WFE until the next periodic release instead of
+// polling. Interrupts and the SEV of Signal() end the sleep early.
+//
+// Releases of a task that did not run yet merge into one run, so a task has to
+// process everything that is pending, like the slices of a queue. Runs that
+// complete after the deadline, and periodic releases skipped by an overrun, count
+// as deadline misses.
+class TaskScheduler {
+ public:
+	typedef void (*TaskFunction)();
+
+	static constexpr int kMaxTasks = 4;
+	// Longest sleep without a periodic release, bounds the delay of the report
+	static constexpr uint32_t kMaxSleepUs = 100000;
+
+	TaskScheduler() = default;
+
+	// Adds a task released every period_us, or only by Signal() with a period of
+	// 0. Returns the task index, or -1 if all kMaxTasks are used. Add all tasks
+	// before RunOnce() is called the first time.
+	int AddTask(const char* name, TaskFunction function, uint32_t period_us, uint32_t deadline_us);
+
+	// Releases the task, safe to call from interrupt handlers and the other core
+	void Signal(int task);
+
+	// Runs the released task with the earliest deadline, or waits until a task may
+	// be released. Call in a loop on the owning core.
+	void RunOnce();
+
+	// Logs runs, deadline misses and longest response time of every task, and the
+	// share of time this core slept, every interval_ms. 0 disables the report.
+	void SetReportInterval(int32_t interval_ms) { report_interval_us_ = interval_ms * 1000; }
+
+ private:
+	struct Task {
+		const char* name;
+		TaskFunction function;
+		uint32_t period_us;
+		uint32_t deadline_us;
+		uint32_t next_release_us;
+		// Written by Signal(), cleared by the owning core when the task runs
+		std::atomic<bool> signaled;
+		std::atomic<uint32_t> signal_us;
+		// Statistics since the last report, response is release to completion
+		int32_t run_count;
+		int32_t miss_count;
+		uint32_t max_response_us;
+	};
+
+	void Start(uint32_t now_us);
+	void Run(int task, uint32_t release_us, uint32_t now_us);
+	void Sleep(uint32_t now_us);
+	void ReportIfDue(uint32_t now_us);
+
+	Task tasks_[kMaxTasks];
+	int task_count_ = 0;
+	bool started_ = false;
+	uint32_t report_interval_us_ = 0;
+	uint32_t report_start_us_ = 0;
+	uint32_t sleep_us_ = 0;
+};
+
+// Lets the clocks of the peripherals this firmware does not use stop while both
+// cores sleep in WFE or WFI (g_idle_clock_gating_enabled in src/config.h). Call
+// on each core.
+void EnableIdleClockGating();
+
+#endif
@@ -0,0 +1,150 @@
+#include "usb_composite.h"
+
+#include "audio_provider.h"
+#include "config.h"
+#include "hardware/irq.h"
+#include "log_ring.h"
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "usb_microphone.h"
+#ifdef __cplusplus
+}
+#endif
+
+static_assert((g_usb_stream_lag_ms >= 2) && (g_usb_stream_lag_ms <= kAudioCaptureRingBlockCount - 2),
+              "The USB stream lag must leave a block of margin at both ends of the capture ring");
+
+namespace {
+// A pause of the USB frames this long means the host stopped recording
+constexpr uint32_t kStreamPauseUs = 10000;
+// Frames the lag has to stay off the target before a block is duplicated or
+// skipped. The phase jitter between capture interrupt and USB frames moves the
+// lag by one block and back, a drift of 500 ppm only every 2000 frames.
+constexpr int kDriftFrameCount = 64;
+
+int usb_task_irq = -1;
+// Start time in ms of the next block of the stream
+int32_t stream_time = 0;
+bool is_streaming = false;
+uint32_t last_frame_us = 0;
+// Consecutive frames with the lag below or above g_usb_stream_lag_ms
+int drift_frames = 0;
+const int16_t silence[kAudioCaptureBlockSize] = {};
+// Statistics since the last report
+int32_t block_count = 0;
+int32_t duplicate_count = 0;
+int32_t skip_count = 0;
+int32_t resync_count = 0;
+int32_t report_time = 0;
+
+// Sends the block before the stream time again, which delays the stream by one
+// block
+void WriteDuplicate() {
+	const int16_t* block = GetCapturedAudioBlock(stream_time - 1);
+	if (block == nullptr) {
+		block = silence;
+	}
+	usb_microphone_write(block, kAudioCaptureBlockSize * sizeof(int16_t));
+	duplicate_count++;
+}
+
+// Called by TinyUSB in every USB frame while the host records
+void OnTxReady() {
+	const uint32_t now_us = time_us_32();
+	if (now_us - last_frame_us > kStreamPauseUs) {
+		is_streaming = false;
+	}
+	last_frame_us = now_us;
+
+	const int32_t latest_time = LatestAudioTimestamp();
+	if (!is_streaming) {
+		stream_time = latest_time - g_usb_stream_lag_ms;
+		drift_frames = 0;
+		const int16_t* block = GetCapturedAudioBlock(stream_time);
+		if (block == nullptr) {
+			// The capture did not start yet
+			usb_microphone_write(silence, sizeof(silence));
+			return;
+		}
+		is_streaming = true;
+	}
+
+	// The crystal of the capture and the frames of the host drift apart. Once the
+	// lag stayed off the target, one block is duplicated or skipped, so the stream
+	// never runs out of captured blocks and its latency stays bounded.
+	int32_t lag = latest_time - stream_time;
+	if (lag < g_usb_stream_lag_ms) {
+		drift_frames = (drift_frames < 0) ? drift_frames - 1 : -1;
+	} else if (lag > g_usb_stream_lag_ms) {
+		drift_frames = (drift_frames > 0) ? drift_frames + 1 : 1;
+	} else {
+		drift_frames = 0;
+	}
+	if ((lag <= 0) || (drift_frames <= -kDriftFrameCount)) {
+		// The capture interrupt is late, or the frames run faster than the capture
+		WriteDuplicate();
+		drift_frames = 0;
+		return;
+	}
+	if (drift_frames >= kDriftFrameCount) {
+		stream_time++;
+		skip_count++;
+		drift_frames = 0;
+	}
+
+	const int16_t* block = GetCapturedAudioBlock(stream_time);
+	if (block == nullptr) {
+		// The USB task stalled until the block was overwritten
+		stream_time = latest_time - g_usb_stream_lag_ms;
+		block = GetCapturedAudioBlock(stream_time);
+		resync_count++;
+	}
+	usb_microphone_write(block, kAudioCaptureBlockSize * sizeof(int16_t));
+	stream_time++;
+	block_count++;
+}
+
+void ReportUsbStreamIfDue() {
+	const int32_t current_time = to_ms_since_boot(get_absolute_time());
+	if ((g_usb_report_interval_ms <= 0) || (current_time - report_time < g_usb_report_interval_ms)) {
+		return;
+	}
+	if (block_count + duplicate_count > 0) {
+		Log(kLogUsbStream, block_count, duplicate_count, skip_count, resync_count);
+	}
+	block_count = 0;
+	duplicate_count = 0;
+	skip_count = 0;
+	resync_count = 0;
+	report_time = current_time;
+}
+
+// Lowest priority, so capture and the USB interrupt itself preempt it
+void UsbTaskHandler() {
+	usb_microphone_task();
+	DrainLogRing();
+	ReportUsbStreamIfDue();
+}
+
+void OnUsbInterrupt() { irq_set_pending(usb_task_irq); }
+}  // namespace
+
+void InitUsbComposite() {
+	usb_microphone_init();
+	usb_microphone_set_tx_ready_handler(OnTxReady);
+	usb_task_irq = user_irq_claim_unused(true);
+	irq_set_exclusive_handler(usb_task_irq, UsbTaskHandler);
+	irq_set_priority(usb_task_irq, PICO_LOWEST_IRQ_PRIORITY);
+	irq_set_enabled(usb_task_irq, true);
+	// Runs after the handler of the TinyUSB driver queued the events
+	irq_add_shared_handler(USBCTRL_IRQ, OnUsbInterrupt, PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+}
+
+void ScheduleUsbTask() {
+	if (usb_task_irq >= 0) {
+		irq_set_pending(usb_task_irq);
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef USB_COMPOSITE_H_
+#define USB_COMPOSITE_H_
+
+// Composite USB device of the USB_MICROPHONE build option: a UAC2 microphone
+// streaming the PDM capture of the recognition, and a CDC serial port carrying
+// the log ring with the detection events, over the one device stack. It replaces
+// the USB stdio of the pico-sdk, which would register its own device.
+//
+// TinyUSB runs in a low priority interrupt handler, pended by the USB interrupt
+// and by ScheduleUsbTask(), as the USB stdio of the pico-sdk does. The audio
+// stream is therefore served at the rate of the USB frames, whatever the cores
+// are busy with, and the thread mode code never calls into TinyUSB. In every USB
+// frame the microphone writes the captured block g_usb_stream_lag_ms behind the
+// latest one straight from the capture ring (GetCapturedAudioBlock()), without
+// an intermediate buffer. The capture crystal and the frames of the host drift
+// apart: once the lag stayed below the target for a while, a block is sent twice,
+// once it stayed above, a block is skipped, one at a time, so the stream neither
+// runs out of captured blocks nor drifts away. Only a stall of the USB task past
+// the capture ring restarts the stream at the target (a resync). Duplicates,
+// skips and resyncs are counted and logged every g_usb_report_interval_ms.
+//
+// The log ring is drained in the same handler, so it is the only consumer of the
+// CDC transmit buffer.
+
+// Starts the device stack. Call once from core 0 in setup(), before the first
+// Log() should reach the host.
+void InitUsbComposite();
+
+// Pends the TinyUSB handler, which also drains the log ring. Safe to call from
+// the log task.
+void ScheduleUsbTask();
+
+#endif
@@ -0,0 +1,323 @@
+// Checks the jitter buffer (src/jitter_buffer.h) on the host, with the depth
+// and target level of src/main.c.
+// - Timed runs replay the PDM blocks and USB frames as events, with skewed
+//   clocks, jittered frames and a 20 ms stall of the USB task, and check the
+//   counters against the skew, the fill level against the target and that the
+//   drift is corrected by single blocks.
+// - A threaded run lets producer and consumer race on two threads, the producer
+//   filling the buffer, so it writes next to the slot being read and the
+//   consumer skips while the producer writes.
+// Every block is numbered by its samples, so each run also checks that no block
+// is torn and that every block written is sent once, sent again as duplicate,
+// skipped, dropped as overrun or still buffered, as the counters report.
+//
+// Usage: jitter_buffer_check
+// Prints each failed check and returns 1 if any failed.
+
+// clock_gettime() and sched_yield()
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "jitter_buffer.h"
+
+#define JITTER_BUFFER_DEPTH 8
+#define JITTER_BUFFER_TARGET_LEVEL 3
+
+#define BLOCK_NS 1000000  // 1 ms block and USB frame
+
+// Simulated time of each timed run, 1 block per ms
+#define RUN_BLOCK_COUNT 1000000
+// Reads before the level checks of a timed run start, to fill the buffer
+#define SETTLE_READ_COUNT 100
+// Duration of the threaded run, 300 ms
+#define THREADED_RUN_NS 300000000
+
+static int check_count = 0;
+static int failure_count = 0;
+
+static void check(bool condition, const char* run, const char* description) {
+	check_count++;
+	if (!condition) {
+		failure_count++;
+		printf("FAILED: %s: %s\n", run, description);
+	}
+}
+
+// Sent blocks by kind, seen by the consumer
+typedef struct stream_stats {
+	int64_t written;     // blocks written by the producer
+	int64_t silent;      // silent blocks before the first block
+	int64_t fresh;       // blocks sent for the first time
+	int64_t repeated;    // blocks sent again
+	int64_t torn;        // blocks whose samples are not consecutive
+	int64_t backwards;   // blocks older than the block before
+	int64_t last_block;  // number of the block sent last, -1 before the first
+	int64_t repeat_run;  // reads in a row that sent the last block again
+	int64_t max_repeat_run;
+	int64_t max_jump;  // most blocks one read moved forward, 1 without skips
+} stream_stats_t;
+
+static void fill_block(int16_t* samples, int64_t block) {
+	for (int i = 0; i < JITTER_BUFFER_BLOCK_SIZE; i++) {
+		samples[i] = (int16_t)(block * JITTER_BUFFER_BLOCK_SIZE + i);
+	}
+}
+
+static void write_block(jitter_buffer_t* buffer, stream_stats_t* stream) {
+	fill_block(jitter_buffer_write_begin(buffer), stream->written);
+	jitter_buffer_write_end(buffer);
+	stream->written++;
+}
+
+static void read_block(jitter_buffer_t* buffer, stream_stats_t* stream) {
+	const int16_t* samples = jitter_buffer_read(buffer);
+	for (int i = 1; i < JITTER_BUFFER_BLOCK_SIZE; i++) {
+		if ((int16_t)(samples[i] - samples[0]) != i) {
+			bool is_silent = true;
+			for (int j = 0; j < JITTER_BUFFER_BLOCK_SIZE; j++) {
+				is_silent = is_silent && (samples[j] == 0);
+			}
+			if (is_silent && (stream->last_block < 0)) {
+				stream->silent++;
+			} else {
+				stream->torn++;
+			}
+			return;
+		}
+	}
+	if (stream->last_block < 0) {
+		stream->last_block = samples[0] / JITTER_BUFFER_BLOCK_SIZE;
+		stream->fresh++;
+		return;
+	}
+	// The samples wrap every 4096 blocks, far more than the buffer holds
+	const int16_t block_distance = (int16_t)(samples[0] - (int16_t)(stream->last_block * JITTER_BUFFER_BLOCK_SIZE));
+	if (block_distance == 0) {
+		stream->repeated++;
+		stream->repeat_run++;
+		stream->max_repeat_run = (stream->repeat_run > stream->max_repeat_run) ? stream->repeat_run : stream->max_repeat_run;
+	} else if (block_distance < 0) {
+		stream->backwards++;
+	} else {
+		const int64_t jump = block_distance / JITTER_BUFFER_BLOCK_SIZE;
+		stream->last_block += jump;
+		stream->fresh++;
+		stream->repeat_run = 0;
+		stream->max_jump = (jump > stream->max_jump) ? jump : stream->max_jump;
+	}
+}
+
+// Checks the stream against the counters of the buffer
+static void check_stream(const char* run, jitter_buffer_t* buffer, const stream_stats_t* stream) {
+	jitter_buffer_stats_t stats;
+	jitter_buffer_get_stats(buffer, &stats);
+	check(stream->torn == 0, run, "no block is torn");
+	check(stream->backwards == 0, run, "no block is older than the one before");
+	check(stream->repeated == stats.duplicates, run, "the blocks sent again are the duplicates");
+	check(stream->written == stream->fresh + stats.skips + stats.overruns + jitter_buffer_level(buffer), run,
+	      "every block is sent, skipped, dropped or buffered");
+}
+
+// Checks that the drift is corrected by single blocks, not by the full and empty
+// handling of stalls
+static void check_single_blocks(const char* run, const stream_stats_t* stream) {
+	check(stream->max_repeat_run <= 1, run, "no read repeats more than one block");
+	check(stream->max_jump <= 2, run, "no read skips more than one block");
+}
+
+typedef struct timed_run {
+	const char* name;
+	int32_t skew_ppm;        // the PDM block lasts this much longer than a USB frame
+	int32_t jitter_ns;       // USB frames are late by up to this
+	int64_t stall_start_ns;  // time of the USB task stall, or -1
+	int64_t stall_ns;        // length of the stall, no frames are served meanwhile
+} timed_run_t;
+
+typedef struct timed_result {
+	stream_stats_t stream;
+	jitter_buffer_stats_t stats;
+	uint32_t min_level;  // fill level before each read after the settling reads
+	uint32_t max_level;
+	uint32_t min_level_after_stall;
+	uint32_t max_level_after_stall;
+} timed_result_t;
+
+static void timed_replay(jitter_buffer_t* buffer, const timed_run_t* run, timed_result_t* result) {
+	jitter_buffer_init(buffer, JITTER_BUFFER_DEPTH, JITTER_BUFFER_TARGET_LEVEL);
+	stream_stats_t stream = {0, 0, 0, 0, 0, 0, -1, 0, 0, 0};
+	result->min_level = JITTER_BUFFER_MAX_DEPTH;
+	result->max_level = 0;
+	result->min_level_after_stall = JITTER_BUFFER_MAX_DEPTH;
+	result->max_level_after_stall = 0;
+	// The USB task runs well after the stall ends, once the buffer recovered
+	const int64_t recovered_ns = run->stall_start_ns + run->stall_ns + 10 * BLOCK_NS;
+
+	uint32_t seed = 1;
+	const int64_t block_ns = BLOCK_NS + (int64_t)run->skew_ppm * BLOCK_NS / 1000000;
+	int64_t read_count = 0;
+	for (int64_t frame = 0; frame < RUN_BLOCK_COUNT; frame++) {
+		const int64_t frame_ns = frame * BLOCK_NS;
+		const bool is_stalled =
+		    (run->stall_start_ns >= 0) && (frame_ns >= run->stall_start_ns) &&
+		    (frame_ns < run->stall_start_ns + run->stall_ns);
+		seed = seed * 1664525u + 1013904223u;
+		const int64_t read_ns = frame_ns + ((run->jitter_ns > 0) ? (int64_t)(seed >> 8) % run->jitter_ns : 0);
+		// Blocks complete at the end of their time
+		while ((stream.written + 1) * block_ns <= read_ns) {
+			write_block(buffer, &stream);
+		}
+		if (is_stalled) {
+			continue;
+		}
+		const uint32_t level = jitter_buffer_level(buffer);
+		if (read_count >= SETTLE_READ_COUNT) {
+			result->min_level = (level < result->min_level) ? level : result->min_level;
+			result->max_level = (level > result->max_level) ? level : result->max_level;
+			if ((run->stall_start_ns >= 0) && (read_ns >= recovered_ns)) {
+				if (level < result->min_level_after_stall) {
+					result->min_level_after_stall = level;
+				}
+				if (level > result->max_level_after_stall) {
+					result->max_level_after_stall = level;
+				}
+			}
+		}
+		read_block(buffer, &stream);
+		read_count++;
+	}
+	result->stream = stream;
+	jitter_buffer_get_stats(buffer, &result->stats);
+	check_stream(run->name, buffer, &stream);
+	printf("%s: %lld blocks, %u underruns, %u overruns, %u duplicates, %u skips, level %u to %u\n", run->name,
+	       (long long)stream.written, result->stats.underruns, result->stats.overruns, result->stats.duplicates,
+	       result->stats.skips, result->min_level, result->max_level);
+}
+
+static void check_timed_runs(jitter_buffer_t* buffer) {
+	const int64_t drift_blocks = 500;  // blocks of 500 ppm over the run
+	timed_result_t result;
+
+	// Jitter within the target: the level stays around it, nothing to correct
+	const timed_run_t steady = {"steady", 0, 0, -1, 0};
+	timed_replay(buffer, &steady, &result);
+	check(result.stream.silent > 0, steady.name, "silence is sent until the target level is reached");
+	check((result.stats.underruns == 0) && (result.stats.overruns == 0) && (result.stats.duplicates == 0) &&
+	          (result.stats.skips == 0),
+	      steady.name, "equal clocks need no correction");
+	check((result.min_level >= JITTER_BUFFER_TARGET_LEVEL - 1) && (result.max_level <= JITTER_BUFFER_TARGET_LEVEL),
+	      steady.name, "the level stays at the target");
+
+	const timed_run_t jittered = {"jittered", 0, (JITTER_BUFFER_TARGET_LEVEL - 1) * BLOCK_NS, -1, 0};
+	timed_replay(buffer, &jittered, &result);
+	check((result.stats.underruns == 0) && (result.stats.overruns == 0) && (result.stats.duplicates == 0) &&
+	          (result.stats.skips == 0),
+	      jittered.name, "jitter within the target needs no correction");
+	check((result.min_level >= 1) && (result.max_level <= JITTER_BUFFER_TARGET_LEVEL + 1), jittered.name,
+	      "the level stays within the jitter around the target");
+
+	// A slow PDM clock: the missing blocks are duplicated one at a time, before
+	// the buffer runs empty
+	const timed_run_t slow = {"PDM clock 500 ppm slow", 500, BLOCK_NS / 2, -1, 0};
+	timed_replay(buffer, &slow, &result);
+	check(llabs((int64_t)result.stats.duplicates - drift_blocks) <= 1, slow.name, "the duplicates match the skew");
+	check((result.stats.underruns == 0) && (result.stats.overruns == 0) && (result.stats.skips == 0), slow.name,
+	      "a slow producer neither runs the buffer empty nor skips");
+	check((result.min_level >= JITTER_BUFFER_TARGET_LEVEL - 1) && (result.max_level <= JITTER_BUFFER_TARGET_LEVEL + 1),
+	      slow.name, "the level stays within one block of the target");
+	check_single_blocks(slow.name, &result.stream);
+
+	// A fast PDM clock: the surplus blocks are skipped one at a time, before the
+	// buffer runs full
+	const timed_run_t fast = {"PDM clock 500 ppm fast", -500, BLOCK_NS / 2, -1, 0};
+	timed_replay(buffer, &fast, &result);
+	check(llabs((int64_t)result.stats.skips - drift_blocks) <= 1, fast.name, "the skipped blocks match the skew");
+	check((result.stats.underruns == 0) && (result.stats.overruns == 0) && (result.stats.duplicates == 0), fast.name,
+	      "a fast producer neither runs the buffer full nor duplicates");
+	check((result.min_level >= JITTER_BUFFER_TARGET_LEVEL - 1) && (result.max_level <= JITTER_BUFFER_TARGET_LEVEL + 1),
+	      fast.name, "the level stays within one block of the target");
+	check_single_blocks(fast.name, &result.stream);
+
+	// A 20 ms stall of the USB task: the blocks written meanwhile are lost, and
+	// the level returns to the target
+	const timed_run_t stall = {"20 ms stall", 0, BLOCK_NS / 2, 500 * (int64_t)BLOCK_NS, 20 * (int64_t)BLOCK_NS};
+	timed_replay(buffer, &stall, &result);
+	check(llabs((int64_t)(result.stats.skips + result.stats.overruns) - 20) <= 1, stall.name,
+	      "the blocks of the stall are skipped or dropped");
+	check((result.stats.skips > 0) && (result.stats.overruns > 0), stall.name,
+	      "the full buffer drops new blocks and skips to the target");
+	check((result.stats.underruns == 0) && (result.stats.duplicates == 0), stall.name, "a stall duplicates nothing");
+	check((result.min_level_after_stall >= JITTER_BUFFER_TARGET_LEVEL - 1) &&
+	          (result.max_level_after_stall <= JITTER_BUFFER_TARGET_LEVEL),
+	      stall.name, "the level returns to the target after the stall");
+}
+
+// Shared by the threads of the threaded run
+typedef struct threaded_run {
+	jitter_buffer_t* buffer;
+	stream_stats_t stream;
+	atomic_bool is_writing;
+} threaded_run_t;
+
+static int64_t monotonic_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void* produce(void* argument) {
+	threaded_run_t* run = (threaded_run_t*)argument;
+	const int64_t end_ns = monotonic_ns() + THREADED_RUN_NS;
+	while (monotonic_ns() < end_ns) {
+		write_block(run->buffer, &run->stream);
+		// Lets the consumer find the buffer full on a single core
+		if (jitter_buffer_level(run->buffer) >= JITTER_BUFFER_DEPTH) {
+			sched_yield();
+		}
+	}
+	atomic_store(&run->is_writing, false);
+	return NULL;
+}
+
+static void check_threaded_run(jitter_buffer_t* buffer) {
+	jitter_buffer_init(buffer, JITTER_BUFFER_DEPTH, JITTER_BUFFER_TARGET_LEVEL);
+	threaded_run_t run = {buffer, {0, 0, 0, 0, 0, 0, -1, 0, 0, 0}, true};
+	stream_stats_t stream = {0, 0, 0, 0, 0, 0, -1, 0, 0, 0};
+	pthread_t producer;
+	if (pthread_create(&producer, NULL, produce, &run) != 0) {
+		check(false, "threaded", "the producer thread starts");
+		return;
+	}
+	while (atomic_load(&run.is_writing)) {
+		read_block(buffer, &stream);
+		// Lets the producer catch up on a single core
+		if (jitter_buffer_level(buffer) == 0) {
+			sched_yield();
+		}
+	}
+	pthread_join(producer, NULL);
+	stream.written = run.stream.written;
+	check(stream.fresh > 0, "threaded", "blocks are sent");
+	check_stream("threaded", buffer, &stream);
+	jitter_buffer_stats_t stats;
+	jitter_buffer_get_stats(buffer, &stats);
+	check(stats.skips > 0, "threaded", "the consumer skips blocks of the full buffer");
+	printf("threaded: %lld blocks, %lld sent, %u underruns, %u overruns, %u duplicates, %u skips\n",
+	       (long long)stream.written, (long long)stream.fresh, stats.underruns, stats.overruns, stats.duplicates,
+	       stats.skips);
+}
+
+int main(void) {
+	static jitter_buffer_t buffer;
+	check_timed_runs(&buffer);
+	check_threaded_run(&buffer);
+	printf("Jitter buffer: %d of %d checks passed\n", check_count - failure_count, check_count);
+	return (failure_count == 0) ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include "jitter_buffer.h"
+
+#include <string.h>
+
+static uint32_t next_index(const jitter_buffer_t* buffer, uint32_t index, uint32_t count) {
+	return (index + count) % (2 * buffer->depth);
+}
+
+static uint32_t fill_level(const jitter_buffer_t* buffer, uint32_t write_index, uint32_t read_index) {
+	return (write_index + 2 * buffer->depth - read_index) % (2 * buffer->depth);
+}
+
+static int16_t* slot(jitter_buffer_t* buffer, uint32_t index) {
+	return buffer->blocks[(index < buffer->depth) ? index : (index - buffer->depth)];
+}
+
+void jitter_buffer_init(jitter_buffer_t* buffer, uint32_t depth, uint32_t target_level) {
+	memset(buffer, 0, sizeof(*buffer));
+	if (depth < 2) {
+		depth = 2;
+	} else if (depth > JITTER_BUFFER_MAX_DEPTH) {
+		depth = JITTER_BUFFER_MAX_DEPTH;
+	}
+	if (target_level < 1) {
+		target_level = 1;
+	} else if (target_level > depth - 1) {
+		target_level = depth - 1;
+	}
+	buffer->depth = depth;
+	buffer->target_level = target_level;
+	atomic_init(&buffer->write_index, 0);
+	atomic_init(&buffer->read_index, 0);
+	// Silence until the buffer reached the target the first time
+	buffer->is_refilling = true;
+}
+
+int16_t* jitter_buffer_write_begin(jitter_buffer_t* buffer) {
+	const uint32_t write_index = atomic_load_explicit(&buffer->write_index, memory_order_relaxed);
+	// The slot is free once the consumer released it
+	const uint32_t read_index = atomic_load_explicit(&buffer->read_index, memory_order_acquire);
+	buffer->is_discarding = (fill_level(buffer, write_index, read_index) >= buffer->depth);
+	return buffer->is_discarding ? buffer->discard_block : slot(buffer, write_index);
+}
+
+void jitter_buffer_write_end(jitter_buffer_t* buffer) {
+	if (buffer->is_discarding) {
+		buffer->overruns++;
+		return;
+	}
+	const uint32_t write_index = atomic_load_explicit(&buffer->write_index, memory_order_relaxed);
+	// Publishes the samples of the slot together with the index
+	atomic_store_explicit(&buffer->write_index, next_index(buffer, write_index, 1), memory_order_release);
+}
+
+const int16_t* jitter_buffer_read(jitter_buffer_t* buffer) {
+	const uint32_t write_index = atomic_load_explicit(&buffer->write_index, memory_order_acquire);
+	uint32_t read_index = atomic_load_explicit(&buffer->read_index, memory_order_relaxed);
+	uint32_t level = fill_level(buffer, write_index, read_index);
+
+	if (level >= buffer->depth) {
+		// The consumer stalled: return to the target latency instead of dropping
+		// every further block at the producer
+		const uint32_t skip_count = level - buffer->target_level;
+		read_index = next_index(buffer, read_index, skip_count);
+		atomic_store_explicit(&buffer->read_index, read_index, memory_order_release);
+		buffer->skips += skip_count;
+		buffer->drift_reads = 0;
+		level = buffer->target_level;
+	}
+	if (level == 0) {
+		if (!buffer->is_refilling) {
+			buffer->underruns++;
+			buffer->is_refilling = true;
+		}
+	} else if (level >= buffer->target_level) {
+		buffer->is_refilling = false;
+	}
+	if (buffer->is_refilling) {
+		// Every block sent again postpones the stream by one block, which refills
+		// the buffer by one
+		if (buffer->has_last_block) {
+			buffer->duplicates++;
+		}
+		buffer->drift_reads = 0;
+		return buffer->last_block;
+	}
+
+	// The clocks drift apart. Once the level stayed off the target, one block is
+	// sent again or skipped, long before the buffer runs empty or full.
+	if (level < buffer->target_level) {
+		buffer->drift_reads = (buffer->drift_reads < 0) ? buffer->drift_reads - 1 : -1;
+	} else if (level > buffer->target_level) {
+		buffer->drift_reads = (buffer->drift_reads > 0) ? buffer->drift_reads + 1 : 1;
+	} else {
+		buffer->drift_reads = 0;
+	}
+	if (buffer->drift_reads <= -JITTER_BUFFER_DRIFT_READS) {
+		// The consumer runs faster than the producer
+		buffer->duplicates++;
+		buffer->drift_reads = 0;
+		return buffer->last_block;
+	}
+	if (buffer->drift_reads >= JITTER_BUFFER_DRIFT_READS) {
+		// The producer runs faster than the consumer, the level is at least 2
+		read_index = next_index(buffer, read_index, 1);
+		buffer->skips++;
+		buffer->drift_reads = 0;
+	}
+
+	memcpy(buffer->last_block, slot(buffer, read_index), sizeof(buffer->last_block));
+	buffer->has_last_block = true;
+	// Releases the slot to the producer after the copy
+	atomic_store_explicit(&buffer->read_index, next_index(buffer, read_index, 1), memory_order_release);
+	return buffer->last_block;
+}
+
+uint32_t jitter_buffer_level(jitter_buffer_t* buffer) {
+	const uint32_t write_index = atomic_load_explicit(&buffer->write_index, memory_order_acquire);
+	const uint32_t read_index = atomic_load_explicit(&buffer->read_index, memory_order_acquire);
+	return fill_level(buffer, write_index, read_index);
+}
+
+void jitter_buffer_get_stats(const jitter_buffer_t* buffer, jitter_buffer_stats_t* stats) {
+	stats->underruns = buffer->underruns;
+	stats->overruns = buffer->overruns;
+	stats->duplicates = buffer->duplicates;
+	stats->skips = buffer->skips;
+}
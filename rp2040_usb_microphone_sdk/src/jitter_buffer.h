@@ -0,0 +1,91 @@
+#ifndef _JITTER_BUFFER_H_
+#define _JITTER_BUFFER_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single producer, single consumer buffer of audio blocks between the PDM
+// samples ready callback (producer, interrupt) and the USB transmit callback
+// (consumer, USB task). The producer fills the slot at the write index in place
+// and publishes it, the consumer copies the block at the read index out before
+// releasing the slot, so neither side ever sees a block the other one is writing.
+// Each index has one writer, so the Cortex-M0+ needs no read-modify-write
+// instruction or lock, only ordered loads and stores.
+//
+// The PDM clock and the USB frames drift apart, and the USB task jitters. The
+// consumer keeps the fill level around the latency target:
+// - Below or above the target for JITTER_BUFFER_DRIFT_READS reads in a row: the
+//   clocks drift, one block is sent again or skipped.
+// - Empty on read: an underrun, the producer stalled. The last block is sent
+//   again, and so on until the buffer refilled to the target.
+// - Full on read: the consumer stalled, the oldest blocks down to the target are
+//   skipped.
+// - Full on write: an overrun, the new block is dropped.
+// Before the buffer reached the target the first time, silence is sent.
+
+#ifndef JITTER_BUFFER_BLOCK_SIZE
+#define JITTER_BUFFER_BLOCK_SIZE 16  // samples, 1 ms at 16 kHz
+#endif
+
+#define JITTER_BUFFER_MAX_DEPTH 32  // blocks
+
+// Reads the level has to stay off the target before a block is sent again or
+// skipped. The phase jitter between PDM blocks and USB frames moves the level by
+// one block and back, a drift of 500 ppm only every 2000 reads.
+#ifndef JITTER_BUFFER_DRIFT_READS
+#define JITTER_BUFFER_DRIFT_READS 64
+#endif
+
+typedef struct jitter_buffer_stats {
+	uint32_t underruns;   // reads that found the buffer empty
+	uint32_t overruns;    // blocks dropped on write, the buffer was full
+	uint32_t duplicates;  // blocks sent again for the drift or while refilling after an underrun
+	uint32_t skips;       // blocks skipped on read for the drift or after a stall
+} jitter_buffer_stats_t;
+
+typedef struct jitter_buffer {
+	int16_t blocks[JITTER_BUFFER_MAX_DEPTH][JITTER_BUFFER_BLOCK_SIZE];
+	uint32_t depth;
+	uint32_t target_level;
+	// Indices modulo 2 * depth, so a full buffer differs from an empty one for
+	// any depth
+	atomic_uint_least32_t write_index;
+	atomic_uint_least32_t read_index;
+	// Written by the producer
+	int16_t discard_block[JITTER_BUFFER_BLOCK_SIZE];
+	bool is_discarding;
+	volatile uint32_t overruns;
+	// Written by the consumer
+	int16_t last_block[JITTER_BUFFER_BLOCK_SIZE];
+	bool is_refilling;
+	bool has_last_block;
+	// Consecutive reads with the level below (negative) or above the target
+	int32_t drift_reads;
+	volatile uint32_t underruns;
+	volatile uint32_t duplicates;
+	volatile uint32_t skips;
+} jitter_buffer_t;
+
+// Initializes an empty buffer of depth blocks (up to JITTER_BUFFER_MAX_DEPTH)
+// that the consumer keeps target_level blocks full (1 to depth - 1). Call
+// before the producer and the consumer start.
+void jitter_buffer_init(jitter_buffer_t* buffer, uint32_t depth, uint32_t target_level);
+
+// Producer: returns the slot to fill with the next block. If the buffer is full
+// this is a scratch block, which jitter_buffer_write_end() drops and counts.
+int16_t* jitter_buffer_write_begin(jitter_buffer_t* buffer);
+
+// Producer: publishes the block filled since jitter_buffer_write_begin()
+void jitter_buffer_write_end(jitter_buffer_t* buffer);
+
+// Consumer: returns the block to send, valid until the next call
+const int16_t* jitter_buffer_read(jitter_buffer_t* buffer);
+
+// Current fill level in blocks, callable from both sides
+uint32_t jitter_buffer_level(jitter_buffer_t* buffer);
+
+// Copies the counters, callable from anywhere
+void jitter_buffer_get_stats(const jitter_buffer_t* buffer, jitter_buffer_stats_t* stats);
+
+#endif
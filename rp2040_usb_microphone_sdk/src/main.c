@@ -15,9 +15,16 @@
 #define SAMPLE_RATE 16000      // 16000 Hz
 #define SAMPLE_BUFFER_SIZE 16  // 16 samples/ms * 1 channel
 
+#define JITTER_BUFFER_DEPTH 8         // blocks of SAMPLE_BUFFER_SIZE, 8 ms
+#define JITTER_BUFFER_TARGET_LEVEL 3  // blocks of SAMPLE_BUFFER_SIZE, added latency and jitter margin
+
+#include "hardware/sync.h"
+#include "jitter_buffer.h"
 #include "pico/pdm_microphone.h"
 #include "usb_microphone.h"
 
+_Static_assert(JITTER_BUFFER_BLOCK_SIZE == SAMPLE_BUFFER_SIZE, "Jitter buffer blocks must match the PDM blocks");
+
 // Arduino Nano RP2040 Connect pin definitions
 // https://github.com/arduino/ArduinoCore-mbed/blob/master/variants/NANO_RP2040_CONNECT/pins_arduino.h
 // https://github.com/earlephilhower/arduino-pico/blob/master/variants/arduino_nano_connect/pins_arduino.h
@@ -33,7 +40,9 @@ const struct pdm_microphone_config config = {
 };
 
 // Variables
-uint16_t sample_buffer[SAMPLE_BUFFER_SIZE];
+// Blocks from the PDM interrupt to the USB task, its counters show underruns,
+// overruns and duplicated blocks in a debugger
+jitter_buffer_t jitter_buffer;
 
 // Callback functions
 void on_pdm_samples_ready();
@@ -65,12 +74,16 @@ void init_usb_microphone() {
 
 int main(void) {
 	// Initialize
+	jitter_buffer_init(&jitter_buffer, JITTER_BUFFER_DEPTH, JITTER_BUFFER_TARGET_LEVEL);
 	init_pdm_microphone();
 	init_usb_microphone();
 
 	while (1) {
-		// Run the USB microphone task continuously
+		// Run the USB microphone task, then sleep until the next interrupt. The USB
+		// and PDM interrupts queue the work of the task, and an interrupt between
+		// the task and the sleep leaves an event that ends the sleep at once.
 		usb_microphone_task();
+		__wfe();
 	}
 
 	return 0;
@@ -78,12 +91,14 @@ int main(void) {
 
 // Callback from library when all the samples in the library internal sample buffer are ready for reading.
 void on_pdm_samples_ready() {
-	// Read new samples into local buffer.
-	pdm_microphone_read(sample_buffer, SAMPLE_BUFFER_SIZE);
+	// Read new samples straight into the next slot of the jitter buffer. A full
+	// buffer hands out a scratch block, so the filter state stays continuous.
+	pdm_microphone_read(jitter_buffer_write_begin(&jitter_buffer), SAMPLE_BUFFER_SIZE);
+	jitter_buffer_write_end(&jitter_buffer);
 }
 
 // Callback from TinyUSB library when all data is ready to be transmitted.
 void on_usb_microphone_tx_ready() {
-	// Write local buffer to the USB microphone
-	usb_microphone_write(sample_buffer, sizeof(sample_buffer));
+	// Write the next block, or a repeated or silent one, to the USB microphone
+	usb_microphone_write(jitter_buffer_read(&jitter_buffer), SAMPLE_BUFFER_SIZE * sizeof(int16_t));
 }